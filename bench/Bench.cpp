@@ -0,0 +1,250 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <regex>
+#include <algorithm>
+#include <thread>
+#include <math.h>
+#include <unistd.h>
+
+#include "Bench.h"
+
+#ifndef BENCH_VERSION
+#define BENCH_VERSION "unknown"
+#endif
+
+/**
+ * \param rate A rate per second.
+ * \param unit Unit of the rate.
+ * \return The rate with a k, M or G prefix, as printed in the summary table.
+ */
+static string format_rate(double rate, string unit) {
+	static const char * prefixes[] = { "", "k", "M", "G" };
+	size_t p = 0;
+	while (p < 3 && rate >= 1000.0) {
+		rate /= 1000.0;
+		p++;
+	}
+
+	stringstream ss;
+	ss << fixed << setprecision(2) << rate << " " << prefixes[p] << unit << "/s";
+	return ss.str();
+}
+
+void Bench::add(string name, function<void(BenchState&)> body, vector<long> args) {
+	if (args.empty()) {
+		entries().push_back({ name, body, 0 });
+		return;
+	}
+
+	for (auto arg : args) {
+		entries().push_back({ name + "/" + to_string(arg), body, arg });
+	}
+}
+
+vector<Bench::Entry>& Bench::entries() {
+	static vector<Entry> registered;
+	return registered;
+}
+
+Bench::Result Bench::measure(const Entry &entry, double min_time) {
+	size_t iterations = 1;
+	while (true) {
+		BenchState state = BenchState(iterations, entry.arg);
+		entry.body(state);
+
+		// grow towards the minimum time, at most 10 times per step, so one slow
+		// outlier run does not send the next one far past the minimum
+		const double elapsed = state.real_time;
+		if (elapsed >= min_time || iterations >= 1000000000) {
+			Result result;
+			result.name = entry.name;
+			result.iterations = iterations;
+			result.real_time = state.real_time * 1e9 / iterations;
+			result.cpu_time = state.cpu_time * 1e9 / iterations;
+			result.items_per_second = state.items ? state.items * iterations / state.real_time : 0.0;
+			result.bytes_per_second = state.bytes ? state.bytes * iterations / state.real_time : 0.0;
+			return result;
+		}
+
+		const double scale = elapsed > 0.0 ? min(10.0, 1.4 * min_time / elapsed) : 10.0;
+		iterations = max(iterations + 1, (size_t)(iterations * scale));
+	}
+}
+
+vector<Bench::Result> Bench::aggregate(const vector<Result> &runs) {
+	auto stat = [&runs](function<double(const Result&)> field, string kind) {
+		vector<double> values;
+		for (auto &run : runs) {
+			values.push_back(field(run));
+		}
+
+		double mean = 0.0;
+		for (auto value : values) {
+			mean += value / values.size();
+		}
+
+		if (kind == "mean") {
+			return mean;
+		} else if (kind == "median") {
+			sort(values.begin(), values.end());
+			const size_t n = values.size();
+			return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+		}
+
+		double variance = 0.0;
+		for (auto value : values) {
+			variance += (value - mean) * (value - mean) / max((size_t)1, values.size() - 1);
+		}
+
+		return sqrt(variance);
+	};
+
+	vector<Result> results;
+	for (string kind : { "mean", "median", "stddev" }) {
+		Result result = runs[0];
+		result.name = runs[0].name + "_" + kind;
+		result.aggregate = kind;
+		result.real_time = stat([](const Result &r) { return r.real_time; }, kind);
+		result.cpu_time = stat([](const Result &r) { return r.cpu_time; }, kind);
+		result.items_per_second = stat([](const Result &r) { return r.items_per_second; }, kind);
+		result.bytes_per_second = stat([](const Result &r) { return r.bytes_per_second; }, kind);
+		results.push_back(result);
+	}
+
+	return results;
+}
+
+void Bench::write_json(ostream &os, const vector<Result> &results) {
+	char host[256] = "unknown";
+	gethostname(host, sizeof(host) - 1);
+
+	char date[64];
+	const time_t now = time(nullptr);
+	strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+
+	os << "{" << endl;
+	os << "  \"context\": {" << endl;
+	os << "    \"date\": \"" << date << "\"," << endl;
+	os << "    \"host_name\": \"" << host << "\"," << endl;
+	os << "    \"num_cpus\": " << thread::hardware_concurrency() << "," << endl;
+	os << "    \"imaudio_version\": \"" << BENCH_VERSION << "\"," << endl;
+#ifdef NDEBUG
+	os << "    \"library_build_type\": \"release\"" << endl;
+#else
+	os << "    \"library_build_type\": \"debug\"" << endl;
+#endif
+	os << "  }," << endl;
+	os << "  \"benchmarks\": [" << endl;
+
+	os << setprecision(10);
+	for (size_t i = 0; i < results.size(); i++) {
+		auto &result = results[i];
+		os << "    {" << endl;
+		os << "      \"name\": \"" << result.name << "\"," << endl;
+		os << "      \"run_type\": \"" << (result.aggregate.empty() ? "iteration" : "aggregate") << "\"," << endl;
+		if (!result.aggregate.empty()) {
+			os << "      \"aggregate_name\": \"" << result.aggregate << "\"," << endl;
+		}
+
+		os << "      \"iterations\": " << result.iterations << "," << endl;
+		os << "      \"real_time\": " << result.real_time << "," << endl;
+		os << "      \"cpu_time\": " << result.cpu_time << "," << endl;
+		if (result.items_per_second > 0.0) {
+			os << "      \"items_per_second\": " << result.items_per_second << "," << endl;
+		}
+
+		if (result.bytes_per_second > 0.0) {
+			os << "      \"bytes_per_second\": " << result.bytes_per_second << "," << endl;
+		}
+
+		os << "      \"time_unit\": \"ns\"" << endl;
+		os << "    }" << (i + 1 < results.size() ? "," : "") << endl;
+	}
+
+	os << "  ]" << endl;
+	os << "}" << endl;
+}
+
+int Bench::main(int argc, char **argv) {
+	string filter = ".*";
+	string out;
+	double min_time = 0.5;
+	size_t repetitions = 1;
+	bool list = false;
+
+	for (int i = 1; i < argc; i++) {
+		const string arg = argv[i];
+		const string value = arg.substr(arg.find('=') + 1);
+		if (arg.compare(0, 9, "--filter=") == 0) {
+			filter = value;
+		} else if (arg.compare(0, 11, "--min_time=") == 0) {
+			min_time = stod(value);
+		} else if (arg.compare(0, 14, "--repetitions=") == 0) {
+			repetitions = max(1ul, stoul(value));
+		} else if (arg.compare(0, 6, "--out=") == 0) {
+			out = value;
+		} else if (arg == "--list") {
+			list = true;
+		} else if (arg.compare(0, 2, "--") == 0) {
+			cerr << "Unknown option: " << arg << endl;
+			return 1;
+		}
+	}
+
+	const regex pattern(filter);
+	vector<Result> results;
+	for (auto &entry : entries()) {
+		if (!regex_search(entry.name, pattern)) {
+			continue;
+		}
+
+		if (list) {
+			cout << entry.name << endl;
+			continue;
+		}
+
+		vector<Result> runs;
+		for (size_t r = 0; r < repetitions; r++) {
+			runs.push_back(measure(entry, min_time));
+
+			auto &result = runs.back();
+			cerr << left << setw(40) << result.name << right << setw(16) << fixed << setprecision(0)
+				<< result.real_time << " ns" << setw(12) << result.iterations;
+			if (result.items_per_second > 0.0) {
+				cerr << setw(20) << format_rate(result.items_per_second, "items");
+			}
+
+			if (result.bytes_per_second > 0.0) {
+				cerr << setw(16) << format_rate(result.bytes_per_second, "B");
+			}
+
+			cerr << endl;
+		}
+
+		results.insert(results.end(), runs.begin(), runs.end());
+		if (repetitions > 1) {
+			auto stats = aggregate(runs);
+			results.insert(results.end(), stats.begin(), stats.end());
+		}
+	}
+
+	if (list) {
+		return 0;
+	}
+
+	if (out.empty()) {
+		write_json(cout, results);
+	} else {
+		ofstream os(out);
+		if (!os.is_open()) {
+			cerr << "Failed to open " << out << " for writing." << endl;
+			return 1;
+		}
+
+		write_json(os, results);
+	}
+
+	return 0;
+}
@@ -0,0 +1,200 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <chrono>
+#include <time.h>
+
+using namespace std;
+
+/**
+ * State handed to a benchmark while it runs. A benchmark does its setup,
+ * then loops on keep_running(), timing only the loop:
+ *
+ * 	while (state.keep_running()) {
+ * 		... code to measure ...
+ * 	}
+ *
+ * and finally reports how much work a single iteration did through
+ * set_items_processed(...) and set_bytes_processed(...), which the
+ * runner turns into rates.
+ */
+class BenchState {
+public:
+	/**
+	 * \param Iterations Number of times keep_running() returns true.
+	 * \param Arg Argument of this variant of the benchmark (see Bench::add(...)).
+	 */
+	BenchState(size_t Iterations, long Arg) : iterations{Iterations}, arg{Arg},
+		iteration{0}, items{0}, bytes{0}, real_time{0.0}, cpu_time{0.0} { }
+
+	/**
+	 * Starts the timers on the first call, and stops them once every
+	 * iteration has run.
+	 * \return Whether or not another iteration should run.
+	 */
+	bool keep_running() {
+		if (iteration == 0) {
+			resume_timing();
+		}
+
+		if (iteration < iterations) {
+			iteration++;
+			return true;
+		}
+
+		pause_timing();
+		return false;
+	}
+
+	/**
+	 * Stops the timers, for setup work inside the loop that should not be measured.
+	 */
+	void pause_timing() {
+		real_time += chrono::duration<double>(chrono::steady_clock::now() - real_start).count();
+		cpu_time += process_time() - cpu_start;
+	}
+
+	/**
+	 * Restarts the timers stopped by pause_timing().
+	 */
+	void resume_timing() {
+		real_start = chrono::steady_clock::now();
+		cpu_start = process_time();
+	}
+
+	/**
+	 * \param Items Number of items (samples, files, ...) handled by a single iteration.
+	 */
+	void set_items_processed(size_t Items) {
+		items = Items;
+	}
+
+	/**
+	 * \param Bytes Number of bytes read or written by a single iteration.
+	 */
+	void set_bytes_processed(size_t Bytes) {
+		bytes = Bytes;
+	}
+
+	/**
+	 * \return The argument of this variant of the benchmark.
+	 */
+	inline long get_arg() const {
+		return arg;
+	}
+
+	/**
+	 * \return The number of iterations this run will make.
+	 */
+	inline size_t get_iterations() const {
+		return iterations;
+	}
+
+private:
+	friend class Bench;
+
+	/**
+	 * \return The CPU time used by the process so far, in seconds.
+	 */
+	static double process_time() {
+		timespec ts;
+		clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+		return ts.tv_sec + ts.tv_nsec * 1e-9;
+	}
+
+	size_t iterations; /**< Iterations to run. */
+	long arg; /**< Argument of the variant being run. */
+	size_t iteration; /**< Iterations started so far. */
+	size_t items; /**< Items handled per iteration. */
+	size_t bytes; /**< Bytes handled per iteration. */
+	double real_time; /**< Wall clock time measured, in seconds. */
+	double cpu_time; /**< Process CPU time measured, in seconds. */
+	chrono::steady_clock::time_point real_start; /**< Start of the current timed section. */
+	double cpu_start; /**< CPU time at the start of the current timed section. */
+};
+
+/**
+ * Minimal benchmark runner, modeled on Google Benchmark so its JSON
+ * output can be tracked with the same tools.
+ * Benchmarks are registered with add(...) and run by main(...), each one
+ * is run with a growing number of iterations until a run takes at least
+ * the minimum time, and that run is reported. The output is a JSON object
+ * holding a "context" (date, host, build) and a "benchmarks" array with the
+ * name, iterations, real_time and cpu_time (nanoseconds per iteration) and
+ * items_per_second / bytes_per_second of every benchmark. A summary table
+ * is printed to the standard error while running.
+ */
+class Bench {
+public:
+	/**
+	 * Registers a benchmark. With arguments, one variant named "name/arg"
+	 * is registered per argument, and the argument is given through
+	 * BenchState::get_arg().
+	 * \param name Name of the benchmark.
+	 * \param body Function running the benchmark.
+	 * \param args Arguments of each variant, if any.
+	 */
+	static void add(string name, function<void(BenchState&)> body, vector<long> args = vector<long>());
+
+	/**
+	 * Runs the registered benchmarks, as asked by the command line:
+	 * 	--filter=<regex> only runs the benchmarks whose name matches.
+	 * 	--min_time=<s> minimum time of a measured run (0.5 seconds by default).
+	 * 	--repetitions=<n> measures every benchmark <n> times, and adds the
+	 * 		mean, median and standard deviation of the repetitions.
+	 * 	--out=<file> writes the JSON to <file> instead of the standard output.
+	 * 	--list only prints the names of the benchmarks.
+	 * \return The exit status of the program.
+	 */
+	static int main(int argc, char **argv);
+
+private:
+	/**
+	 * A single registered variant.
+	 */
+	struct Entry {
+		string name; /**< Name, including the argument. */
+		function<void(BenchState&)> body; /**< Function running the benchmark. */
+		long arg; /**< Argument given to the body. */
+	};
+
+	/**
+	 * Result of a measured run.
+	 */
+	struct Result {
+		string name; /**< Name reported in the JSON. */
+		string aggregate; /**< "mean", "median" or "stddev" for aggregates, empty otherwise. */
+		size_t iterations; /**< Iterations of the run. */
+		double real_time; /**< Wall clock nanoseconds per iteration. */
+		double cpu_time; /**< CPU nanoseconds per iteration. */
+		double items_per_second; /**< Items per second, 0 if not reported. */
+		double bytes_per_second; /**< Bytes per second, 0 if not reported. */
+	};
+
+	/**
+	 * Runs a benchmark with more and more iterations until a run
+	 * lasts at least 'min_time' seconds.
+	 * \return The result of the last run.
+	 */
+	static Result measure(const Entry &entry, double min_time);
+
+	/**
+	 * \return The mean, median and standard deviation of the repetitions of a benchmark.
+	 */
+	static vector<Result> aggregate(const vector<Result> &runs);
+
+	/**
+	 * Writes the results as a JSON document.
+	 */
+	static void write_json(ostream &os, const vector<Result> &results);
+
+	/**
+	 * \return Every registered benchmark.
+	 */
+	static vector<Entry>& entries();
+};
+
+#endif
@@ -0,0 +1,401 @@
+#include <CS229Reader.h>
+#include <CS229Writer.h>
+#include <WavReader.h>
+#include <WavWriter.h>
+#include <ABC229Reader.h>
+#include <func/SinWave.h>
+#include <func/TriangleWave.h>
+#include <func/SawToothWave.h>
+#include <func/PulseWave.h>
+#include <func/BlockRenderer.h>
+#include <BlockRing.h>
+#include <BlockQueue.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <stdlib.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <math.h>
+
+#include "Bench.h"
+
+// one second of audio per fixture, at the most common sample rate
+static const size_t SAMPLE_RATE = 44100;
+static const size_t FRAMES = SAMPLE_RATE;
+static const vector<long> BIT_DEPTHS = { 8, 16, 32 };
+// blocks streamed from one thread to another by every transfer benchmark
+static const size_t TRANSFER_BLOCKS = 256;
+
+AudioFile make_file(size_t bit_res, size_t num_channels, size_t frames);
+string make_score(size_t num_instruments, size_t num_notes);
+string format_file(iFileWriter &&writer, AudioFile &file);
+void add_format_benchmarks();
+void add_kernel_benchmarks();
+void add_render_benchmarks();
+void add_transfer_benchmarks();
+void add_tool_benchmarks(string bin);
+void remove_fixtures();
+
+static string fixture_dir; /**< Directory holding the files used by the tool benchmarks. */
+static vector<string> fixtures; /**< Files created in 'fixture_dir'. */
+
+int main(int argc, char ** argv) {
+	add_format_benchmarks();
+	add_kernel_benchmarks();
+	add_render_benchmarks();
+	add_transfer_benchmarks();
+
+	// the tools are run from the bin/ directory next to this benchmark
+	string self = argv[0];
+	add_tool_benchmarks(string(dirname(&self[0])) + "/../bin");
+
+	const int status = Bench::main(argc, argv);
+	remove_fixtures();
+	return status;
+}
+
+AudioFile make_file(size_t bit_res, size_t num_channels, size_t frames) {
+	AudioFile file = AudioFile("bench", ".cs229", SAMPLE_RATE, bit_res, num_channels);
+	const double amplitude = ((1L << (bit_res - 1)) - 1) * 0.5;
+
+	// a tone per channel at half scale, so sums of two files still fit
+	for (size_t c = 0; c < num_channels; c++) {
+		file[c].resize(frames);
+		long * data = file[c].data();
+		for (size_t i = 0; i < frames; i++) {
+			data[i] = lround(amplitude * sin(2 * M_PI * 440.0 * (c + 1) * i / SAMPLE_RATE));
+		}
+	}
+
+	return file;
+}
+
+string make_score(size_t num_instruments, size_t num_notes) {
+	static const char * waves[] = { "Sine", "Triangle", "Sawtooth", "PulseWave" };
+	static const char * notes[] = { "C", "D", "E", "F", "G", "A", "B", "c" };
+
+	stringstream ss;
+	ss << "ABC229" << endl << "Tempo 240" << endl;
+	for (size_t k = 0; k < num_instruments; k++) {
+		ss << "Instrument " << k << endl;
+		ss << "Waveform " << waves[k % 4] << endl;
+		ss << "Volume 0.2" << endl << "Attack 0.01" << endl << "Release 0.01" << endl;
+		ss << "Score" << endl << "[" << endl;
+		for (size_t n = 0; n < num_notes; n++) {
+			ss << notes[(n + k) % 8] << " ";
+		}
+
+		ss << endl << "]" << endl;
+	}
+
+	return ss.str();
+}
+
+string format_file(iFileWriter &&writer, AudioFile &file) {
+	stringstream ss;
+	writer.write_file(file, ss);
+	return ss.str();
+}
+
+void add_format_benchmarks() {
+	Bench::add("CS229Reader/read_file", [](BenchState &state) {
+		AudioFile file = make_file(state.get_arg(), 2, FRAMES);
+		const string data = format_file(CS229Writer(), file);
+		while (state.keep_running()) {
+			istringstream is(data);
+			CS229Reader().read_file(is);
+		}
+
+		state.set_items_processed(FRAMES * 2);
+		state.set_bytes_processed(data.size());
+	}, BIT_DEPTHS);
+
+	Bench::add("WavReader/read_file", [](BenchState &state) {
+		AudioFile file = make_file(state.get_arg(), 2, FRAMES);
+		const string data = format_file(WavWriter(), file);
+		while (state.keep_running()) {
+			istringstream is(data);
+			WavReader().read_file(is);
+		}
+
+		state.set_items_processed(FRAMES * 2);
+		state.set_bytes_processed(data.size());
+	}, BIT_DEPTHS);
+
+	Bench::add("CS229Reader/read_block", [](BenchState &state) {
+		AudioFile file = make_file(state.get_arg(), 2, FRAMES);
+		const string data = format_file(CS229Writer(), file);
+		SampleBlock block = SampleBlock(2, STREAM_BLOCK_SIZE);
+		while (state.keep_running()) {
+			istringstream is(data);
+			CS229Reader reader;
+			reader.open(is);
+			while (reader.read_block(block) > 0) { }
+		}
+
+		state.set_items_processed(FRAMES * 2);
+		state.set_bytes_processed(data.size());
+	}, { 16 });
+
+	Bench::add("WavReader/read_block", [](BenchState &state) {
+		AudioFile file = make_file(state.get_arg(), 2, FRAMES);
+		const string data = format_file(WavWriter(), file);
+		SampleBlock block = SampleBlock(2, STREAM_BLOCK_SIZE);
+		while (state.keep_running()) {
+			istringstream is(data);
+			WavReader reader;
+			reader.open(is);
+			while (reader.read_block(block) > 0) { }
+		}
+
+		state.set_items_processed(FRAMES * 2);
+		state.set_bytes_processed(data.size());
+	}, { 16 });
+
+	Bench::add("CS229Writer/write_file", [](BenchState &state) {
+		AudioFile file = make_file(state.get_arg(), 2, FRAMES);
+		size_t bytes = 0;
+		while (state.keep_running()) {
+			bytes = format_file(CS229Writer(), file).size();
+		}
+
+		state.set_items_processed(FRAMES * 2);
+		state.set_bytes_processed(bytes);
+	}, BIT_DEPTHS);
+
+	Bench::add("WavWriter/write_file", [](BenchState &state) {
+		AudioFile file = make_file(state.get_arg(), 2, FRAMES);
+		size_t bytes = 0;
+		while (state.keep_running()) {
+			bytes = format_file(WavWriter(), file).size();
+		}
+
+		state.set_items_processed(FRAMES * 2);
+		state.set_bytes_processed(bytes);
+	}, BIT_DEPTHS);
+
+	Bench::add("ABC229Reader/read_file", [](BenchState &state) {
+		const string score = make_score(4, 64);
+		size_t frames = 0;
+		while (state.keep_running()) {
+			istringstream is(score);
+			frames = ABC229Reader(SAMPLE_RATE, state.get_arg()).read_file(is).get_num_samples();
+		}
+
+		state.set_items_processed(frames * 4);
+		state.set_bytes_processed(score.size());
+	}, { 16 });
+}
+
+void add_kernel_benchmarks() {
+	Bench::add("Channel/add", [](BenchState &state) {
+		AudioFile file = make_file(state.get_arg(), 2, FRAMES);
+		while (state.keep_running()) {
+			file[0] + file[1];
+		}
+
+		state.set_items_processed(FRAMES);
+	}, BIT_DEPTHS);
+
+	Bench::add("Channel/multiply", [](BenchState &state) {
+		AudioFile file = make_file(state.get_arg(), 1, FRAMES);
+		Channel ones = Channel(state.get_arg());
+		for (size_t i = 0; i < FRAMES; i++) {
+			ones.push_sample(1);
+		}
+
+		while (state.keep_running()) {
+			file[0] * ones;
+		}
+
+		state.set_items_processed(FRAMES);
+	}, BIT_DEPTHS);
+
+	Bench::add("Channel/scale", [](BenchState &state) {
+		AudioFile file = make_file(state.get_arg(), 1, FRAMES);
+		while (state.keep_running()) {
+			file[0] * 0.5;
+		}
+
+		state.set_items_processed(FRAMES);
+	}, BIT_DEPTHS);
+
+	Bench::add("AudioFile/mix", [](BenchState &state) {
+		AudioFile a = make_file(state.get_arg(), 2, FRAMES);
+		AudioFile b = make_file(state.get_arg(), 2, FRAMES);
+		while (state.keep_running()) {
+			(a * 0.5) + (b * 0.5);
+		}
+
+		state.set_items_processed(FRAMES * 2);
+	}, BIT_DEPTHS);
+
+	Bench::add("Channel/convert_bit_res", [](BenchState &state) {
+		AudioFile file = make_file(32, 1, FRAMES);
+		while (state.keep_running()) {
+			file[0].convert_bit_res(state.get_arg(), true);
+		}
+
+		state.set_items_processed(FRAMES);
+	}, { 8, 16 });
+}
+
+void add_render_benchmarks() {
+	// every waveform, through the same dispatch ABC229Reader uses
+	static const vector<pair<string, function<iWaveform*()>>> waves = {
+		{ "sine", []() -> iWaveform* { return new SinWave(1000.0, 440.0); } },
+		{ "triangle", []() -> iWaveform* { return new TriangleWave(1000.0, 440.0); } },
+		{ "sawtooth", []() -> iWaveform* { return new SawToothWave(1000.0, 440.0); } },
+		{ "pulse", []() -> iWaveform* { return new PulseWave(1000.0, 440.0, 0.25); } }
+	};
+
+	for (auto &wave : waves) {
+		auto make_wave = wave.second;
+		Bench::add("render/" + wave.first, [make_wave](BenchState &state) {
+			unique_ptr<iWaveform> wave(make_wave());
+			AdsrEnvelope env = AdsrEnvelope(0.1, 0.1, 0.5, 0.1, 1.0);
+			double block[RENDER_BLOCK_SIZE];
+			while (state.keep_running()) {
+				for (size_t start = 0; start < FRAMES; start += RENDER_BLOCK_SIZE) {
+					const size_t count = min((size_t)RENDER_BLOCK_SIZE, FRAMES - start);
+					render_waveform_block(*wave, &env, 0.5, start, SAMPLE_RATE, block, count);
+				}
+			}
+
+			state.set_items_processed(FRAMES);
+		});
+	}
+}
+
+void add_transfer_benchmarks() {
+	// a producer thread fills stereo blocks as a decoder would, the consumer hands them straight back
+	static const size_t frames = TRANSFER_BLOCKS * STREAM_BLOCK_SIZE;
+	static const size_t bytes = frames * 2 * sizeof(long);
+	static const vector<pair<string, RingWait>> waits = {
+		{ "blocking", RING_BLOCK },
+		{ "spinning", RING_SPIN }
+	};
+
+	for (auto &wait : waits) {
+		const RingWait mode = wait.second;
+		Bench::add("BlockRing/" + wait.first, [mode](BenchState &state) {
+			while (state.keep_running()) {
+				BlockRing ring(2, STREAM_BLOCK_SIZE, PIPELINE_QUEUE_BLOCKS, mode);
+				thread producer([&ring]() {
+					for (size_t i = 0; i < TRANSFER_BLOCKS; i++) {
+						SampleBlock *block = ring.acquire();
+						fill(block->channel(0), block->channel(0) + STREAM_BLOCK_SIZE, (long)i);
+						fill(block->channel(1), block->channel(1) + STREAM_BLOCK_SIZE, (long)i);
+						block->set_frames(STREAM_BLOCK_SIZE);
+						ring.push(block);
+					}
+
+					ring.close();
+				});
+
+				SampleBlock *block = nullptr;
+				while ((block = ring.pop()) != nullptr) {
+					ring.release(block);
+				}
+
+				producer.join();
+			}
+
+			state.set_items_processed(frames);
+			state.set_bytes_processed(bytes);
+		});
+	}
+
+	// the same stream through the queue between the stages of a Pipeline
+	Bench::add("BlockQueue/transfer", [](BenchState &state) {
+		while (state.keep_running()) {
+			BlockQueue queue;
+			thread producer([&queue]() {
+				queue.begin({SAMPLE_RATE, 16, 2, (long)frames});
+				for (size_t i = 0; i < TRANSFER_BLOCKS; i++) {
+					SampleBlock *block = queue.acquire();
+					fill(block->channel(0), block->channel(0) + STREAM_BLOCK_SIZE, (long)i);
+					fill(block->channel(1), block->channel(1) + STREAM_BLOCK_SIZE, (long)i);
+					block->set_frames(STREAM_BLOCK_SIZE);
+					queue.push(block);
+				}
+
+				queue.close();
+			});
+
+			queue.get_header();
+			SampleBlock *block = nullptr;
+			while ((block = queue.pop()) != nullptr) {
+				queue.release(block);
+			}
+
+			producer.join();
+		}
+
+		state.set_items_processed(frames);
+		state.set_bytes_processed(bytes);
+	});
+}
+
+void add_tool_benchmarks(string bin) {
+	if (access((bin + "/sndinfo").c_str(), X_OK) != 0) {
+		cerr << "Tools not found in " << bin << ", skipping the tool benchmarks." << endl;
+		return;
+	}
+
+	char dir[] = "/tmp/imbench.XXXXXX";
+	if (!mkdtemp(dir)) {
+		cerr << "Failed to create a fixture directory, skipping the tool benchmarks." << endl;
+		return;
+	}
+
+	// ten seconds of stereo 16 bit audio, in both formats, and a score
+	fixture_dir = dir;
+	AudioFile file = make_file(16, 2, FRAMES * 10);
+	CS229Writer().write_file(file, fixture_dir + "/in.cs229");
+	WavWriter().write_file(file, fixture_dir + "/in.wav");
+	ofstream(fixture_dir + "/in.abc229") << make_score(4, 64);
+	fixtures = { "in.cs229", "in.wav", "in.abc229", "out.cs229", "out.wav" };
+
+	const string in = fixture_dir + "/in";
+	const string out = " -o " + fixture_dir + "/out";
+	const vector<pair<string, string>> tools = {
+		{ "sndinfo", "sndinfo " + in + ".cs229 " + in + ".wav" },
+		{ "sndinfo_stats", "sndinfo --stats " + in + ".cs229" },
+		{ "sndcat", "sndcat " + in + ".cs229 " + in + ".cs229" + out + ".cs229" },
+		{ "sndmix", "sndmix " + in + ".cs229 0.5 " + in + ".cs229 0.5" + out + ".cs229" },
+		{ "sndcvt", "sndcvt " + in + ".cs229" + out + ".wav" },
+		{ "sndgen", "sndgen --bits 16 --sr 44100 --sine -f 440 -t 10" + out + ".cs229" },
+		{ "sndplay", "sndplay --bits 16 --sr 44100 " + in + ".abc229" + out + ".cs229" }
+	};
+
+	for (auto &tool : tools) {
+		const string command = bin + "/" + tool.second + " > /dev/null 2>&1";
+		Bench::add("tool/" + tool.first, [command](BenchState &state) {
+			while (state.keep_running()) {
+				if (system(command.c_str()) != 0) {
+					cerr << "Failed: " << command << endl;
+					exit(1);
+				}
+			}
+
+			state.set_items_processed(1);
+		});
+	}
+}
+
+void remove_fixtures() {
+	if (fixture_dir.empty()) {
+		return;
+	}
+
+	for (auto &name : fixtures) {
+		unlink((fixture_dir + "/" + name).c_str());
+	}
+
+	rmdir(fixture_dir.c_str());
+}
@@ -0,0 +1,44 @@
+# Build configuration shared by every Makefile of the project.
+# Variables may be given on the command line of any make call, and are
+# passed down to the Makefile of every project by the root Makefile.
+#
+#   BUILD=debug     -g without optimization (default)
+#   BUILD=release   -O3 with link time optimization across libimaudio.a and the tools
+#   NATIVE=1        also tune the code for the building machine (-march=native)
+#   PGO=gen|use     profile guided optimization, see the 'pgo' target of the root Makefile
+#
+# Objects do not depend on these flags, run 'make clean' when changing them.
+
+BUILD ?= debug
+NATIVE ?= 0
+PGO ?=
+
+# training profiles of PGO=gen, read back by PGO=use
+PGO_DIR ?= $(abspath $(dir $(lastword $(MAKEFILE_LIST))))/pgo
+
+ifeq ($(BUILD),release)
+OPT_FLAGS = -O3 -DNDEBUG -flto=auto
+LINK_FLAGS = -O3 -flto=auto
+AR = gcc-ar
+else ifeq ($(BUILD),debug)
+OPT_FLAGS = -g -O0
+LINK_FLAGS = -g
+AR = ar
+else
+$(error BUILD must be either debug or release)
+endif
+
+ifeq ($(NATIVE),1)
+OPT_FLAGS += -march=native
+LINK_FLAGS += -march=native
+endif
+
+ifeq ($(PGO),gen)
+OPT_FLAGS += -fprofile-generate=$(PGO_DIR) -fprofile-update=atomic
+LINK_FLAGS += -fprofile-generate=$(PGO_DIR)
+else ifeq ($(PGO),use)
+OPT_FLAGS += -fprofile-use=$(PGO_DIR) -fprofile-correction -Wno-missing-profile
+LINK_FLAGS += -fprofile-use=$(PGO_DIR)
+else ifneq ($(PGO),)
+$(error PGO must be either gen or use)
+endif
@@ -0,0 +1,437 @@
+#include <getopt.h>
+#include <math.h>
+#include <string.h>
+
+#include <CS229Reader.h>
+#include <WavReader.h>
+#include <ABC229Reader.h>
+#include <AudioInfo.h>
+#include <RenderGraph.h>
+#include <func/SinWave.h>
+#include <func/TriangleWave.h>
+#include <func/SawToothWave.h>
+#include <func/PulseWave.h>
+#include <func/AdsrEnvelope.h>
+#include <flags.h>
+
+#include "Commands.h"
+
+static void run_info(vector<string> &args, unique_ptr<AudioFile> &audio, ostream &os);
+static void run_cat(vector<string> &args, unique_ptr<AudioFile> &audio, ostream &os);
+static void run_mix(vector<string> &args, unique_ptr<AudioFile> &audio, ostream &os);
+static void run_gen(vector<string> &args, unique_ptr<AudioFile> &audio, ostream &os);
+static void run_play(vector<string> &args, unique_ptr<AudioFile> &audio, ostream &os);
+static void run_cvt(vector<string> &args, unique_ptr<AudioFile> &audio, ostream &os);
+
+static const vector<Command> commands = {
+	{ "info", "[file...]", "Print the information of the piped audio and of each file, the audio is passed on.", false, run_info },
+	{ "cat", "[file...]", "Append each file to the piped audio (or read the standard input when there is neither).", true, run_cat },
+	{ "mix", "[-f policy] [mult] [file mult...]", "Mix the piped audio (scaled by the first mult) with every file.", true, run_mix },
+	{ "gen", "--bits=n --sr=n --sine|--triangle|--sawtooth|--pulse [sndgen options]", "Generate a waveform.", true, run_gen },
+	{ "play", "--bits=n --sr=n [-m channel] [file]", "Render an .abc229 score (from the standard input without a file).", true, run_play },
+	{ "cvt", "--bits=n [-d] [file]", "Convert the piped audio (or the file) to another bit resolution.", true, run_cvt },
+};
+
+const Command * find_command(const string &name) {
+	for (auto &command : commands) {
+		if (name == command.name) {
+			return &command;
+		}
+	}
+
+	return nullptr;
+}
+
+const vector<Command> & get_commands() {
+	return commands;
+}
+
+/**
+ * Builds the argv of getopt_long(...) for the arguments of a command, and resets getopt
+ * so that it scans them from the start. The strings of 'args' must outlive the result.
+ * \param name Name of the command, used as argv[0].
+ * \param args Arguments of the command.
+ * \return The argv, followed by a null pointer.
+ */
+static vector<char *> make_argv(const char *name, vector<string> &args) {
+	vector<char *> argv = { const_cast<char *>(name) };
+	for (auto &arg : args) {
+		argv.push_back(&arg[0]);
+	}
+
+	argv.push_back(nullptr);
+	optind = 0;
+	return argv;
+}
+
+static double get_double_from_string(string data) {
+	size_t next_index;
+	auto val = stod(data, &next_index);
+
+	if (next_index != data.length() || !data.length()) {
+		throw invalid_argument("paremter does not contain a valid double");
+	}
+
+	return val;
+}
+
+static long get_long_from_string(string data) {
+	size_t next_index;
+	auto val = stol(data, &next_index);
+
+	if (next_index != data.length() || !data.length()) {
+		throw invalid_argument("paremter does not contain a valid long");
+	}
+
+	return val;
+}
+
+static double get_scalar(const string &data) {
+	auto scalar = get_double_from_string(data);
+	if (scalar < -10.0 || scalar > 10.0) {
+		throw invalid_argument("scalar must exist within range (-10.0, 10.0)");
+	}
+
+	return scalar;
+}
+
+/**
+ * Reads a file given as "name", "name@start" or "name@start:length" (see iBlockReader::open_range(...)).
+ * Names ending in .wav are read as .wav files, anything else as a .cs229 file.
+ * \param spec Name of the file, optionally followed by a range.
+ * \return The frames of the file (or of its range).
+ */
+static AudioFile read_input(const string &spec) {
+	const string name = spec.substr(0, spec.rfind('@'));
+	unique_ptr<iBlockReader> reader;
+	if (name.length() >= 4 && name.compare(name.length() - 4, 4, ".wav") == 0) {
+		reader.reset(new WavReader());
+	} else {
+		reader.reset(new CS229Reader());
+	}
+
+	reader->open_range(spec);
+	return reader->read_rest();
+}
+
+/**
+ * Replaces the piped audio with the input file, or combines both.
+ * \param audio Result of the previous stage, null if there is none.
+ * \param file Audio to add to the pipeline.
+ * \param combine How to combine the piped audio with the file.
+ */
+template <typename Combine>
+static void combine_into(unique_ptr<AudioFile> &audio, AudioFile &&file, Combine combine) {
+	if (audio) {
+		audio.reset(new AudioFile(combine(*audio, file)));
+	} else {
+		audio.reset(new AudioFile(move(file)));
+	}
+}
+
+static void run_info(vector<string> &args, unique_ptr<AudioFile> &audio, ostream &os) {
+	if (audio) {
+		os << *audio << endl;
+	}
+
+	for (auto &file : args) {
+		os << AudioInfo::probe(file) << endl;
+	}
+
+	if (!audio && args.empty()) {
+		os << AudioInfo::probe(cin) << endl;
+	}
+}
+
+static void run_cat(vector<string> &args, unique_ptr<AudioFile> &audio, ostream &os) {
+	auto concat = [](AudioFile &a, AudioFile &b) { return a.concat(b); };
+	for (auto &spec : args) {
+		combine_into(audio, read_input(spec), concat);
+	}
+
+	// like sndcat, a pipeline starting with cat reads its input from the standard input
+	if (!audio) {
+		string extension;
+		audio.reset(new AudioFile(AudioInfo::open_reader(cin, "std::cin", extension)->read_rest()));
+	}
+}
+
+static void run_mix(vector<string> &args, unique_ptr<AudioFile> &audio, ostream &os) {
+	static struct option long_options[] = {
+		{ "overflow", required_argument, 0, 'f' },
+		{ 0, 0, 0, 0 }
+	};
+
+	auto argv = make_argv("mix", args);
+	int c = 0;
+	while ((c = getopt_long(argv.size() - 1, argv.data(), "f:", long_options, nullptr)) != -1) {
+		if (c != 'f') {
+			throw invalid_argument("mix: unknown option");
+		}
+
+		const string policy = optarg;
+		if (policy == "throw") {
+			overflow_policy = OVERFLOW_THROW;
+		} else if (policy == "clip") {
+			overflow_policy = OVERFLOW_SATURATE;
+		} else if (policy == "limit") {
+			overflow_policy = OVERFLOW_LIMIT;
+		} else {
+			throw invalid_argument("overflow must be one of throw, clip or limit");
+		}
+	}
+
+	// the piped audio takes the first multiplier, then every file comes with its own
+	vector<string> operands(argv.begin() + optind, argv.end() - 1);
+	size_t next = 0;
+	if (audio) {
+		if (operands.empty()) {
+			throw invalid_argument("mix requires a multiplier for the piped audio");
+		}
+
+		audio.reset(new AudioFile(*audio * get_scalar(operands[next++])));
+	}
+
+	if ((operands.size() - next) % 2 == 1 || (!audio && operands.empty())) {
+		throw invalid_argument("mix requires a multiplier for every file");
+	}
+
+	for (; next < operands.size(); next += 2) {
+		AudioFile file = read_input(operands[next]);
+		combine_into(audio, file * get_scalar(operands[next + 1]), [](AudioFile &a, AudioFile &b) { return a + b; });
+	}
+}
+
+static void run_gen(vector<string> &args, unique_ptr<AudioFile> &audio, ostream &os) {
+	int sine = 0, triangle = 0, sawtooth = 0, pulse = 0;
+	struct option long_options[] = {
+		{ "bits",		required_argument,	0,			'b' },
+		{ "sr",			required_argument,	0,			'S' },
+		{ "sine",		no_argument,		&sine,		1 },
+		{ "triangle",	no_argument,		&triangle,	1 },
+		{ "sawtooth",	no_argument,		&sawtooth,	1 },
+		{ "pulse",		no_argument,		&pulse,		1 },
+		{ "pf",			required_argument,	0,			'p' },
+		{ 0, 0, 0, 0 }
+	};
+
+	size_t bit_res = 0;
+	size_t sample_rate = 0;
+	double frequency = 1.0;
+	double time_duration = 1.0;
+	double volume = 1.0;
+	double pulse_ratio = -1.0;
+	bool use_adsr = false;
+	double a = -1.0, d = -1.0, s = -1.0, r = -1.0;
+
+	auto argv = make_argv("gen", args);
+	int c = 0;
+	while ((c = getopt_long(argv.size() - 1, argv.data(), "f:t:v:a:d:s:r:p:", long_options, nullptr)) != -1) {
+		switch (c) {
+		case 0:
+			break;
+
+		case 'b':
+			bit_res = (size_t)get_long_from_string(string(optarg));
+			break;
+
+		case 'S':
+			sample_rate = (size_t)get_long_from_string(string(optarg));
+			break;
+
+		case 'f':
+			frequency = get_double_from_string(string(optarg));
+			break;
+
+		case 't':
+			time_duration = get_double_from_string(string(optarg));
+			break;
+
+		case 'v':
+			volume = get_double_from_string(string(optarg));
+			break;
+
+		case 'a':
+			use_adsr = true;
+			a = get_double_from_string(string(optarg));
+			break;
+
+		case 'd':
+			use_adsr = true;
+			d = get_double_from_string(string(optarg));
+			break;
+
+		case 's':
+			use_adsr = true;
+			s = get_double_from_string(string(optarg));
+			break;
+
+		case 'r':
+			use_adsr = true;
+			r = get_double_from_string(string(optarg));
+			break;
+
+		case 'p':
+			pulse_ratio = get_double_from_string(string(optarg));
+			break;
+
+		default:
+			throw invalid_argument("gen: unknown option");
+		}
+	}
+
+	if ((size_t)optind != args.size() + 1) {
+		throw invalid_argument("gen does not take any file");
+	}
+
+	// same rules as sndgen
+	if (!bit_res || !sample_rate) {
+		throw invalid_argument("non-zero bit_res and sample_rate are required to create a new file.");
+	}
+
+	if (volume < 0.0 || volume > 1.0) {
+		throw invalid_argument("-v requires a value in range [0.0, 1.0]");
+	}
+
+	if (pulse && (pulse_ratio < 0 || pulse_ratio > 1.0)) {
+		throw invalid_argument("--pulse option required a valid pulse_ratio specified with --pf or -p");
+	}
+
+	if (use_adsr) {
+		if (a < 0 || d < 0 || s < 0 || r < 0) {
+			throw invalid_argument("if usineg an adsr envelope all options ('-a -d -s -r) must be specified");
+		}
+
+		if (s > 1.0) {
+			throw invalid_argument("sustain time of adsr envelope (option -s) must be within the range [0.0, 1.0]");
+		}
+	}
+
+	double amplitude = ((int)pow(2, bit_res) / 2.0) - 1;
+	unique_ptr<iWaveform> wave;
+	switch (sine * 1000 + triangle * 100 + sawtooth * 10 + pulse * 1) {
+	case 1000:
+		wave.reset(new SinWave(amplitude, frequency));
+		break;
+
+	case 100:
+		wave.reset(new TriangleWave(amplitude, frequency));
+		break;
+
+	case 10:
+		wave.reset(new SawToothWave(amplitude, frequency));
+		break;
+
+	case 1:
+		wave.reset(new PulseWave(amplitude, frequency, pulse_ratio));
+		break;
+
+	default:
+		throw invalid_argument("gen requires one of the following arguments is allowed: '--sine' '--triangle' '--sawtooth' '--pulse'");
+	}
+
+	AdsrEnvelope adsr = AdsrEnvelope(a, d, s, r, time_duration);
+	RenderGraph graph = RenderGraph(wave.get());
+	graph.gain(volume);
+
+	if (use_adsr) {
+		graph.envelope(&adsr);
+	}
+
+	combine_into(audio, graph.render(sample_rate, time_duration, bit_res),
+			[](AudioFile &a, AudioFile &b) { return a.concat(b); });
+}
+
+static void run_play(vector<string> &args, unique_ptr<AudioFile> &audio, ostream &os) {
+	static struct option long_options[] = {
+		{ "bits", required_argument, 0, 'b' },
+		{ "sr", required_argument, 0, 's' },
+		{ "mute", required_argument, 0, 'm' },
+		{ 0, 0, 0, 0 }
+	};
+
+	size_t bit_depth = 0;
+	size_t sample_rate = 0;
+	long mute_index = -1;
+
+	auto argv = make_argv("play", args);
+	int c = 0;
+	while ((c = getopt_long(argv.size() - 1, argv.data(), "b:s:m:", long_options, nullptr)) != -1) {
+		switch (c) {
+		case 'b':
+			bit_depth = (size_t)get_long_from_string(string(optarg));
+			break;
+
+		case 's':
+			sample_rate = (size_t)get_long_from_string(string(optarg));
+			break;
+
+		case 'm':
+			mute_index = get_long_from_string(string(optarg));
+			break;
+
+		default:
+			throw invalid_argument("play: unknown option");
+		}
+	}
+
+	const size_t extra_params = args.size() + 1 - optind;
+	if (!bit_depth || !sample_rate || extra_params > 1) {
+		throw invalid_argument("play requires --bits and --sr, and at most one score");
+	}
+
+	ABC229Reader reader = ABC229Reader(sample_rate, bit_depth);
+	AudioFile score = extra_params ? reader.read_file(string(argv[optind])) : reader.read_file(cin);
+	if (mute_index >= (long)score.get_num_channels()) {
+		throw invalid_argument("-m must be the index of a channel of the score");
+	} else if (mute_index > -1) {
+		score.mute_channel(mute_index);
+	}
+
+	// a score played after other stages is appended to their audio
+	combine_into(audio, move(score), [](AudioFile &a, AudioFile &b) { return a.concat(b); });
+}
+
+static void run_cvt(vector<string> &args, unique_ptr<AudioFile> &audio, ostream &os) {
+	static struct option long_options[] = {
+		{ "bits", required_argument, 0, 'b' },
+		{ "dither", no_argument, 0, 'd' },
+		{ 0, 0, 0, 0 }
+	};
+
+	size_t bit_depth = 0;
+	bool dither = false;
+
+	auto argv = make_argv("cvt", args);
+	int c = 0;
+	while ((c = getopt_long(argv.size() - 1, argv.data(), "b:d", long_options, nullptr)) != -1) {
+		switch (c) {
+		case 'b':
+			bit_depth = (size_t)get_long_from_string(string(optarg));
+			break;
+
+		case 'd':
+			dither = true;
+			break;
+
+		default:
+			throw invalid_argument("cvt: unknown option");
+		}
+	}
+
+	const size_t extra_params = args.size() + 1 - optind;
+	if (extra_params > 1 || (audio && extra_params)) {
+		throw invalid_argument("cvt converts either the piped audio or a single file");
+	}
+
+	if (extra_params) {
+		audio.reset(new AudioFile(read_input(argv[optind])));
+	} else if (!audio) {
+		string extension;
+		audio.reset(new AudioFile(AudioInfo::open_reader(cin, "std::cin", extension)->read_rest()));
+	}
+
+	if (bit_depth && bit_depth != audio->get_bit_res()) {
+		audio.reset(new AudioFile(audio->convert_bit_res(bit_depth, dither)));
+	}
+}
@@ -0,0 +1,45 @@
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <AudioFile.h>
+
+using namespace std;
+
+/**
+ * A subcommand of the imaudio driver, run as one stage of a pipeline.
+ * Each stage is handed the AudioFile of the stage before it in memory
+ * (none for the first stage), and replaces it with its own result,
+ * so nothing is written or parsed again between two stages.
+ */
+struct Command {
+	const char *name; /**< Name the command is called by. */
+	const char *usage; /**< Arguments of the command, as printed by the help. */
+	const char *summary; /**< What the command does, as printed by the help. */
+	bool produces_audio; /**< Whether its result is written out when it ends a pipeline. */
+
+	/**
+	 * Runs the command.
+	 * \param args Arguments of the stage, without the name of the command.
+	 * \param audio Result of the previous stage (null for the first one), replaced by the result of this one.
+	 * \param os Stream for text output, the standard output for the last stage and the standard error otherwise.
+	 */
+	void (*run)(vector<string> &args, unique_ptr<AudioFile> &audio, ostream &os);
+};
+
+/**
+ * \param name Name of a command.
+ * \return The command of that name, nullptr if there is none.
+ */
+const Command * find_command(const string &name);
+
+/**
+ * \return Every command, in the order they are listed by the help.
+ */
+const vector<Command> & get_commands();
+
+#endif
@@ -0,0 +1,226 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <getopt.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <memory>
+#include <vector>
+
+#include <CS229Writer.h>
+#include <WavWriter.h>
+#include <Profile.h>
+#include <flags.h>
+
+#include "Commands.h"
+
+using namespace std;
+
+/**
+ * One stage of the pipeline, the arguments of a command along
+ * with where its result is written, if anywhere.
+ */
+struct Stage {
+	const Command *command; /**< Command run by the stage. */
+	vector<string> args; /**< Arguments given to the command. */
+	string output; /**< File the result is written to, empty for none. */
+	bool wav; /**< Whether the result is written as a .wav file. */
+};
+
+vector<vector<string>> split_stages(vector<string> words);
+Stage make_stage(vector<string> words);
+void write_audio(AudioFile &audio, const Stage &stage);
+void print_help();
+
+int main(int argc, char ** argv) {
+	static struct option long_options[] = {
+		{ "help", 0, 0, 'h' },
+		{ "nonstrict", 0, 0, 'n' },
+		{ "overview", 0, 0, 'O' },
+		{ "profile", 0, 0, 'P' },
+		{ 0, 0, 0, 0 }
+	};
+
+	// options before the first command apply to the whole pipeline
+	char c = 0;
+	int option_index = 0;
+	while ((c = getopt_long(argc, argv, "+hnO", long_options, &option_index)) != -1) {
+		switch (c) {
+		case 'n':
+			strict_data = false;
+			break;
+
+		case 'O':
+			write_overviews = true;
+			break;
+
+		case 'P':
+			profiling = true;
+			Profile::print_at_exit();
+			break;
+
+		case 'h':
+			print_help();
+			return 0;
+
+		default:
+			print_help();
+			return 1;
+		}
+	}
+
+	if (optind >= argc) {
+		print_help();
+		return 1;
+	}
+
+	vector<Stage> stages;
+	try {
+		for (auto &words : split_stages(vector<string>(argv + optind, argv + argc))) {
+			stages.push_back(make_stage(words));
+		}
+	} catch (exception &e) {
+		cerr << "imaudio: " << e.what() << endl;
+		print_help();
+		return 1;
+	}
+
+	// every stage hands its AudioFile to the next one in memory
+	unique_ptr<AudioFile> audio;
+	for (size_t i = 0; i < stages.size(); i++) {
+		Stage &stage = stages[i];
+		const bool last = i + 1 == stages.size();
+		try {
+			stage.command->run(stage.args, audio, last ? cout : cerr);
+			if (audio && (!stage.output.empty() || (last && stage.command->produces_audio))) {
+				write_audio(*audio, stage);
+			}
+		} catch (exception &e) {
+			cerr << "imaudio: " << stage.command->name << ": " << e.what() << endl;
+			return 1;
+		}
+	}
+
+	if (overflow_policy != OVERFLOW_THROW) {
+		cerr << "Clipped samples: " << clipped_samples << endl;
+	}
+}
+
+/**
+ * Splits the words of the command line into the words of each stage, stages are
+ * separated by a "|" word. A pipeline given as a single (quoted) word is first
+ * split on white space, so that "imaudio 'play a.abc229 | mix 0.5'" also works.
+ * \param words Every word following the options of the driver.
+ * \return The words of each stage.
+ */
+vector<vector<string>> split_stages(vector<string> words) {
+	if (words.size() == 1) {
+		stringstream ss(words[0]);
+		words.clear();
+		string word;
+		while (ss >> word) {
+			words.push_back(word);
+		}
+	}
+
+	vector<vector<string>> stages(1);
+	for (auto &word : words) {
+		if (word == "|") {
+			stages.push_back(vector<string>());
+		} else {
+			stages.back().push_back(word);
+		}
+	}
+
+	return stages;
+}
+
+/**
+ * Finds the command of a stage, and takes the options shared by every
+ * command out of its arguments: -o <file> (--output) and -w (--wav).
+ * \param words Words of the stage, starting with the name of the command.
+ * \return The stage.
+ */
+Stage make_stage(vector<string> words) {
+	if (words.empty()) {
+		throw invalid_argument("empty stage in the pipeline");
+	}
+
+	Stage stage = { find_command(words[0]), vector<string>(), "", false };
+	if (!stage.command) {
+		throw invalid_argument("unknown command " + words[0]);
+	}
+
+	for (size_t i = 1; i < words.size(); i++) {
+		const string &word = words[i];
+		if (word == "-o" || word == "--output") {
+			if (++i == words.size()) {
+				throw invalid_argument(word + " requires a file");
+			}
+
+			stage.output = words[i];
+		} else if (word.compare(0, 9, "--output=") == 0) {
+			stage.output = word.substr(9);
+		} else if (word.compare(0, 2, "-o") == 0 && word.length() > 2) {
+			stage.output = word.substr(2);
+		} else if (word == "-w" || word == "--wav") {
+			stage.wav = true;
+		} else {
+			stage.args.push_back(word);
+		}
+	}
+
+	// the extension of the output picks its format
+	const string &output = stage.output;
+	if (output.length() >= 4 && output.compare(output.length() - 4, 4, ".wav") == 0) {
+		stage.wav = true;
+	}
+
+	return stage;
+}
+
+/**
+ * Writes the result of a stage to its output file, or to the standard output.
+ * \param audio Result of the stage.
+ * \param stage The stage.
+ */
+void write_audio(AudioFile &audio, const Stage &stage) {
+	unique_ptr<iFileWriter> writer;
+	if (stage.wav) {
+		writer.reset(new WavWriter());
+	} else {
+		writer.reset(new CS229Writer());
+	}
+
+	if (!stage.output.empty()) {
+		writer->write_file(audio, stage.output);
+	} else {
+		writer->write_file(audio, cout);
+	}
+}
+
+void print_help() {
+	cout << "Usage: imaudio [options] command [args] [| command [args]...]" << endl;
+	cout << "Options:" << endl;
+	cout << "  -h --help\tDisplay this information" << endl;
+	cout << "  -n --nonstrict\tFile combinations will be much more lenient." << endl;
+	cout << "  -O --overview\tAlso save the waveform overview of every output file next to it (<file>.ovw)." << endl;
+	cout << "  --profile\tPrint the time spent in each stage and the counters of the run to standard error, as JSON." << endl;
+	cout << endl;
+	cout << "Commands:" << endl;
+	for (auto &command : get_commands()) {
+		cout << "  " << command.name << " " << command.usage << endl;
+		cout << "    \t" << command.summary << endl;
+	}
+
+	cout << endl;
+	cout << "Runs the commands as a pipeline within a single process: each command is handed the" << endl;
+	cout << "audio of the command before it in memory, instead of reading it back from a .cs229 file." << endl;
+	cout << "The '|' between two commands must be quoted ('|'), or the whole pipeline given as a single word:" << endl;
+	cout << "  imaudio 'play --bits=16 --sr=44100 score.abc229 | mix 0.5 | cat b.cs229 -o out.wav'" << endl;
+	cout << "Any command takes -o <file> (--output) to also write its result to <file>, as a .wav file" << endl;
+	cout << "when the name ends with .wav or -w (--wav) is given, and as a .cs229 file otherwise." << endl;
+	cout << "The result of the last command is written to the standard output unless it has a -o." << endl;
+	cout << "Files may be given as file@start or file@start:length to only use that range of their frames." << endl;
+}
@@ -3,11 +3,16 @@
 #include <ctype.h>
 #include <algorithm>
 #include <strings.h>
+#include <memory>
+#include <math.h>
 #include "func/SinWave.h"
 #include "func/PulseWave.h"
 #include "func/SawToothWave.h"
 #include "func/TriangleWave.h"
 #include "func/AdsrEnvelope.h"
+#include "func/BlockRenderer.h"
+#include "Profile.h"
+#include "flags.h"
 
 #include "ABC229Reader.h"
 
@@ -16,7 +21,7 @@ AudioFile ABC229Reader::read_file(istream &is, string filename) {
 	get_header_data(is);
 	read_instruments(is);
 	
-	AudioFile ret = AudioFile(filename, ".abc229", sample_rate, bit_res, channels.size());
+	AudioFile ret = AudioFile(filename, ".abc229", sample_rate, bit_res, channels.size(), float_format);
 	for (auto i = 0; i < (int)channels.size(); i++) {
 		ret[i].append(channels[i]);
 	}
@@ -292,7 +297,8 @@ bool ABC229Reader::is_note_rest(string note) {
 }
 
 Channel ABC229Reader::get_channel_from_notes(vector<string> &notes) {
-	Channel ret = Channel(bit_res);
+	PROFILE_SCOPE(TIMER_SYNTHESIS);
+	Channel ret = Channel(bit_res, float_format);
 	double amplitude = ((int)pow(2, bit_res) / 2) - 1;
 	unsigned sample_per_note = sample_rate / (tempo / 60.0);
 	double volume = get_tmp_value("Volume", 1.0);
@@ -303,40 +309,68 @@ Channel ABC229Reader::get_channel_from_notes(vector<string> &notes) {
 	double pulsefrac = get_tmp_value("PulseFrac", 0.5);
 	double octave = get_tmp_value("Octave", 0.0);
 
+	// create the waveform once, each note only changes its frequency
+	unique_ptr<iWaveform> wave;
+	if (strcasecmp("Triangle", tmp_wave.c_str()) == 0) {
+		wave.reset(new TriangleWave(amplitude, 0.0));
+	} else if (strcasecmp("Sine", tmp_wave.c_str()) == 0) {
+		wave.reset(new SinWave(amplitude, 0.0));
+	} else if (strcasecmp("Sawtooth", tmp_wave.c_str()) == 0) {
+		wave.reset(new SawToothWave(amplitude, 0.0));
+	} else if (strcasecmp("PulseWave", tmp_wave.c_str()) == 0) {
+		wave.reset(new PulseWave(amplitude, 0.0, pulsefrac));
+	} else if (notes.size()) {
+		throw invalid_argument("Expected a waveform when generating wave");
+	}
+
+	// size the channel for every note up front, rests are left as 0's
+	size_t total_samples = 0;
 	for (auto note : notes) {
-		double freq = freq_for_note(note);
-		freq *= pow(2, octave);
-		SinWave s = SinWave(amplitude, freq);
-		iWaveform * wave = NULL;
-
-		// create the waveform for this note
-		if (strcasecmp("Triangle", tmp_wave.c_str()) == 0) {
-			wave = new TriangleWave(amplitude, freq);
-		} else if (strcasecmp("Sine", tmp_wave.c_str()) == 0) {
-			wave = new SinWave(amplitude, freq);
-		} else if (strcasecmp("Sawtooth", tmp_wave.c_str()) == 0) {
-			wave = new SawToothWave(amplitude, freq);
-		} else if (strcasecmp("PulseWave", tmp_wave.c_str()) == 0) {
-			wave = new PulseWave(amplitude, freq, pulsefrac);
-		} else {
-			throw invalid_argument("Expected a waveform when generating wave");
+		total_samples += (size_t)(int)(sample_per_note * length_for_note(note));
+	}
+
+	ret.resize(total_samples);
+	PROFILE_COUNT(COUNTER_SAMPLES_PARSED, total_samples);
+	long * data = float_format ? nullptr : ret.data();
+	double * float_data = float_format ? ret.float_data() : nullptr;
+
+	size_t offset = 0;
+	double block[RENDER_BLOCK_SIZE];
+	for (auto note : notes) {
+		const double length = length_for_note(note);
+		const size_t note_samples = (size_t)(int)(sample_per_note * length);
+
+		if (is_note_rest(note)) {
+			offset += note_samples;
+			continue;
 		}
 
-		// push the samples for this note
-		for (auto i = 0; i < (int)(sample_per_note * length_for_note(note)); i++) {
-			AdsrEnvelope env = AdsrEnvelope(attack, decay, sustain, release, length_for_note(note) * (tempo / 60.0));
-
-			if (is_note_rest(note)) {
-				ret.push_sample(0);
-			} else {
-				double time = i / (double)sample_rate;
-				double adsr = env.sample_at_time(time);
-				double sample = wave->sample_at_time(time);
-				ret.push_sample(volume * sample * adsr);
+		double freq = freq_for_note(note);
+		freq *= pow(2, octave);
+		wave->set_frequency(freq);
+		AdsrEnvelope env = AdsrEnvelope(attack, decay, sustain, release, length * (tempo / 60.0));
+
+		// push the samples for this note, one block (and one dispatch) at a time
+		for (size_t start = 0; start < note_samples; start += RENDER_BLOCK_SIZE) {
+			const size_t count = min((size_t)RENDER_BLOCK_SIZE, note_samples - start);
+			render_waveform_block(*wave, &env, volume, start, sample_rate, block, count);
+
+			for (size_t i = 0; i < count; i++) {
+				if (float_format) {
+					float_data[offset + start + i] = block[i];
+				} else {
+					// samples are truncated, as push_sample(...) would
+					const long val = block[i];
+					if (!ret.is_valid_sample(val)) {
+						throw overflow_error("Sample exceeds this Channels bit resolution!");
+					}
+
+					data[offset + start + i] = val;
+				}
 			}
 		}
 
-		delete wave;
+		offset += note_samples;
 	}
 
 	return ret;
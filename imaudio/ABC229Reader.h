@@ -18,8 +18,13 @@ using namespace std;
  */
 class ABC229Reader : public iFileReader {
 public:
-	ABC229Reader(size_t SampleRate, size_t BitRes) : 
-		sample_rate{SampleRate}, bit_res{BitRes}, current_line{0} { }
+	/**
+	 * \param SampleRate Sample rate of the generated AudioFile.
+	 * \param BitRes Bit resolution of the generated AudioFile.
+	 * \param FloatFormat If true, the generated AudioFile is left in the floating point working format.
+	 */
+	ABC229Reader(size_t SampleRate, size_t BitRes, bool FloatFormat = false) : 
+		sample_rate{SampleRate}, bit_res{BitRes}, float_format{FloatFormat}, current_line{0} { }
 
 	AudioFile read_file(string filename) { return iFileReader::read_file(filename); }
 	virtual AudioFile read_file(istream &is, string filename = "std::cin");
@@ -150,6 +155,7 @@ private:
 	vector<Channel> channels; /**< Array of channels that will be used to generate the file */
 	const size_t sample_rate; /**< Sample Rate as received by the program arguments. */
 	const size_t bit_res; /**< Bit Resolution as received by the program arguments. */
+	const bool float_format; /**< Whether generated channels are left unquantized. */
 	unsigned current_line; /**< Useful for printing out errors. */
 	unsigned tempo; /**< Read from the header data for the file. */
 
@@ -0,0 +1,489 @@
+#include <new>
+#include <atomic>
+#include <deque>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#define HAVE_POSIX_IO
+#endif
+
+#include "AsyncFile.h"
+#include "Trace.h"
+
+#ifdef HAVE_POSIX_IO
+/**
+ * Backend reading and writing a file descriptor with pread(...) and pwrite(...).
+ */
+class PosixFileBackend : public iFileBackend {
+public:
+	PosixFileBackend() : fd{-1} { }
+
+	virtual bool open(const string &filename, bool write) {
+		fd = ::open(filename.c_str(), write ? O_WRONLY | O_CREAT | O_TRUNC : O_RDONLY, 0666);
+#ifdef POSIX_FADV_SEQUENTIAL
+		if (fd >= 0 && !write) {
+			// files are read from start to end, let the kernel read ahead further
+			posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+		}
+#endif
+
+		return fd >= 0;
+	}
+
+	virtual long read_at(char *data, size_t size, uint64_t offset) {
+		size_t done = 0;
+		while (done < size) {
+			const ssize_t count = pread(fd, data + done, size - done, offset + done);
+			if (count < 0 && errno == EINTR) {
+				continue;
+			} else if (count < 0) {
+				return -1;
+			} else if (count == 0) {
+				break;
+			}
+
+			done += count;
+		}
+
+		return done;
+	}
+
+	virtual long write_at(const char *data, size_t size, uint64_t offset) {
+		size_t done = 0;
+		while (done < size) {
+			const ssize_t count = pwrite(fd, data + done, size - done, offset + done);
+			if (count < 0 && errno == EINTR) {
+				continue;
+			} else if (count <= 0) {
+				return -1;
+			}
+
+			done += count;
+		}
+
+		return done;
+	}
+
+	virtual long get_size() {
+		struct stat info;
+		return fstat(fd, &info) == 0 ? (long)info.st_size : -1;
+	}
+
+	virtual void close() {
+		::close(fd);
+		fd = -1;
+	}
+
+private:
+	int fd; /**< Descriptor of the open file. */
+};
+#endif
+
+/**
+ * Backend of the platforms without POSIX I/O, going through the C standard library.
+ * Only one call is ever made at a time, so seeking before each of them is safe.
+ */
+class StdioFileBackend : public iFileBackend {
+public:
+	StdioFileBackend() : file{nullptr} { }
+
+	virtual bool open(const string &filename, bool write) {
+		file = fopen(filename.c_str(), write ? "wb" : "rb");
+		return file != nullptr;
+	}
+
+	virtual long read_at(char *data, size_t size, uint64_t offset) {
+		if (fseek(file, (long)offset, SEEK_SET) != 0) {
+			return -1;
+		}
+
+		const size_t count = fread(data, 1, size, file);
+		return ferror(file) ? -1 : (long)count;
+	}
+
+	virtual long write_at(const char *data, size_t size, uint64_t offset) {
+		if (fseek(file, (long)offset, SEEK_SET) != 0) {
+			return -1;
+		}
+
+		return fwrite(data, 1, size, file) == size ? (long)size : -1;
+	}
+
+	virtual long get_size() {
+		return fseek(file, 0, SEEK_END) == 0 ? ftell(file) : -1;
+	}
+
+	virtual void close() {
+		fclose(file);
+		file = nullptr;
+	}
+
+private:
+	FILE *file; /**< The open file. */
+};
+
+iFileBackend * iFileBackend::create() {
+#ifdef HAVE_POSIX_IO
+	return new PosixFileBackend();
+#else
+	return new StdioFileBackend();
+#endif
+}
+
+/**
+ * The IO_THREADS threads making the jobs of every open AsyncFileBuf, in the
+ * order they were submitted. Each file has at most one job in flight.
+ */
+class IoThreads {
+public:
+	/**
+	 * \return The threads shared by every file, started on first use.
+	 */
+	static IoThreads& shared() {
+		static IoThreads threads;
+		return threads;
+	}
+
+	/**
+	 * \param job Read or write to make on one of the threads.
+	 */
+	void submit(function<void()> job) {
+		unique_lock<mutex> guard(lock);
+		jobs.push_back(move(job));
+		changed.notify_one();
+	}
+
+private:
+	IoThreads() : stopping{false} {
+		for (size_t i = 0; i < IO_THREADS; i++) {
+			workers.emplace_back(&IoThreads::run, this);
+		}
+	}
+
+	~IoThreads() {
+		{
+			unique_lock<mutex> guard(lock);
+			stopping = true;
+			changed.notify_all();
+		}
+
+		for (auto &worker : workers) {
+			worker.join();
+		}
+	}
+
+	/**
+	 * Body of every thread, runs the submitted jobs until the program exits.
+	 */
+	void run() {
+		Trace::set_thread_name("io");
+		unique_lock<mutex> guard(lock);
+		while (true) {
+			changed.wait(guard, [this] { return !jobs.empty() || stopping; });
+			if (jobs.empty()) {
+				return;
+			}
+
+			function<void()> job = move(jobs.front());
+			jobs.pop_front();
+			guard.unlock();
+			job();
+			guard.lock();
+		}
+	}
+
+	vector<thread> workers; /**< The threads. */
+	mutex lock; /**< Guards the members below. */
+	condition_variable changed; /**< Notified whenever a job is submitted, or the threads should exit. */
+	deque<function<void()>> jobs; /**< Jobs waiting for a thread. */
+	bool stopping; /**< Whether the threads should exit. */
+};
+
+// bytes of buffers held by the open files, checked against IO_BUFFER_BUDGET
+static atomic<size_t> buffered_bytes(0);
+
+void AsyncFileBuf::FreeBuffer::operator()(char *buffer) const {
+	free(buffer);
+}
+
+AsyncFileBuf::AsyncFileBuf() : writing{false}, failed{false}, buffer_size{0}, current{0}, offset{0}, ahead{0},
+	async{false}, pending{false}, busy{false}, result{0} { }
+
+AsyncFileBuf::~AsyncFileBuf() {
+	close();
+}
+
+AsyncFileBuf * AsyncFileBuf::open(const string &filename, ios::openmode mode) {
+	if (backend) {
+		return nullptr;
+	}
+
+	unique_ptr<iFileBackend> file(iFileBackend::create());
+	writing = (mode & ios::out) != 0;
+	if (!file->open(filename, writing)) {
+		return nullptr;
+	}
+
+	// files opened once the budget is spent get smaller buffers
+	size_t size = IO_BUFFER_SIZE;
+	while (size > IO_BUFFER_MIN && buffered_bytes + 2 * size > IO_BUFFER_BUDGET) {
+		size /= 2;
+	}
+
+	for (auto &buffer : buffers) {
+		void *data = nullptr;
+		if (posix_memalign(&data, IO_BUFFER_ALIGN, size) != 0) {
+			buffers[0].reset();
+			throw bad_alloc();
+		}
+
+		buffer.reset((char *)data);
+	}
+
+	buffered_bytes += 2 * size;
+	buffer_size = size;
+	backend = move(file);
+	async = async_io;
+	failed = false;
+	current = 0;
+	offset = 0;
+	ahead = 0;
+
+	char *data = buffers[current].get();
+	if (writing) {
+		setp(data, data + buffer_size);
+		return this;
+	}
+
+	// start reading the file before the first byte is asked for
+	setg(data, data, data);
+	char *next = buffers[1 - current].get();
+	iFileBackend *source = backend.get();
+	const size_t length = buffer_size;
+	submit([=]() { return source->read_at(next, length, 0); });
+	return this;
+}
+
+AsyncFileBuf * AsyncFileBuf::close() {
+	if (!backend) {
+		return nullptr;
+	}
+
+	bool ok = true;
+	if (writing) {
+		ok = sync() == 0;
+	} else {
+		wait();
+	}
+
+	backend->close();
+	backend.reset();
+	setg(nullptr, nullptr, nullptr);
+	setp(nullptr, nullptr);
+
+	for (auto &buffer : buffers) {
+		buffer.reset();
+	}
+
+	buffered_bytes -= 2 * buffer_size;
+	buffer_size = 0;
+	return ok ? this : nullptr;
+}
+
+AsyncFileBuf::int_type AsyncFileBuf::underflow() {
+	if (!backend || writing) {
+		return traits_type::eof();
+	} else if (gptr() < egptr()) {
+		return traits_type::to_int_type(*gptr());
+	}
+
+	// the read-ahead is only of use if no seek moved away from it
+	const uint64_t next = offset + (egptr() - eback());
+	char *data = buffers[1 - current].get();
+	long count = 0;
+	if (pending && ahead == next) {
+		count = wait();
+	} else {
+		wait();
+		count = backend->read_at(data, buffer_size, next);
+	}
+
+	current = 1 - current;
+	offset = next;
+	if (count <= 0) {
+		setg(data, data, data);
+		return traits_type::eof();
+	}
+
+	setg(data, data, data + count);
+
+	// read the next part of the file while this one is parsed
+	char *spare = buffers[1 - current].get();
+	iFileBackend *source = backend.get();
+	ahead = next + count;
+	const uint64_t at = ahead;
+	const size_t length = buffer_size;
+	submit([=]() { return source->read_at(spare, length, at); });
+	return traits_type::to_int_type(*gptr());
+}
+
+AsyncFileBuf::int_type AsyncFileBuf::overflow(int_type c) {
+	if (!backend || !writing || !flush_buffer()) {
+		return traits_type::eof();
+	}
+
+	if (!traits_type::eq_int_type(c, traits_type::eof())) {
+		*pptr() = traits_type::to_char_type(c);
+		pbump(1);
+	}
+
+	return traits_type::not_eof(c);
+}
+
+int AsyncFileBuf::sync() {
+	if (!backend || !writing) {
+		return 0;
+	}
+
+	if (wait() < 0) {
+		failed = true;
+	}
+
+	// a flush waits for the data to be written anyway, so it is written from this thread
+	const size_t size = pptr() - pbase();
+	if (size && backend->write_at(pbase(), size, offset) != (long)size) {
+		failed = true;
+	}
+
+	offset += size;
+	setp(pbase(), epptr());
+	return failed ? -1 : 0;
+}
+
+AsyncFileBuf::pos_type AsyncFileBuf::seekoff(off_type off, ios::seekdir dir, ios::openmode which) {
+	if (!backend || !(which & (writing ? ios::out : ios::in))) {
+		return pos_type(off_type(-1));
+	}
+
+	if (!writing) {
+		const uint64_t position = offset + (gptr() - eback());
+		const off_type target = dir == ios::beg ? off :
+			dir == ios::cur ? (off_type)position + off : backend->get_size() + off;
+		if (target < 0) {
+			return pos_type(off_type(-1));
+		}
+
+		// positions within the current buffer are reached without any I/O
+		if ((uint64_t)target >= offset && (uint64_t)target <= offset + (egptr() - eback())) {
+			setg(eback(), eback() + (target - offset), egptr());
+			return pos_type(target);
+		}
+
+		// the next underflow() reads from there
+		offset = target;
+		setg(eback(), eback(), eback());
+		return pos_type(target);
+	}
+
+	// tellp() is answered without waiting for the writes in flight
+	const uint64_t position = offset + (pptr() - pbase());
+	if (dir == ios::cur && off == 0) {
+		return pos_type((off_type)position);
+	}
+
+	if (sync() != 0) {
+		return pos_type(off_type(-1));
+	}
+
+	const off_type target = dir == ios::beg ? off :
+		dir == ios::cur ? (off_type)position + off : backend->get_size() + off;
+	if (target < 0) {
+		return pos_type(off_type(-1));
+	}
+
+	offset = target;
+	return pos_type(target);
+}
+
+AsyncFileBuf::pos_type AsyncFileBuf::seekpos(pos_type pos, ios::openmode which) {
+	return seekoff(off_type(pos), ios::beg, which);
+}
+
+bool AsyncFileBuf::flush_buffer() {
+	const size_t size = pptr() - pbase();
+	if (size == 0) {
+		return !failed;
+	}
+
+	if (wait() < 0) {
+		failed = true;
+	}
+
+	// write this buffer out while the next one is filled
+	const char *data = pbase();
+	const uint64_t at = offset;
+	iFileBackend *target = backend.get();
+	submit([=]() { return target->write_at(data, size, at); });
+
+	current = 1 - current;
+	offset += size;
+	char *next = buffers[current].get();
+	setp(next, next + buffer_size);
+	return !failed;
+}
+
+void AsyncFileBuf::submit(function<long()> Job) {
+	wait();
+	pending = true;
+	if (!async) {
+		result = Job();
+		return;
+	}
+
+	{
+		unique_lock<mutex> guard(lock);
+		busy = true;
+	}
+
+	const char *name = writing ? "write_behind" : "read_ahead";
+	IoThreads::shared().submit([this, Job, name]() {
+		long done = 0;
+		{
+			TRACE_SCOPE(name);
+			done = Job();
+		}
+
+		// close() waits for this job, so the buffer outlives the lock
+		unique_lock<mutex> guard(lock);
+		result = done;
+		busy = false;
+		changed.notify_all();
+	});
+}
+
+long AsyncFileBuf::wait() {
+	if (!pending) {
+		return 0;
+	}
+
+	pending = false;
+	if (!async) {
+		return result;
+	}
+
+	unique_lock<mutex> guard(lock);
+	if (busy) {
+		// the disk is slower than the stream
+		TRACE_SCOPE("io_wait");
+		changed.wait(guard, [this] { return !busy; });
+	}
+
+	return result;
+}
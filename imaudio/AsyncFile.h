@@ -0,0 +1,254 @@
+#ifndef ASYNCFILE_H
+#define ASYNCFILE_H
+
+#include <iostream>
+#include <string>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+
+#include "flags.h"
+
+using namespace std;
+
+/**
+ * Positioned reads and writes of a single file, the only calls an
+ * AsyncFileBuf makes to the system. Every call names its own offset, so
+ * the I/O threads and the thread parsing the file never share a position.
+ */
+class iFileBackend {
+public:
+	virtual ~iFileBackend() { }
+
+	/**
+	 * Creates the backend of the platform, POSIX file descriptors where
+	 * available, and the C standard library everywhere else.
+	 * \return A new backend, owned by the caller.
+	 */
+	static iFileBackend * create();
+
+	/**
+	 * \param filename Name of the file to open.
+	 * \param write Whether to create (or truncate) the file for writing, instead of reading it.
+	 * \return Whether or not the file could be opened.
+	 */
+	virtual bool open(const string &filename, bool write) = 0;
+
+	/**
+	 * \param data Where to store the bytes read.
+	 * \param size Number of bytes to read.
+	 * \param offset Position in the file of the first byte to read.
+	 * \return Number of bytes read, less than 'size' at the end of the file, -1 on errors.
+	 */
+	virtual long read_at(char *data, size_t size, uint64_t offset) = 0;
+
+	/**
+	 * \param data Bytes to write.
+	 * \param size Number of bytes to write.
+	 * \param offset Position in the file of the first byte to write.
+	 * \return Number of bytes written, -1 on errors.
+	 */
+	virtual long write_at(const char *data, size_t size, uint64_t offset) = 0;
+
+	/**
+	 * \return Size of the file in bytes, -1 on errors.
+	 */
+	virtual long get_size() = 0;
+
+	/**
+	 * Closes the file, no other call may be made after this one.
+	 */
+	virtual void close() = 0;
+};
+
+/**
+ * File buffer overlapping disk I/O with the work of the thread using it.
+ * It owns two large page aligned buffers: while the stream parses (or
+ * formats) one of them, one of the IO_THREADS threads shared by every open
+ * file reads the next part of the file into the other one (read-ahead), or
+ * writes out the one filled before it (write-behind), so a reader or writer
+ * waits for the disk only when the disk is slower than it is.
+ * The buffers are IO_BUFFER_SIZE bytes each until the open files hold
+ * IO_BUFFER_BUDGET bytes, the files opened past that get smaller ones
+ * (down to IO_BUFFER_MIN), so mixing many inputs does not take 2 MiB each.
+ * Seeking is supported, a seek within the buffer being read costs nothing,
+ * any other seek waits for the I/O in flight first.
+ * When 'async_io' (see flags.h) is cleared, every read and write is made
+ * on the calling thread instead, with the same buffers.
+ */
+class AsyncFileBuf : public streambuf {
+public:
+	AsyncFileBuf();
+	virtual ~AsyncFileBuf();
+
+	AsyncFileBuf(const AsyncFileBuf &other) = delete;
+	AsyncFileBuf& operator=(const AsyncFileBuf &other) = delete;
+
+	/**
+	 * Opens a file, and starts reading it ahead when it is opened for reading.
+	 * \param filename Name of the file to open.
+	 * \param mode ios::out to create (or truncate) the file for writing, it is read otherwise.
+	 * \return This buffer, nullptr if the file could not be opened.
+	 */
+	AsyncFileBuf * open(const string &filename, ios::openmode mode);
+
+	/**
+	 * Writes out everything buffered, waits for the I/O in flight, closes the file
+	 * and frees the buffers.
+	 * \return This buffer, nullptr if any write failed or no file was open.
+	 */
+	AsyncFileBuf * close();
+
+	/**
+	 * \return Whether or not a file is open.
+	 */
+	inline bool is_open() const {
+		return backend != nullptr;
+	}
+
+	/**
+	 * \return Size of each of the two buffers of the open file, 0 when no file is open.
+	 */
+	inline size_t get_buffer_size() const {
+		return buffer_size;
+	}
+
+protected:
+	virtual int_type underflow();
+	virtual int_type overflow(int_type c = traits_type::eof());
+	virtual int sync();
+	virtual pos_type seekoff(off_type off, ios::seekdir dir, ios::openmode which = ios::in | ios::out);
+	virtual pos_type seekpos(pos_type pos, ios::openmode which = ios::in | ios::out);
+
+private:
+	/**
+	 * Hands a read or a write to the I/O threads, or makes it right away if
+	 * 'async_io' is cleared. Only one job is in flight at a time, so this
+	 * first waits for the previous one.
+	 * \param job The read or the write, returning its number of bytes.
+	 */
+	void submit(function<long()> job);
+
+	/**
+	 * Waits for the job submitted last, if it was not waited for yet.
+	 * \return The result of that job, 0 if there was none.
+	 */
+	long wait();
+
+	/**
+	 * Hands the bytes written to the current buffer to the I/O threads,
+	 * and goes on with the other buffer.
+	 * \return Whether or not the previous write succeeded.
+	 */
+	bool flush_buffer();
+
+	/**
+	 * Frees a buffer made by posix_memalign(...).
+	 */
+	struct FreeBuffer {
+		void operator()(char *buffer) const;
+	};
+
+	unique_ptr<iFileBackend> backend; /**< File being read or written, nullptr when closed. */
+	bool writing; /**< Whether the file was opened for writing. */
+	bool failed; /**< Whether a write failed. */
+	unique_ptr<char, FreeBuffer> buffers[2]; /**< The two buffers, 'buffer_size' bytes each. */
+	size_t buffer_size; /**< Size of each buffer, IO_BUFFER_SIZE unless the budget was spent. */
+	size_t current; /**< Index of the buffer used by the stream, the other one belongs to the I/O threads. */
+	uint64_t offset; /**< Position in the file of the first byte of the current buffer. */
+	uint64_t ahead; /**< Position in the file the other buffer is being read from. */
+
+	bool async; /**< Whether the jobs of the open file go to the I/O threads, 'async_io' when it was opened. */
+	mutex lock; /**< Guards the members below. */
+	condition_variable changed; /**< Notified whenever a job is done. */
+	bool pending; /**< Whether a job was submitted and its result was not waited for yet. */
+	bool busy; /**< Whether the I/O threads have a job of this file they have not finished. */
+	long result; /**< Result of the last job finished. */
+};
+
+/**
+ * Input file stream reading through an AsyncFileBuf, a drop-in
+ * replacement for the ifstreams of the readers.
+ */
+class AsyncIfstream : public istream {
+public:
+	AsyncIfstream() : istream(nullptr) {
+		rdbuf(&buffer);
+	}
+
+	/**
+	 * \param filename Name of the file to open.
+	 */
+	AsyncIfstream(const string &filename) : AsyncIfstream() {
+		open(filename);
+	}
+
+	/**
+	 * \param filename Name of the file to open, failbit is set if it can not be opened.
+	 */
+	void open(const string &filename) {
+		if (!buffer.open(filename, ios::in)) {
+			setstate(ios::failbit);
+		}
+	}
+
+	inline bool is_open() const {
+		return buffer.is_open();
+	}
+
+	void close() {
+		if (!buffer.close()) {
+			setstate(ios::failbit);
+		}
+	}
+
+private:
+	AsyncFileBuf buffer; /**< Buffer the file is read through. */
+};
+
+/**
+ * Output file stream writing through an AsyncFileBuf, a drop-in
+ * replacement for the ofstreams of the writers.
+ */
+class AsyncOfstream : public ostream {
+public:
+	AsyncOfstream() : ostream(nullptr) {
+		rdbuf(&buffer);
+	}
+
+	/**
+	 * \param filename Name of the file to create.
+	 */
+	AsyncOfstream(const string &filename) : AsyncOfstream() {
+		open(filename);
+	}
+
+	/**
+	 * \param filename Name of the file to create, failbit is set if it can not be created.
+	 */
+	void open(const string &filename) {
+		if (!buffer.open(filename, ios::out)) {
+			setstate(ios::failbit);
+		}
+	}
+
+	inline bool is_open() const {
+		return buffer.is_open();
+	}
+
+	/**
+	 * Writes out everything buffered and closes the file, failbit is set if any write failed.
+	 */
+	void close() {
+		if (!buffer.close()) {
+			setstate(ios::failbit);
+		}
+	}
+
+private:
+	AsyncFileBuf buffer; /**< Buffer the file is written through. */
+};
+
+#endif
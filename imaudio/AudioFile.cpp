@@ -1,6 +1,8 @@
 #include <string>
 #include <algorithm> 
 #include "AudioFile.h"
+#include "AudioInfo.h"
+#include "Profile.h"
 #include "flags.h"
 
 static const string invalid_num_channels = "Invalid num_channels in constructor.";
@@ -8,7 +10,7 @@ static const string invalid_bit_res = "Invalid bit_res in constructor.";
 static const string invalid_assign = "Must have matching sample_rate, bit_res, and num_channels.";
 
 AudioFile::AudioFile(string FileName, string Extension, size_t SampleRate, 
-		size_t BitRes, size_t NumChannels) : 
+		size_t BitRes, size_t NumChannels, bool FloatFormat) : 
 		file_name{FileName}, extension{Extension}, sample_rate{SampleRate}, 
 		bit_res{BitRes}, num_channels{NumChannels} { 
 	if (num_channels < 1 || num_channels >= 128) {
@@ -21,7 +23,7 @@ AudioFile::AudioFile(string FileName, string Extension, size_t SampleRate,
 
 	// initalize each channel for this sound file, users of this class will not be able to replace these
 	for (auto i = 0; i < (int)num_channels; i++) {
-		channels.push_back(Channel(bit_res));
+		channels.push_back(Channel(bit_res, FloatFormat));
 	}
 }
 
@@ -77,18 +79,12 @@ AudioFile& AudioFile::operator=(const AudioFile &&other) {
 }
 
 ostream& operator<<(ostream &os, const AudioFile &file) {
-	os << "File Name:\t" << file.get_file_name() << endl;
-	os << "File Type:\t" << file.get_extension() << endl;
-	os << "Sample Rate:\t" << file.sample_rate << endl;
-	os << "Bit Depth:\t" << file.bit_res << endl;
-	os << "Num Channels:\t" << file.num_channels << endl;
-	os << "Num Samples:\t" << file.get_num_samples() << endl;
-	os << "Length:\t\t" << file.get_num_samples() / (double)file.sample_rate << " seconds" << endl;
-
-	return os;
+	// shares its format with the header only AudioInfo
+	return os << AudioInfo(file);
 }
 
 AudioFile AudioFile::concat(const AudioFile &other) {
+	PROFILE_SCOPE(TIMER_ARITHMETIC);
 	if (strict_data) {
 		if (other.bit_res != bit_res) {
 			throw invalid_argument("other.bit_res must match this->bit_res");
@@ -125,6 +121,7 @@ AudioFile AudioFile::concat(const AudioFile &other) {
 }
 
 AudioFile AudioFile::operator*(const double scalar) {
+	PROFILE_SCOPE(TIMER_ARITHMETIC);
 	AudioFile last = *this;
 	for (auto i = 0; i < (int)last.num_channels; i++) {
 		last[i] = last[i] * scalar;
@@ -136,6 +133,7 @@ AudioFile AudioFile::operator*(const double scalar) {
 }
 
 AudioFile AudioFile::operator+(const AudioFile &other) {
+	PROFILE_SCOPE(TIMER_ARITHMETIC);
 	if (strict_data) {
 		if (other.bit_res != bit_res) {
 			throw invalid_argument("other.bit_res must match this->bit_res");
@@ -180,6 +178,7 @@ AudioFile AudioFile::operator+(const AudioFile &other) {
 }
 
 AudioFile AudioFile::operator*(const AudioFile &other) {
+	PROFILE_SCOPE(TIMER_ARITHMETIC);
 	if (strict_data) {
 		if (other.bit_res != bit_res) {
 			throw invalid_argument("other.bit_res must match this->bit_res");
@@ -222,6 +221,16 @@ AudioFile AudioFile::operator*(const AudioFile &other) {
 	return last;
 }
 
+AudioFile AudioFile::convert_bit_res(size_t BitRes, bool dither) const {
+	PROFILE_SCOPE(TIMER_ARITHMETIC);
+	AudioFile last = AudioFile(file_name, extension, sample_rate, BitRes, num_channels);
+	for (auto i = 0; i < (int)num_channels; i++) {
+		last[i] = channels[i].convert_bit_res(BitRes, dither);
+	}
+
+	return last;
+}
+
 bool AudioFile::are_channels_valid() {
 	auto num_channels = get_num_channels();
 	for (auto &channel : channels) {
@@ -233,11 +242,39 @@ bool AudioFile::are_channels_valid() {
 	return true;
 }
 
+void AudioFile::reserve(size_t n) {
+	for (auto &channel : channels) {
+		channel.reserve(n);
+	}
+}
+
 void AudioFile::mute_channel(unsigned index) {
 	Channel &c = channels[index];
 
+	if (c.is_float()) {
+		double * data = c.float_data();
+		for (auto i = 0; i < (int)c.size(); i++) {
+			data[i] = 0.0f;
+		}
+
+		return;
+	}
+
+	long * data = c.data();
 	for (auto i = 0; i < (int)c.size(); i++) {
-		c[i] = 0;
+		data[i] = 0;
+	}
+}
+
+void AudioFile::convert_to_float() {
+	for (auto &channel : channels) {
+		channel.convert_to_float();
+	}
+}
+
+void AudioFile::quantize() {
+	for (auto &channel : channels) {
+		channel.quantize();
 	}
 }
 
@@ -23,14 +23,16 @@ public:
 	 * the same bit res as this audio file. Each channel can then be accessed
 	 * using the [] operator.
 	 * If NumChannels is < 1, this function will throw an invalid_argument exception.
+	 * If BitRes is not 8, 16, or 32, an invalid_argument exception is thrown as well.
 	 * \param FileName Name of the file this AudioFile was created from.
 	 * \param Extension Representation of the format this file was loaded from.
 	 * \param SampleRate Number of samples per second for this audio file.
 	 * \param BitRes Number of bits per byte to use for each channel.
 	 * \param NumChannels Number of 'Channels' to create.
+	 * \param FloatFormat Whether the channels should use the floating point working format.
 	 */
 	AudioFile(string FileName, string Extension, size_t SampleRate,
-			size_t BitRes, size_t NumChannels);
+			size_t BitRes, size_t NumChannels, bool FloatFormat = false);
 	AudioFile(const AudioFile &other);
 	AudioFile(const AudioFile &&other);
 	AudioFile& operator=(const AudioFile &other);
@@ -85,6 +87,47 @@ public:
 	 */
 	AudioFile operator*(const AudioFile &other);
 
+	/**
+	 * Converts every channel of this AudioFile to the input bit resolution
+	 * (see Channel::convert_bit_res(...) for the scaling rules).
+	 * The sample rate, number of channels, and number of samples are unchanged.
+	 * If BitRes is not 8, 16, or 32 the constructor of the returned AudioFile
+	 * throws an invalid_argument exception, before any sample is converted.
+	 * \param BitRes Bit resolution of the returned AudioFile.
+	 * \param dither Whether or not to apply TPDF dither when reducing resolution.
+	 * \return AudioFile representation of the result.
+	 */
+	AudioFile convert_bit_res(size_t BitRes, bool dither = false) const;
+
+	/**
+	 * Converts every channel of this AudioFile to the floating point
+	 * working format (see Channel). Subsequent operators will no longer
+	 * truncate intermediate results, the file is only quantized by
+	 * quantize() or when it is written.
+	 */
+	void convert_to_float();
+
+	/**
+	 * Rounds every channel of this AudioFile back to the integer format.
+	 * Samples leaving the bit resolution are handled as 'overflow_policy'
+	 * asks, by default an overflow_error is thrown.
+	 */
+	void quantize();
+
+	/**
+	 * \return Whether or not this AudioFile uses the floating point working format.
+	 */
+	inline bool is_float() const {
+		return channels[0].is_float();
+	}
+
+	/**
+	 * Allocates room for 'n' samples in every channel, for readers which
+	 * know the length of a file before reading its samples (see Channel::reserve(...)).
+	 * \param n The number of samples per channel to make room for.
+	 */
+	void reserve(size_t n);
+
 	/**
 	 * Takes very sample of the channel at the input index and replaces
 	 * the value with '0'.
@@ -0,0 +1,58 @@
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+
+#include "AudioInfo.h"
+#include "AudioFile.h"
+#include "CS229Reader.h"
+#include "WavReader.h"
+
+AudioInfo::AudioInfo(const AudioFile &file) :
+	file_name{file.get_file_name()}, extension{file.get_extension()},
+	sample_rate{file.get_sample_rate()}, bit_res{file.get_bit_res()},
+	num_channels{file.get_num_channels()}, num_samples{file.get_num_samples()} { }
+
+ostream& operator<<(ostream &os, const AudioInfo &info) {
+	os << "File Name:\t" << info.file_name << endl;
+	os << "File Type:\t" << info.extension << endl;
+	os << "Sample Rate:\t" << info.sample_rate << endl;
+	os << "Bit Depth:\t" << info.bit_res << endl;
+	os << "Num Channels:\t" << info.num_channels << endl;
+	os << "Num Samples:\t" << info.num_samples << endl;
+	os << "Length:\t\t" << info.num_samples / (double)info.sample_rate << " seconds" << endl;
+
+	return os;
+}
+
+AudioInfo AudioInfo::probe(string filename) {
+	ifstream file(filename, ios::in | ios::binary);
+	if (!file.is_open()) {
+		throw invalid_argument("Failed to open file for reading.");
+	}
+
+	return probe(file, filename);
+}
+
+AudioInfo AudioInfo::probe(istream &is, string filename) {
+	string extension;
+	auto reader = open_reader(is, filename, extension);
+	const long frames = reader->count_frames();
+
+	return AudioInfo(filename, extension, reader->get_sample_rate(),
+			reader->get_bit_res(), reader->get_num_channels(), frames);
+}
+
+unique_ptr<iBlockReader> AudioInfo::open_reader(istream &is, string filename, string &extension) {
+	// a wav file always starts with 'RIFF', the first line of a cs229 file is 'CS229'
+	unique_ptr<iBlockReader> reader;
+	if (is.peek() == 'R') {
+		reader.reset(new WavReader());
+		extension = ".wav";
+	} else {
+		reader.reset(new CS229Reader());
+		extension = ".cs229";
+	}
+
+	reader->open(is, filename);
+	return reader;
+}
@@ -0,0 +1,125 @@
+#ifndef AUDIO_INFO_H
+#define AUDIO_INFO_H
+
+#include <iostream>
+#include <string>
+#include <memory>
+
+#include "iBlockReader.h"
+
+using namespace std;
+
+class AudioFile;
+
+/**
+ * Format information of an audio file, without any of its samples.
+ * An AudioInfo is either created from an AudioFile, or by probing
+ * a file, which reads only its header. For .wav files every field comes
+ * from the fmt and data chunks, for .cs229 files from the header keys,
+ * and when the 'Samples' key is missing the frames are counted by scanning
+ * for lines of data, without decoding any of the samples.
+ */
+class AudioInfo {
+public:
+	/**
+	 * \param FileName Name of the file.
+	 * \param Extension Representation of the format of the file.
+	 * \param SampleRate Number of samples per second.
+	 * \param BitRes Number of bits per sample.
+	 * \param NumChannels Number of channels.
+	 * \param NumSamples Number of samples in each channel.
+	 */
+	AudioInfo(string FileName, string Extension, size_t SampleRate,
+			size_t BitRes, size_t NumChannels, size_t NumSamples) :
+		file_name{FileName}, extension{Extension}, sample_rate{SampleRate},
+		bit_res{BitRes}, num_channels{NumChannels}, num_samples{NumSamples} { }
+
+	/**
+	 * \param file AudioFile to describe.
+	 */
+	AudioInfo(const AudioFile &file);
+
+	/**
+	 * Writes the information in the same format as operator<<(ostream&, const AudioFile&).
+	 */
+	friend ostream& operator<<(ostream &os, const AudioInfo &info);
+
+	/**
+	 * Reads the header of the given file, the format (.cs229 or .wav)
+	 * is detected from the contents of the file.
+	 * \param filename Name of the file to probe.
+	 * \return Information about the file.
+	 */
+	static AudioInfo probe(string filename);
+
+	/**
+	 * Reads the header of a file from the input stream, the format (.cs229 or .wav)
+	 * is detected from the first character of the stream.
+	 * \param is Input stream positioned at the start of the file.
+	 * \param filename The name of the file we are reading from ("std::cin" by default).
+	 * \return Information about the file.
+	 */
+	static AudioInfo probe(istream &is, string filename = "std::cin");
+
+	/**
+	 * Opens a streaming reader for the file in the input stream, the format
+	 * (.cs229 or .wav) is detected from the first character of the stream.
+	 * \param is Input stream positioned at the start of the file.
+	 * \param filename The name of the file we are reading from.
+	 * \param extension Set to the extension of the detected format.
+	 * \return A reader with its header read.
+	 */
+	static unique_ptr<iBlockReader> open_reader(istream &is, string filename, string &extension);
+
+	/**
+	 * \return The name of the file.
+	 */
+	inline string get_file_name() const {
+		return file_name;
+	}
+
+	/**
+	 * \return The format of the file.
+	 */
+	inline string get_extension() const {
+		return extension;
+	}
+
+	/**
+	 * \return The number of samples per second for each channel.
+	 */
+	inline size_t get_sample_rate() const {
+		return sample_rate;
+	}
+
+	/**
+	 * \return The number of bits per sample for each channel.
+	 */
+	inline size_t get_bit_res() const {
+		return bit_res;
+	}
+
+	/**
+	 * \return The number of channels of the file.
+	 */
+	inline size_t get_num_channels() const {
+		return num_channels;
+	}
+
+	/**
+	 * \return The number of samples in each channel.
+	 */
+	inline size_t get_num_samples() const {
+		return num_samples;
+	}
+
+private:
+	string file_name; /**< Name of the file. */
+	string extension; /**< Format of the file. */
+	size_t sample_rate; /**< Number of samples per second. */
+	size_t bit_res; /**< Number of bits per sample. */
+	size_t num_channels; /**< Number of channels. */
+	size_t num_samples; /**< Number of samples in each channel. */
+};
+
+#endif
@@ -0,0 +1,90 @@
+#include <mutex>
+#include <condition_variable>
+
+#include "Batch.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+Batch::Batch(size_t NumThreads) : num_threads{NumThreads} {
+	if (num_threads == 0) {
+		num_threads = max(thread::hardware_concurrency(), 1u);
+	}
+}
+
+size_t Batch::run(const vector<string> &files, function<string(const string &)> job,
+		ostream &os, ostream &err) {
+	// files past the oldest unfinished one that may be in flight or waiting to be written
+	const size_t window = num_threads * 4;
+
+	ThreadPool pool(num_threads, num_threads * 2);
+	vector<string> results(files.size());
+	vector<bool> failed(files.size(), false);
+	vector<bool> done(files.size(), false);
+	size_t next_write = 0;
+	size_t failures = 0;
+	mutex lock;
+	condition_variable written;
+
+	for (size_t i = 0; i < files.size(); i++) {
+		{
+			unique_lock<mutex> guard(lock);
+			if (i >= next_write + window) {
+				TRACE_SCOPE("batch_window");
+				written.wait(guard, [&] { return i < next_write + window; });
+			}
+		}
+
+		pool.submit([&, i] {
+			string result;
+			bool error = false;
+			try {
+				TRACE_SCOPE("batch_job");
+				result = job(files[i]);
+			} catch (exception &e) {
+				result = files[i] + ": " + e.what();
+				error = true;
+			}
+
+			unique_lock<mutex> guard(lock);
+			results[i] = move(result);
+			failed[i] = error;
+			done[i] = true;
+
+			// write every finished result that is next in line
+			while (next_write < files.size() && done[next_write]) {
+				if (failed[next_write]) {
+					err << results[next_write] << endl;
+					failures++;
+				} else {
+					os << results[next_write];
+				}
+
+				results[next_write].clear();
+				results[next_write].shrink_to_fit();
+				next_write++;
+			}
+
+			written.notify_all();
+		});
+	}
+
+	pool.wait();
+	os.flush();
+	return failures;
+}
+
+vector<string> Batch::read_file_list(istream &is) {
+	vector<string> files;
+	string line;
+	while (getline(is, line)) {
+		if (!line.empty() && line.back() == '\r') {
+			line.pop_back();
+		}
+
+		if (!line.empty()) {
+			files.push_back(line);
+		}
+	}
+
+	return files;
+}
@@ -0,0 +1,49 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <functional>
+
+using namespace std;
+
+/**
+ * Runs the same job over many input files in parallel.
+ * Jobs are spread over a bounded, work stealing ThreadPool, and only a
+ * limited window of files past the oldest unfinished one is in flight,
+ * so memory use does not depend on the number of files.
+ * The output of each job is written in input order as soon as every
+ * earlier job has finished. A job that throws does not stop the batch,
+ * its error is reported in order in place of its output.
+ */
+class Batch {
+public:
+	/**
+	 * \param NumThreads Number of worker threads, 0 uses the number of hardware threads.
+	 */
+	Batch(size_t NumThreads = 0);
+
+	/**
+	 * Runs job(file) for every input file.
+	 * \param files Names of the input files.
+	 * \param job Processes a single file, returning the text to write to 'os'.
+	 * \param os Stream receiving the output of each job.
+	 * \param err Stream receiving a line for each failed job.
+	 * \return The number of jobs which failed.
+	 */
+	size_t run(const vector<string> &files, function<string(const string &)> job,
+			ostream &os, ostream &err);
+
+	/**
+	 * Reads one file name per line, skipping empty lines.
+	 * \param is Input stream to read the names from.
+	 * \return The names read.
+	 */
+	static vector<string> read_file_list(istream &is);
+
+private:
+	size_t num_threads; /**< Number of worker threads. */
+};
+
+#endif
@@ -0,0 +1,158 @@
+#include <stdexcept>
+#include <string.h>
+
+#include "BlockQueue.h"
+
+static const string aborted_msg = "The pipeline was aborted.";
+static const string closed_msg = "The stream was closed before it began.";
+
+BlockQueue::BlockQueue(size_t Capacity, size_t BlockSize, RingWait Wait) :
+	capacity{max((size_t)1, Capacity)}, block_size{BlockSize}, wait_mode{Wait},
+	header{0, 0, 0, -1}, begun{false}, closed{false}, aborted{false} { }
+
+void BlockQueue::begin(const Header &Format) {
+	unique_lock<mutex> guard(lock);
+	check_aborted();
+	header = Format;
+	ring.reset(new BlockRing(header.num_channels, block_size, capacity, wait_mode));
+	begun = true;
+	changed.notify_all();
+}
+
+BlockQueue::Header BlockQueue::get_header() {
+	unique_lock<mutex> guard(lock);
+	changed.wait(guard, [this] { return begun || closed || aborted; });
+	check_aborted();
+	if (!begun) {
+		throw runtime_error(closed_msg);
+	}
+
+	return header;
+}
+
+SampleBlock * BlockQueue::acquire() {
+	check_aborted();
+	// the ring is only closed early by abort()
+	SampleBlock *block = ring->acquire();
+	if (!block) {
+		throw runtime_error(aborted_msg);
+	}
+
+	return block;
+}
+
+void BlockQueue::push(SampleBlock *block) {
+	check_aborted();
+	ring->push(block);
+}
+
+void BlockQueue::close() {
+	// a producer failing before begin(...) may close a queue without a ring
+	unique_lock<mutex> guard(lock);
+	closed = true;
+	if (ring) {
+		ring->close();
+	}
+
+	changed.notify_all();
+}
+
+SampleBlock * BlockQueue::pop() {
+	check_aborted();
+	SampleBlock *block = ring->pop();
+	if (!block) {
+		// tells the end of the stream apart from an abort
+		check_aborted();
+	}
+
+	return block;
+}
+
+void BlockQueue::release(SampleBlock *block) {
+	ring->release(block);
+}
+
+void BlockQueue::abort() {
+	unique_lock<mutex> guard(lock);
+	aborted = true;
+	if (ring) {
+		ring->close();
+	}
+
+	changed.notify_all();
+}
+
+void BlockQueue::check_aborted() const {
+	if (aborted) {
+		throw runtime_error(aborted_msg);
+	}
+}
+
+QueueReader::~QueueReader() {
+	if (current) {
+		queue->release(current);
+	}
+}
+
+void QueueReader::open_queue() {
+	const BlockQueue::Header header = queue->get_header();
+	sample_rate = header.sample_rate;
+	bit_res = header.bit_res;
+	num_channels = header.num_channels;
+	num_samples = header.num_samples;
+}
+
+void QueueReader::open(istream &is, string filename) {
+	throw invalid_argument("A QueueReader can only read from its BlockQueue.");
+}
+
+size_t QueueReader::read_frames(SampleBlock &block, size_t max_frames) {
+	size_t frames = 0;
+	while (frames < max_frames) {
+		if (!current) {
+			current = queue->pop();
+			offset = 0;
+			if (!current) {
+				break;
+			}
+		}
+
+		const size_t count = min(max_frames - frames, current->get_frames() - offset);
+		for (size_t c = 0; c < num_channels; c++) {
+			memcpy(block.channel(c) + frames, current->channel(c) + offset, count * sizeof(long));
+		}
+
+		frames += count;
+		offset += count;
+		if (offset == current->get_frames()) {
+			queue->release(current);
+			current = nullptr;
+		}
+	}
+
+	block.set_frames(frames);
+	return frames;
+}
+
+void QueueWriter::begin(ostream &os, size_t SampleRate, size_t BitRes, size_t NumChannels, long NumSamples) {
+	queue->begin({SampleRate, BitRes, NumChannels, NumSamples});
+}
+
+void QueueWriter::write_block(const SampleBlock &block) {
+	// blocks larger than those of the queue are split over several of them
+	const size_t block_size = queue->get_block_size();
+	for (size_t start = 0; start < block.get_frames(); start += block_size) {
+		const size_t count = min(block_size, block.get_frames() - start);
+		SampleBlock *out = queue->acquire();
+		for (size_t c = 0; c < block.get_num_channels(); c++) {
+			memcpy(out->channel(c), block.channel(c) + start, count * sizeof(long));
+		}
+
+		out->set_frames(count);
+		queue->push(out);
+	}
+}
+
+void QueueWriter::end() {
+	queue->close();
+}
@@ -0,0 +1,194 @@
+#ifndef BLOCKQUEUE_H
+#define BLOCKQUEUE_H
+
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include "BlockRing.h"
+#include "iBlockReader.h"
+#include "iBlockWriter.h"
+#include "SampleBlock.h"
+#include "flags.h"
+
+using namespace std;
+
+/**
+ * Bounded queue of SampleBlocks handing a stream from one thread to another.
+ * The producer first publishes the format of the stream with begin(...), which
+ * creates the BlockRing of 'capacity' blocks the stream goes through. It then
+ * fills a free block from acquire() and passes it on with push(...), while the
+ * consumer takes blocks with pop() and gives them back with release(...) once
+ * it is done, none of which takes a lock.
+ * Once every block is in use acquire() blocks, so a fast producer waits for its
+ * consumer instead of buffering the whole stream (backpressure).
+ * abort() wakes up both sides, which then throw, so that a pipeline whose
+ * stage failed can be torn down.
+ */
+class BlockQueue {
+public:
+	/**
+	 * Format of the stream going through the queue, see iBlockWriter::begin(...).
+	 */
+	struct Header {
+		size_t sample_rate;
+		size_t bit_res;
+		size_t num_channels;
+		long num_samples;
+	};
+
+	/**
+	 * \param Capacity Number of blocks in flight at most.
+	 * \param BlockSize Number of frames held by each block.
+	 * \param Wait How the producer and the consumer wait for each other.
+	 */
+	BlockQueue(size_t Capacity = PIPELINE_QUEUE_BLOCKS, size_t BlockSize = STREAM_BLOCK_SIZE, RingWait Wait = RING_BLOCK);
+
+	BlockQueue(const BlockQueue &other) = delete;
+	BlockQueue& operator=(const BlockQueue &other) = delete;
+
+	/**
+	 * Publishes the format of the stream, called by the producer before its first block.
+	 * \param header Format of the stream.
+	 */
+	void begin(const Header &header);
+
+	/**
+	 * Blocks until the producer called begin(...), or closed the queue without it.
+	 * \return Format of the stream.
+	 */
+	Header get_header();
+
+	/**
+	 * Blocks until a block is free.
+	 * \return An empty block for the producer to fill.
+	 */
+	SampleBlock * acquire();
+
+	/**
+	 * Passes a filled block from acquire() on to the consumer.
+	 * \param block The block.
+	 */
+	void push(SampleBlock *block);
+
+	/**
+	 * Marks the end of the stream, called by the producer after its last block.
+	 * Closing a stream which never began makes get_header() throw a runtime_error.
+	 */
+	void close();
+
+	/**
+	 * Blocks until a block was pushed, or the stream was closed.
+	 * \return The oldest block pushed, nullptr once the stream is closed and every block was popped.
+	 */
+	SampleBlock * pop();
+
+	/**
+	 * Gives a block from pop() back to the producer.
+	 * \param block The block.
+	 */
+	void release(SampleBlock *block);
+
+	/**
+	 * Makes every call blocked in (or made after) this one throw a runtime_error.
+	 */
+	void abort();
+
+	/**
+	 * \return Number of frames held by each block.
+	 */
+	inline size_t get_block_size() const {
+		return block_size;
+	}
+
+private:
+	/**
+	 * Throws once abort() was called.
+	 */
+	void check_aborted() const;
+
+	size_t capacity; /**< Number of blocks of the ring. */
+	size_t block_size; /**< Frames held by each block. */
+	RingWait wait_mode; /**< How both sides of the ring wait. */
+	Header header; /**< Format given to begin(...). */
+	bool begun; /**< Whether begin(...) was called. */
+	bool closed; /**< Whether close() was called. */
+	unique_ptr<BlockRing> ring; /**< Ring created by begin(...), the blocks go through it. */
+	atomic<bool> aborted; /**< Whether abort() was called. */
+	mutex lock; /**< Guards 'header', 'begun', 'closed' and 'ring' until the stream begins. */
+	condition_variable changed; /**< Notified when the stream begins, is closed, or is aborted. */
+};
+
+/**
+ * Consuming end of a BlockQueue, so that anything reading an iBlockReader
+ * (a Mixer, SignalStats, read_rest(), ...) can read a stream produced by
+ * another thread. Blocks are copied out of the queue as they are read,
+ * so read_block(...) may be called with blocks of any capacity.
+ */
+class QueueReader : public iBlockReader {
+public:
+	/**
+	 * \param Queue Queue to read from, it is not owned by the reader.
+	 * \param Name Name given to the stream, as returned by get_file_name().
+	 */
+	QueueReader(BlockQueue *Queue, string Name = "pipeline") : queue{Queue}, current{nullptr}, offset{0} {
+		file_name = Name;
+	}
+
+	virtual ~QueueReader();
+
+	/**
+	 * Waits for the producer to begin the stream, after which its format is available.
+	 */
+	void open_queue();
+
+	/**
+	 * A QueueReader only reads from its queue, an invalid_argument exception is thrown.
+	 */
+	virtual void open(istream &is, string filename = "std::cin");
+
+	virtual string get_extension() const {
+		return ".pipeline";
+	}
+
+protected:
+	virtual size_t read_frames(SampleBlock &block, size_t max_frames);
+
+private:
+	BlockQueue *queue; /**< Queue the stream is read from. */
+	SampleBlock *current; /**< Block popped from the queue and not fully read yet, if any. */
+	size_t offset; /**< Frames of 'current' already read. */
+};
+
+/**
+ * Producing end of a BlockQueue, so that anything writing to an iBlockWriter
+ * (a Mixer, a Pipeline stage, ...) can feed a stream read by another thread.
+ * The stream given to begin(...) is ignored, end() closes the queue.
+ */
+class QueueWriter : public iBlockWriter {
+public:
+	/**
+	 * \param Queue Queue to write to, it is not owned by the writer.
+	 */
+	QueueWriter(BlockQueue *Queue) : queue{Queue} { }
+
+	virtual void begin(ostream &os, size_t SampleRate, size_t BitRes,
+			size_t NumChannels, long NumSamples = -1);
+
+	/**
+	 * Same as begin(...), for callers without an output stream.
+	 * \param header Format of the stream.
+	 */
+	void begin(const BlockQueue::Header &header) {
+		queue->begin(header);
+	}
+
+	virtual void write_block(const SampleBlock &block);
+	virtual void end();
+
+private:
+	BlockQueue *queue; /**< Queue the stream is written to. */
+};
+
+#endif
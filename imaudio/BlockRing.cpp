@@ -0,0 +1,108 @@
+#include <thread>
+
+#include "BlockRing.h"
+#include "Trace.h"
+
+/**
+ * Tells the processor we are spinning, which frees resources for the other hardware thread of the core.
+ */
+static inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#endif
+}
+
+BlockRing::BlockRing(size_t NumChannels, size_t BlockSize, size_t Capacity, RingWait Wait) :
+	wait_mode{Wait}, full_blocks(max((size_t)1, Capacity)), free_blocks(max((size_t)1, Capacity)), closed{false}, sleepers{0} {
+	// the rings can hold every block, so pushing to them never fails
+	for (size_t i = 0; i < max((size_t)1, Capacity); i++) {
+		blocks.push_back(unique_ptr<SampleBlock>(new SampleBlock(NumChannels, BlockSize)));
+		free_blocks.try_push(blocks.back().get());
+	}
+}
+
+SampleBlock * BlockRing::acquire() {
+	SampleBlock *block = nullptr;
+	while (!closed.load(memory_order_acquire)) {
+		if (free_blocks.try_pop(block)) {
+			return block;
+		}
+
+		// the consumer is behind, wait for it to give a block back
+		wait(free_blocks, "queue_full");
+	}
+
+	return nullptr;
+}
+
+void BlockRing::push(SampleBlock *block) {
+	full_blocks.try_push(block);
+	notify();
+}
+
+SampleBlock * BlockRing::pop() {
+	SampleBlock *block = nullptr;
+	while (true) {
+		if (full_blocks.try_pop(block)) {
+			return block;
+		}
+
+		// the closed flag is set after the last push, so the ring is checked once more
+		if (closed.load(memory_order_acquire)) {
+			return full_blocks.try_pop(block) ? block : nullptr;
+		}
+
+		// the producer is behind, wait for its next block
+		wait(full_blocks, "queue_empty");
+	}
+}
+
+void BlockRing::release(SampleBlock *block) {
+	free_blocks.try_push(block);
+	notify();
+}
+
+void BlockRing::close() {
+	closed.store(true, memory_order_release);
+	unique_lock<mutex> guard(lock);
+	wakeup.notify_all();
+}
+
+void BlockRing::wait(const SpscRing<SampleBlock *> &ring, const char *event) {
+	TRACE_SCOPE(event);
+	auto ready = [&]() {
+		return !ring.empty() || closed.load(memory_order_acquire);
+	};
+
+	for (size_t i = 0; i < RING_SPIN_TRIES; i++) {
+		if (ready()) {
+			return;
+		}
+
+		cpu_relax();
+	}
+
+	if (wait_mode == RING_SPIN) {
+		while (!ready()) {
+			this_thread::yield();
+		}
+
+		return;
+	}
+
+	// announce the sleep before the last check, notify() checks for sleepers after
+	// publishing its block, so one of the two always sees the other
+	unique_lock<mutex> guard(lock);
+	sleepers.fetch_add(1);
+	atomic_thread_fence(memory_order_seq_cst);
+	wakeup.wait(guard, ready);
+	sleepers.fetch_sub(1);
+}
+
+void BlockRing::notify() {
+	atomic_thread_fence(memory_order_seq_cst);
+	if (sleepers.load(memory_order_relaxed)) {
+		unique_lock<mutex> guard(lock);
+		wakeup.notify_all();
+	}
+}
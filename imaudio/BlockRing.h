@@ -0,0 +1,181 @@
+#ifndef BLOCKRING_H
+#define BLOCKRING_H
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include "SampleBlock.h"
+#include "flags.h"
+
+using namespace std;
+
+/**
+ * How the ends of a BlockRing wait for each other.
+ */
+enum RingWait {
+	RING_BLOCK, /**< Spin briefly, then sleep until the other end wakes us up (default). */
+	RING_SPIN /**< Never sleep, lowest latency, but the waiting thread keeps its core busy. */
+};
+
+/**
+ * Lock-free ring of values for exactly one producer thread and one consumer
+ * thread. The producer only writes 'tail' and the consumer only writes 'head',
+ * each on a cache line of its own, and each side keeps a copy of the other
+ * sides index so that it only reads the shared line when it seems full (or empty).
+ * The capacity is rounded up to a power of two.
+ */
+template <typename T>
+class SpscRing {
+public:
+	/**
+	 * \param Capacity Number of values the ring must be able to hold.
+	 */
+	SpscRing(size_t Capacity) : head{0}, cached_tail{0}, tail{0}, cached_head{0} {
+		size_t size = 1;
+		while (size < Capacity) {
+			size <<= 1;
+		}
+
+		slots.resize(size);
+		mask = size - 1;
+	}
+
+	/**
+	 * Called by the producer only.
+	 * \param value Value to add.
+	 * \return Whether or not the value was added, false if the ring is full.
+	 */
+	bool try_push(const T &value) {
+		const size_t t = tail.load(memory_order_relaxed);
+		if (t - cached_head == slots.size()) {
+			cached_head = head.load(memory_order_acquire);
+			if (t - cached_head == slots.size()) {
+				return false;
+			}
+		}
+
+		slots[t & mask] = value;
+		tail.store(t + 1, memory_order_release);
+		return true;
+	}
+
+	/**
+	 * Called by the consumer only.
+	 * \param value Set to the oldest value of the ring.
+	 * \return Whether or not a value was taken, false if the ring is empty.
+	 */
+	bool try_pop(T &value) {
+		const size_t h = head.load(memory_order_relaxed);
+		if (h == cached_tail) {
+			cached_tail = tail.load(memory_order_acquire);
+			if (h == cached_tail) {
+				return false;
+			}
+		}
+
+		value = slots[h & mask];
+		head.store(h + 1, memory_order_release);
+		return true;
+	}
+
+	/**
+	 * May be called from any thread, the answer may be outdated by the time it returns.
+	 * \return Whether or not the ring is empty.
+	 */
+	bool empty() const {
+		return head.load(memory_order_acquire) == tail.load(memory_order_acquire);
+	}
+
+private:
+	char pad0[CACHE_LINE_SIZE]; /**< Keeps 'head' off the line of whatever precedes the ring. */
+	atomic<size_t> head; /**< Number of values ever popped, written by the consumer. */
+	size_t cached_tail; /**< Last value of 'tail' seen by the consumer. */
+	char pad1[CACHE_LINE_SIZE]; /**< Keeps the indexes of both sides on separate lines. */
+	atomic<size_t> tail; /**< Number of values ever pushed, written by the producer. */
+	size_t cached_head; /**< Last value of 'head' seen by the producer. */
+	char pad2[CACHE_LINE_SIZE]; /**< Keeps 'tail' off the line of the slots. */
+	vector<T> slots; /**< Values, the i'th value pushed is at i & mask. */
+	size_t mask; /**< Size of 'slots' minus 1. */
+};
+
+/**
+ * Pool of SampleBlocks cycling between one producer thread and one consumer
+ * thread through two SpscRings, so moving a block costs a couple of atomic
+ * operations and never allocates. The producer fills a block from acquire()
+ * and hands it over with push(...), the consumer takes it with pop() and hands
+ * it back with release(...). With every block in use acquire() waits, so the
+ * producer never runs more than 'capacity' blocks ahead of the consumer.
+ * Either side may close() the ring: the consumer still gets the blocks pushed
+ * before it, after which pop() returns nullptr, and acquire() returns nullptr
+ * right away, which is how a consumer stops its producer early.
+ */
+class BlockRing {
+public:
+	/**
+	 * \param NumChannels Number of channels of every block.
+	 * \param BlockSize Number of frames held by every block.
+	 * \param Capacity Number of blocks in the pool.
+	 * \param Wait How each side waits for the other.
+	 */
+	BlockRing(size_t NumChannels, size_t BlockSize = STREAM_BLOCK_SIZE,
+			size_t Capacity = PIPELINE_QUEUE_BLOCKS, RingWait Wait = RING_BLOCK);
+
+	BlockRing(const BlockRing &other) = delete;
+	BlockRing& operator=(const BlockRing &other) = delete;
+
+	/**
+	 * Called by the producer, waits until a block is free.
+	 * \return An empty block to fill, nullptr once the ring is closed.
+	 */
+	SampleBlock * acquire();
+
+	/**
+	 * Called by the producer, hands a block from acquire() to the consumer.
+	 * \param block The filled block.
+	 */
+	void push(SampleBlock *block);
+
+	/**
+	 * Called by the consumer, waits until a block was pushed.
+	 * \return The oldest block pushed, nullptr once the ring is closed and every block was popped.
+	 */
+	SampleBlock * pop();
+
+	/**
+	 * Called by the consumer, hands a block from pop() back to the producer.
+	 * \param block The block.
+	 */
+	void release(SampleBlock *block);
+
+	/**
+	 * Closes the ring, and wakes up the other side if it is waiting.
+	 */
+	void close();
+
+private:
+	/**
+	 * Waits for the ring to be closed, or for a value in the given ring.
+	 * \param ring Ring the caller pops from.
+	 * \param event Name of the wait, as shown by traces.
+	 */
+	void wait(const SpscRing<SampleBlock *> &ring, const char *event);
+
+	/**
+	 * Wakes up the other side, if it is asleep.
+	 */
+	void notify();
+
+	RingWait wait_mode; /**< How each side waits for the other. */
+	vector<unique_ptr<SampleBlock>> blocks; /**< Every block of the pool. */
+	SpscRing<SampleBlock *> full_blocks; /**< Blocks pushed by the producer. */
+	SpscRing<SampleBlock *> free_blocks; /**< Blocks released by the consumer. */
+	atomic<bool> closed; /**< Whether close() was called. */
+	atomic<int> sleepers; /**< Number of threads asleep (or going to sleep) in wait(...). */
+	mutex lock; /**< Only taken to sleep, and to wake up sleepers. */
+	condition_variable wakeup; /**< Notified by push(...), release(...) and close() when someone sleeps. */
+};
+
+#endif
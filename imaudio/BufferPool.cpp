@@ -0,0 +1,101 @@
+#include <new>
+#include <stdlib.h>
+
+#include "BufferPool.h"
+#include "Profile.h"
+#include "flags.h"
+
+// buffers of class k hold (BUFFER_ALIGNMENT << k) bytes
+static const size_t BUFFER_ALIGNMENT = 64;
+static const size_t NUM_CLASSES = 24;
+
+/**
+ * Free lists of a single thread, the buffers are freed with the thread.
+ */
+struct BufferCache {
+	~BufferCache();
+
+	vector<void *> free_lists[NUM_CLASSES]; /**< Cached buffers of each size class. */
+	size_t bytes = 0; /**< Total size of the cached buffers. */
+};
+
+static thread_local BufferCache cache;
+
+// set once 'cache' is destroyed, buffers freed after that (by other thread_local
+// or static objects) go straight back to the system
+static thread_local bool cache_destroyed = false;
+
+BufferCache::~BufferCache() {
+	for (auto &list : free_lists) {
+		for (auto buffer : list) {
+			free(buffer);
+		}
+	}
+
+	cache_destroyed = true;
+}
+
+/**
+ * \param bytes Size of a buffer.
+ * \return The smallest size class holding that many bytes, NUM_CLASSES if there is none.
+ */
+static size_t size_class(size_t bytes) {
+	size_t k = 0;
+	while (k < NUM_CLASSES && (BUFFER_ALIGNMENT << k) < bytes) {
+		k++;
+	}
+
+	return k;
+}
+
+void * BufferPool::allocate(size_t bytes) {
+	const size_t k = size_class(bytes);
+	if (k < NUM_CLASSES && use_buffer_pool && !cache_destroyed && !cache.free_lists[k].empty()) {
+		void * buffer = cache.free_lists[k].back();
+		cache.free_lists[k].pop_back();
+		cache.bytes -= BUFFER_ALIGNMENT << k;
+		PROFILE_COUNT(COUNTER_BUFFERS_REUSED, 1);
+		return buffer;
+	}
+
+	void * buffer = nullptr;
+	const size_t size = k < NUM_CLASSES ? BUFFER_ALIGNMENT << k : bytes;
+	if (posix_memalign(&buffer, BUFFER_ALIGNMENT, size) != 0) {
+		throw bad_alloc();
+	}
+
+	PROFILE_COUNT(COUNTER_ALLOCATIONS, 1);
+	return buffer;
+}
+
+void BufferPool::deallocate(void *buffer, size_t bytes) {
+	const size_t k = size_class(bytes);
+	if (k >= NUM_CLASSES || !use_buffer_pool || cache_destroyed ||
+			cache.bytes + (BUFFER_ALIGNMENT << k) > BUFFER_POOL_MAX_CACHED) {
+		free(buffer);
+		return;
+	}
+
+	cache.free_lists[k].push_back(buffer);
+	cache.bytes += BUFFER_ALIGNMENT << k;
+}
+
+void BufferPool::release() {
+	if (cache_destroyed) {
+		return;
+	}
+
+	for (auto &list : cache.free_lists) {
+		for (auto buffer : list) {
+			free(buffer);
+		}
+
+		list.clear();
+	}
+
+	cache.bytes = 0;
+}
+
+size_t BufferPool::cached_bytes() {
+	return cache_destroyed ? 0 : cache.bytes;
+}
@@ -0,0 +1,83 @@
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <vector>
+#include <stddef.h>
+
+using namespace std;
+
+/**
+ * Per thread pool of reusable sample buffers.
+ * Buffers are 64 byte aligned (a cache line), and rounded up to a power of two
+ * size class, starting at 64 bytes. Freed buffers are kept in a free list of
+ * their class, owned by the thread freeing them, and handed out again by the
+ * next allocation of that class on the same thread without any locking.
+ * At most BUFFER_POOL_MAX_CACHED bytes are kept per thread, buffers larger than
+ * the biggest class and buffers past that limit go straight back to the system.
+ * When 'use_buffer_pool' (see flags.h) is cleared, buffers are still aligned but never cached.
+ */
+class BufferPool {
+public:
+	/**
+	 * \param bytes Minimum size of the buffer.
+	 * \return A 64 byte aligned buffer, a bad_alloc exception is thrown if none could be allocated.
+	 */
+	static void * allocate(size_t bytes);
+
+	/**
+	 * Returns a buffer to the pool of the calling thread.
+	 * \param buffer Buffer returned by allocate(...).
+	 * \param bytes Size given to allocate(...) for that buffer.
+	 */
+	static void deallocate(void *buffer, size_t bytes);
+
+	/**
+	 * Frees every buffer cached by the calling thread.
+	 */
+	static void release();
+
+	/**
+	 * \return The number of bytes cached by the calling thread.
+	 */
+	static size_t cached_bytes();
+};
+
+/**
+ * Standard allocator handing out BufferPool buffers, so containers
+ * of samples reuse the storage freed by earlier operations.
+ */
+template <typename T>
+struct PoolAllocator {
+	typedef T value_type;
+
+	PoolAllocator() { }
+
+	template <typename U>
+	PoolAllocator(const PoolAllocator<U> &other) { }
+
+	T * allocate(size_t n) {
+		return (T *)BufferPool::allocate(n * sizeof(T));
+	}
+
+	void deallocate(T *buffer, size_t n) {
+		BufferPool::deallocate(buffer, n * sizeof(T));
+	}
+};
+
+template <typename T, typename U>
+inline bool operator==(const PoolAllocator<T> &a, const PoolAllocator<U> &b) {
+	return true;
+}
+
+template <typename T, typename U>
+inline bool operator!=(const PoolAllocator<T> &a, const PoolAllocator<U> &b) {
+	return false;
+}
+
+/**
+ * Storage of integer samples used by Channel and SampleBlock.
+ * Swapping the allocator here changes how every sample buffer is allocated.
+ */
+typedef vector<long, PoolAllocator<long>> SampleVector;
+
+#endif
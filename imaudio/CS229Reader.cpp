@@ -3,9 +3,36 @@
 #include <ctype.h>
 #include <algorithm>
 #include <strings.h>
+#include <string.h>
+#include <sys/stat.h>
 
 #include "CS229Reader.h"
 
+static const char index_magic[4] = { 'C', 'S', 'I', '2' };
+
+/**
+ * Identifies the version of a file a line index was built from.
+ * \param filename Name of the file.
+ * \param stamp Set to the size, the modification time (seconds and nanoseconds) and the inode of the file.
+ * \return Whether or not the file could be found.
+ */
+static bool file_stamp(const string &filename, uint64_t stamp[4]) {
+	struct stat info;
+	if (stat(filename.c_str(), &info) != 0) {
+		return false;
+	}
+
+	stamp[0] = info.st_size;
+	stamp[1] = info.st_mtime;
+#ifdef __APPLE__
+	stamp[2] = info.st_mtimespec.tv_nsec;
+#else
+	stamp[2] = info.st_mtim.tv_nsec;
+#endif
+	stamp[3] = info.st_ino;
+	return true;
+}
+
 static const string invalid_format_msg = "Input file is not of type CS229!";
 static const string invalid_header_msg = "Invalid Key or Data in header.";
 static const string missing_data_msg = "Missing required header data";
@@ -25,7 +52,16 @@ AudioFile CS229Reader::read_file(istream &is, string filename) {
 	try {
 		AudioFile ret = AudioFile(filename, ".cs229",
 				header.at("SAMPLERATE"), header.at("BITRES"), header.at("CHANNELS"));
+
+		// allocate every channel once when the header declares the length,
+		// otherwise the channels grow by whole chunks as lines are read
+		auto samples = header.find("SAMPLES");
+		if (samples != header.end() && samples->second > 0) {
+			ret.reserve(samples->second);
+		}
+
 		read_channel_data(ret, is);
+		PROFILE_COUNT(COUNTER_SAMPLES_PARSED, ret.get_num_samples() * ret.get_num_channels());
 		return ret;
 
 	} catch (out_of_range e) {
@@ -40,6 +76,245 @@ AudioFile CS229Reader::read_file(istream &is, string filename) {
 	}
 }
 
+void CS229Reader::open(istream &is, string filename) {
+	header.clear();
+	current_line = 0;
+	frames_read = 0;
+
+	try {
+		check_header(is);
+		get_header_data(is);
+	} catch (const exception &e) {
+		// forward the exception we found, but add some additional information
+		throw invalid_argument(filename + " : exception occured at line : " + "\n\twith exception: "+ e.what());
+	}
+
+	try {
+		sample_rate = header.at("SAMPLERATE");
+		bit_res = header.at("BITRES");
+		num_channels = header.at("CHANNELS");
+	} catch (const out_of_range &e) {
+		throw out_of_range(missing_data_msg);
+	}
+
+	// same restrictions AudioFile places on its constructor
+	if (num_channels < 1 || num_channels >= 128) {
+		throw invalid_argument("Invalid num_channels in constructor.");
+	}
+
+	if (bit_res != 8 && bit_res != 16 && bit_res != 32) {
+		throw invalid_argument("Invalid bit_res in constructor.");
+	}
+
+	auto samples = header.find("SAMPLES");
+	num_samples = samples == header.end() ? -1 : samples->second;
+	stream = &is;
+	file_name = filename;
+	line_index.clear();
+
+	// only files on disk can be indexed
+	data_start = filename == "std::cin" ? -1 : (streamoff)is.tellg();
+}
+
+size_t CS229Reader::read_frames(SampleBlock &block, size_t max_frames) {
+	const long max_val = 1L << (bit_res - 1);
+	const long min_val = -(max_val - 1);
+	long values[128];
+	size_t frames = 0;
+	string line;
+
+	while (frames < max_frames && getline(*stream, line)) {
+		current_line++;
+
+		if (ignore_line(line)) {
+			continue;
+		}
+
+		parse_samples(line, values, num_channels);
+		for (size_t c = 0; c < num_channels; c++) {
+			if (values[c] > max_val || values[c] < min_val) {
+				throw overflow_error("Sample exceeds this Channels bit resolution!");
+			}
+
+			block.channel(c)[frames] = values[c];
+		}
+
+		frames++;
+	}
+
+	block.set_frames(frames);
+	frames_read += frames;
+
+	// the end of the data was reached, check if it matched the header
+	auto samples = header.find("SAMPLES");
+	if (frames < max_frames && samples != header.end() && frames_read != (size_t)samples->second) {
+		throw invalid_argument(invalid_num_sample);
+	}
+
+	return frames;
+}
+
+long CS229Reader::count_frames() {
+	if (num_samples >= 0) {
+		return num_samples;
+	}
+
+	const long frames = scan_data(nullptr);
+	return range_left < 0 ? frames : min(frames, range_left);
+}
+
+size_t CS229Reader::skip_frames(size_t frames) {
+	if (frames < CS229_INDEX_INTERVAL || data_start < 0) {
+		return iBlockReader::skip_frames(frames);
+	}
+
+	const streampos pos = stream->tellg();
+	const size_t target = frames_read + frames;
+	const size_t entry = target / CS229_INDEX_INTERVAL;
+
+	// the index only helps if it jumps past the frames already read
+	if (!load_index() || min(entry, line_index.size() - 1) * CS229_INDEX_INTERVAL <= frames_read) {
+		stream->clear();
+		stream->seekg(pos);
+		return iBlockReader::skip_frames(frames);
+	}
+
+	const size_t start = frames_read;
+	const size_t line = min(entry, line_index.size() - 1);
+	if (!seek_line(line)) {
+		stream->clear();
+		stream->seekg(pos);
+		return iBlockReader::skip_frames(frames);
+	}
+
+	frames_read = line * CS229_INDEX_INTERVAL;
+
+	return frames_read - start + iBlockReader::skip_frames(target - frames_read);
+}
+
+string CS229Reader::index_name(string filename) {
+	return filename + ".idx";
+}
+
+bool CS229Reader::load_index() {
+	if (!line_index.empty()) {
+		return true;
+	}
+
+	// the sidecar is only used if it was built from this very version of the file
+	uint64_t stamp[4];
+	ifstream is(index_name(file_name), ios::in | ios::binary);
+	if (file_stamp(file_name, stamp) && is.is_open()) {
+		char magic[4];
+		uint64_t fields[7];
+		is.read(magic, sizeof(magic));
+		is.read((char *)fields, sizeof(fields));
+
+		if (is && memcmp(magic, index_magic, sizeof(magic)) == 0 && equal(stamp, stamp + 4, fields) &&
+				fields[4] == (uint64_t)data_start && fields[5] == CS229_INDEX_INTERVAL) {
+			line_index.resize(fields[6]);
+			is.read((char *)line_index.data(), line_index.size() * sizeof(uint64_t));
+			if (is) {
+				return !line_index.empty();
+			}
+
+			line_index.clear();
+		}
+	}
+
+	build_index();
+	return !line_index.empty();
+}
+
+void CS229Reader::build_index() {
+	line_index.clear();
+	stream->clear();
+	stream->seekg(data_start);
+	scan_data(&line_index);
+
+	uint64_t stamp[4];
+	if (!file_stamp(file_name, stamp)) {
+		return;
+	}
+
+	ofstream os(index_name(file_name), ios::out | ios::binary);
+	if (os.is_open()) {
+		const uint64_t fields[7] = { stamp[0], stamp[1], stamp[2], stamp[3], (uint64_t)data_start,
+			CS229_INDEX_INTERVAL, (uint64_t)line_index.size() };
+		os.write(index_magic, sizeof(index_magic));
+		os.write((const char *)fields, sizeof(fields));
+		os.write((const char *)line_index.data(), line_index.size() * sizeof(uint64_t));
+	}
+}
+
+bool CS229Reader::seek_line(size_t line) {
+	for (int attempt = 0; attempt < 2; attempt++) {
+		// every line indexed follows a newline, any other byte means the file changed under its sidecar
+		if (line < line_index.size() && line_index[line] > 0) {
+			stream->clear();
+			stream->seekg((streamoff)line_index[line] - 1);
+			if (stream->get() == '\n') {
+				return true;
+			}
+		}
+
+		if (attempt == 0) {
+			build_index();
+		}
+	}
+
+	return false;
+}
+
+long CS229Reader::scan_data(vector<uint64_t> *index) {
+	// count the lines ignore_line(...) would not skip, a line is data as soon
+	// as its first non white space character is not '#', the rest of the line
+	// can then be skipped straight to the next newline
+	char buffer[1 << 16];
+	long frames = 0;
+	bool in_data = false;
+	bool in_comment = false;
+
+	// offsets are only tracked when building an index, a data line is indexed
+	// from the end of the previous data or comment line, so the blank lines
+	// before it are read again by getline(...) and ignored
+	uint64_t offset = index ? (uint64_t)stream->tellg() : 0;
+	uint64_t line_start = offset;
+
+	while (stream->read(buffer, sizeof(buffer)) || stream->gcount() > 0) {
+		const char * c = buffer;
+		const char * end = buffer + stream->gcount();
+
+		while (c < end) {
+			if (in_data || in_comment) {
+				c = (const char *)memchr(c, '\n', end - c);
+				if (!c) {
+					break;
+				}
+
+				frames += in_data;
+				in_data = in_comment = false;
+				line_start = offset + (c - buffer) + 1;
+			} else if (*c == '#') {
+				in_comment = true;
+			} else if (!isspace((unsigned char)*c)) {
+				if (index && frames % CS229_INDEX_INTERVAL == 0) {
+					index->push_back(line_start);
+				}
+
+				in_data = true;
+			}
+
+			c++;
+		}
+
+		offset += stream->gcount();
+	}
+
+	// the last line may not end with a newline
+	return frames + in_data;
+}
+
 void CS229Reader::check_header(istream &stream) {
 	string line;
 	while (getline(stream, line) && ignore_line(line)) { current_line++; }
@@ -150,12 +425,22 @@ bool CS229Reader::proc_header_line(string line) {
 }
 
 void CS229Reader::read_samples_from_line(AudioFile &file, string line) {
+	long values[128];
+	parse_samples(line, values, file.get_num_channels());
+
+	// add a sample to each channel in the AudioFile
+	for (auto i = 0; i < (int)file.get_num_channels(); i++) {
+		file[i].push_sample(values[i]);
+	}
+}
+
+void CS229Reader::parse_samples(const string &line, long *out, size_t count) {
 	istringstream stream(line);
 	string extra;
 	size_t next_index; // make sure this points to the end of the string
 
-	// read a sample for each channel in the AudioFile
-	for (auto i = 0; i < (int)file.get_num_channels(); i++) {
+	// read a sample for each channel
+	for (size_t i = 0; i < count; i++) {
 		string data;
 		stream >> data;
 		auto val = stol(data, &next_index);
@@ -164,7 +449,7 @@ void CS229Reader::read_samples_from_line(AudioFile &file, string line) {
 			throw invalid_argument(invalid_int);
 		}
 
-		file[i].push_sample(val);
+		out[i] = val;
 	}
 
 	// make sure there isn't any extra garbage data
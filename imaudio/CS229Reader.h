@@ -4,7 +4,10 @@
 #include <iostream>
 #include <fstream>
 #include <unordered_map>
+#include <vector>
+#include <stdint.h>
 #include "iFileReader.h"
+#include "iBlockReader.h"
 #include "AudioFile.h"
 
 using namespace std;
@@ -14,15 +17,84 @@ using namespace std;
  * to support reading from the .cs229 file format.
  * File data can be reader from either an input file name,
  * or from an input stream (such as std::cin).
+ * The file may also be streamed one SampleBlock at a time
+ * through the iBlockReader interface.
  */
-class CS229Reader : public iFileReader {
+class CS229Reader : public iFileReader, public iBlockReader {
 public:
-	CS229Reader() : current_line{0} { }
+	CS229Reader() : current_line{0}, frames_read{0}, data_start{-1} { }
 
 	AudioFile read_file(string filename) { return iFileReader::read_file(filename); }
 	virtual AudioFile read_file(istream &is, string filename = "std::cin");
 
+	void open(string filename) { iBlockReader::open(filename); }
+	virtual void open(istream &is, string filename = "std::cin");
+	virtual string get_extension() const { return ".cs229"; }
+
+	/**
+	 * When the header has no 'Samples' key, frames are counted by scanning
+	 * the rest of the stream for lines of data, without parsing the samples.
+	 * \return The number of frames in the stream.
+	 */
+	virtual long count_frames();
+
+	/**
+	 * Lines of data have no fixed size, so seeking to a frame of a file
+	 * uses an index of the offset of every CS229_INDEX_INTERVAL'th line
+	 * of data. The index is built by a single scan of the file the first
+	 * time it is needed, and cached in a sidecar file (see index_name(...))
+	 * for the next readers. The sidecar records the size, modification time
+	 * and inode of the file, and is rebuilt when any of them changed, or when
+	 * an offset it holds does not start a line. Short skips, and streams which can not seek
+	 * (std::cin), parse through the frames instead.
+	 * \param frames Number of frames to skip.
+	 * \return The number of frames skipped, less than 'frames' if the data ended first.
+	 */
+	virtual size_t skip_frames(size_t frames);
+
+	/**
+	 * \param filename Name of a .cs229 file.
+	 * \return The name of the sidecar file caching the line index of that file.
+	 */
+	static string index_name(string filename);
+
+protected:
+	virtual size_t read_frames(SampleBlock &block, size_t max_frames);
+
 private:
+	/**
+	 * Loads the line index of the file from its sidecar, or builds it by scanning
+	 * the data and saves it (a sidecar that can not be written is not an error).
+	 * A sidecar is only loaded if the size, modification time and inode it
+	 * records are those of the file.
+	 * The position of the stream is left unspecified.
+	 * \return Whether or not 'line_index' could be filled.
+	 */
+	bool load_index();
+
+	/**
+	 * Scans the data from 'data_start' to the end of the stream, recording the
+	 * offset of every CS229_INDEX_INTERVAL'th line of data, and saves them
+	 * to the sidecar. The position of the stream is left unspecified.
+	 */
+	void build_index();
+
+	/**
+	 * Moves the stream to an entry of the line index, after checking the
+	 * entry still starts a line. A stale index is rebuilt once.
+	 * \param line Entry of 'line_index' to seek to.
+	 * \return Whether or not the stream is at the start of that line.
+	 */
+	bool seek_line(size_t line);
+
+	/**
+	 * Counts the lines of data from the current position to the end of the
+	 * stream, without parsing the samples.
+	 * \param index If not null, the offset of every CS229_INDEX_INTERVAL'th line is added to it.
+	 * \return The number of lines of data.
+	 */
+	long scan_data(vector<uint64_t> *index);
+
 	/**
 	 * Reads the first valid line of data from the input stream.
 	 * For this file format that first line must be 'CS229', if 
@@ -80,6 +152,16 @@ private:
 	 */
 	void read_samples_from_line(AudioFile &file, string line);
 
+	/**
+	 * Reads exactly 'count' integers from the line into 'out'.
+	 * This method will throw an exception if the line has too few
+	 * samples, too many samples, or contains unexpected characters.
+	 * \param line String representation of the line to parse samples from.
+	 * \param out Array of at least 'count' values to store the samples in.
+	 * \param count Number of samples expected on the line.
+	 */
+	void parse_samples(const string &line, long *out, size_t count);
+
 	/**
 	 * Determines whether or not the given line should be ignored.
 	 * For the CS229 file, ignored lines are lines that are
@@ -107,6 +189,9 @@ private:
 	unordered_map<string, int> header;
 
 	unsigned current_line; /**< Useful for printing out errors. */
+	size_t frames_read; /**< Number of frames read or skipped so far. */
+	streamoff data_start; /**< Offset of the line following 'StartData', -1 if the stream can not seek. */
+	vector<uint64_t> line_index; /**< Offset of every CS229_INDEX_INTERVAL'th line of data, empty until needed. */
 };
 
 #endif
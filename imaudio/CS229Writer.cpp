@@ -1,28 +1,92 @@
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 
 #include "CS229Writer.h"
 
 void CS229Writer::write_file(AudioFile &file, ostream &os) {
+	file.quantize();
+
 	// print out the header
-	os << "CS229" << endl;
-	os << endl;
-	os << "# Generated by 'CS229Writer'" << endl;
-	os << endl;
-	os << "Channels " << file.get_num_channels() << endl;
-	os << "BitRes " << file.get_bit_res() << endl;
-	os << "SampleRate " << file.get_sample_rate() << endl;
-	os << "Samples " << file.get_num_samples() << endl;
-	os << endl;
-	os << "StartData" << endl;
-	os << endl;
+	write_header(os, file.get_sample_rate(), file.get_bit_res(),
+			file.get_num_channels(), file.get_num_samples());
 
 	// now print out all of the data
 	for (size_t i = 0; i < file.get_num_samples(); i++) {
 		for (size_t c = 0; c < file.get_num_channels(); c++) {
-			os << file[c][i] << " ";
+			os << file[c].get_sample(i) << " ";
+		}
+
+		// no flush per line, the stream flushes its buffer when it fills up
+		os << '\n';
+	}
+}
+
+void CS229Writer::begin(ostream &os, size_t SampleRate, size_t BitRes,
+		size_t NumChannels, long NumSamples) {
+	stream = &os;
+	num_channels = NumChannels;
+	write_header(os, SampleRate, BitRes, NumChannels, NumSamples);
+	begin_overview(SampleRate, BitRes, NumChannels);
+}
+
+void CS229Writer::write_block(const SampleBlock &block) {
+	PROFILE_SCOPE(TIMER_WRITE_BLOCK);
+
+	// a sample takes at most 11 characters followed by a space
+	buffer.resize(block.get_frames() * (num_channels * 12 + 1));
+
+	// format the whole block as the '<<' operator would, then write it all at once
+	char * data = buffer.data();
+	for (size_t i = 0; i < block.get_frames(); i++) {
+		for (size_t c = 0; c < num_channels; c++) {
+			data = format_sample(block.channel(c)[i], data);
+			*data++ = ' ';
 		}
 
-		os << endl;
+		*data++ = '\n';
 	}
+
+	stream->write(buffer.data(), data - buffer.data());
+	PROFILE_COUNT(COUNTER_BYTES_WRITTEN, data - buffer.data());
+	add_overview(block);
+}
+
+void CS229Writer::end() {
+	stream->flush();
+	end_overview();
+}
+
+char * CS229Writer::format_sample(long sample, char * out) {
+	unsigned long value = sample < 0 ? -(unsigned long)sample : sample;
+	if (sample < 0) {
+		*out++ = '-';
+	}
+
+	// write the digits backwards, then reverse them in place
+	char * first = out;
+	do {
+		*out++ = '0' + value % 10;
+		value /= 10;
+	} while (value);
+
+	reverse(first, out);
+	return out;
+}
+
+void CS229Writer::write_header(ostream &os, size_t SampleRate, size_t BitRes,
+		size_t NumChannels, long NumSamples) {
+	os << "CS229" << endl;
+	os << endl;
+	os << "# Generated by 'CS229Writer'" << endl;
+	os << endl;
+	os << "Channels " << NumChannels << endl;
+	os << "BitRes " << BitRes << endl;
+	os << "SampleRate " << SampleRate << endl;
+	if (NumSamples >= 0) {
+		os << "Samples " << NumSamples << endl;
+	}
+	os << endl;
+	os << "StartData" << endl;
+	os << endl;
 }
@@ -2,15 +2,45 @@
 #define CS229WRITER_H
 
 #include "iFileWriter.h"
+#include "iBlockWriter.h"
 
 using namespace std;
 
-class CS229Writer : public iFileWriter {
+/**
+ * Implements iFileWriter to output the .cs229 file format,
+ * and iBlockWriter to stream the same format block by block.
+ */
+class CS229Writer : public iFileWriter, public iBlockWriter {
 public:
+	CS229Writer() : stream{nullptr}, num_channels{0} { }
+
 	void write_file(AudioFile &file, string filename) { iFileWriter::write_file(file, filename); }
 	virtual void write_file(AudioFile &file, ostream &os);
 
+	virtual void begin(ostream &os, size_t SampleRate, size_t BitRes,
+			size_t NumChannels, long NumSamples = -1);
+	virtual void write_block(const SampleBlock &block);
+	virtual void end();
+
 private:
+	/**
+	 * Writes the header, up to and including 'StartData'.
+	 * The 'Samples' entry is omitted when NumSamples is negative.
+	 */
+	void write_header(ostream &os, size_t SampleRate, size_t BitRes,
+			size_t NumChannels, long NumSamples);
+
+	/**
+	 * Writes the decimal representation of a sample, without a terminator.
+	 * \param sample Sample to format, must fit within 32 bits.
+	 * \param out Buffer with room for at least 11 characters.
+	 * \return Pointer past the last character written.
+	 */
+	static char * format_sample(long sample, char * out);
+
+	ostream *stream; /**< Stream given to begin(...). */
+	size_t num_channels; /**< Number of channels given to begin(...). */
+	vector<char> buffer; /**< Text of the block being encoded. */
 };
 
 #endif
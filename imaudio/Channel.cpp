@@ -5,6 +5,10 @@
 #include <math.h>
 
 #include "Channel.h"
+#include "Dither.h"
+#include "Limiter.h"
+#include "Saturate.h"
+#include "Profile.h"
 #include "flags.h"
 
 static const string assign_msg = "strict_data enforced during assignment";
@@ -13,18 +17,54 @@ static const string length_msg = "strict_data enabled: Channels must have the sa
 static const string invalid_msg = "strict_data enabled: Channels must have the same bit_res";
 static const string invalid_bit_res = "Invalid bit_res in constructor.";
 
-Channel::Channel(size_t BitRes) : bit_res{BitRes} { 
+/**
+ * Brings every sample within the range of 'bit_res', as 'overflow_policy' asks.
+ * \param samples Samples to check.
+ * \param count Number of samples.
+ * \param bit_res Resolution (in bits) the samples must fit in.
+ */
+static void apply_overflow_policy(long *samples, size_t count, size_t bit_res) {
+	const long max_val = 1L << (bit_res - 1);
+	const long min_val = -(max_val - 1);
+	PROFILE_COUNT(COUNTER_OVERFLOW_CHECKS, count);
+
+	switch (overflow_policy) {
+	case OVERFLOW_THROW:
+		if (count_overflows(samples, count, min_val, max_val)) {
+			throw overflow_error(overflow_msg);
+		}
+		break;
+
+	case OVERFLOW_SATURATE:
+		clipped_samples += saturate(samples, count, min_val, max_val);
+		break;
+
+	case OVERFLOW_LIMIT:
+		// the limiter only changes anything when a sample is out of range
+		if (count_overflows(samples, count, min_val, max_val)) {
+			Limiter::limit(samples, count, bit_res);
+		}
+		break;
+	}
+}
+
+Channel::Channel(size_t BitRes, bool FloatFormat) : num_samples{0}, float_format{FloatFormat}, bit_res{BitRes} { 
 	if (bit_res != 8 && bit_res != 16 && bit_res != 32) {
 		throw invalid_argument(invalid_bit_res);
 	}
 }
 
-Channel::Channel(const Channel &other) : bit_res{other.bit_res} {
-	samples = other.samples;
+// copies only share the chunks, they are copied once either side modifies them
+Channel::Channel(const Channel &other) : num_samples{other.num_samples}, float_format{other.float_format}, bit_res{other.bit_res} {
+	chunks = other.chunks;
+	offsets = other.offsets;
+	float_samples = other.float_samples;
 }
 
-Channel::Channel(const Channel &&other) : bit_res{other.bit_res} {
-	samples = move(other.samples);
+Channel::Channel(const Channel &&other) : num_samples{other.num_samples}, float_format{other.float_format}, bit_res{other.bit_res} {
+	chunks = move(other.chunks);
+	offsets = move(other.offsets);
+	float_samples = move(other.float_samples);
 }
 
 Channel& Channel::operator=(const Channel &other) {
@@ -35,7 +75,11 @@ Channel& Channel::operator=(const Channel &other) {
 	// we need to pull constants from 'other', not use our current constants
 	*const_cast<size_t*>(&bit_res) = other.bit_res;
 
-	samples = other.samples;
+	chunks = other.chunks;
+	offsets = other.offsets;
+	num_samples = other.num_samples;
+	float_samples = other.float_samples;
+	float_format = other.float_format;
 	return *this;
 }
 
@@ -47,16 +91,20 @@ Channel& Channel::operator=(const Channel &&other) {
 	// we need to pull constants from 'other', not use our current constants
 	*const_cast<size_t*>(&bit_res) = other.bit_res;
 
-	samples = move(other.samples);
+	chunks = move(other.chunks);
+	offsets = move(other.offsets);
+	num_samples = other.num_samples;
+	float_samples = move(other.float_samples);
+	float_format = other.float_format;
 	return *this;
 }
 
 ostream& operator<<(ostream &os, const Channel &channel) {
-	for (auto i = 0; i < (int)channel.samples.size(); i++) {
-		if (i != (int)channel.samples.size() -1 ) {
-			os << channel.samples[i] << ", ";
+	for (auto i = 0; i < (int)channel.size(); i++) {
+		if (i != (int)channel.size() -1 ) {
+			os << channel.get_sample(i) << ", ";
 		} else {
-			os << channel.samples[i];
+			os << channel.get_sample(i);
 		}
 	}
 
@@ -66,44 +114,90 @@ ostream& operator<<(ostream &os, const Channel &channel) {
 Channel Channel::operator+(const Channel &other) {
 	// check if we should allow Channel addition
 	if (strict_data) {
-		if (other.samples.size() != samples.size()) {
+		if (other.size() != size()) {
 			throw length_error(length_msg);
 		} else if (other.bit_res != bit_res) {
 			throw invalid_argument(invalid_msg);
 		}
 	}
 
+	// floating point channels are summed without any quantization
+	if (float_format || other.float_format) {
+		Channel last = Channel(max(other.bit_res, bit_res), true);
+		last.float_samples.resize(max(other.size(), size()), 0.0);
+		for (auto i = 0; i < (int)size(); i++) {
+			last.float_samples[i] += float_at(i);
+		}
+
+		for (auto i = 0; i < (int)other.size(); i++) {
+			last.float_samples[i] += other.float_at(i);
+		}
+
+		return last;
+	}
+
 	// all is good, perform the addition
 	Channel last = Channel(max(other.bit_res, bit_res));
-	for (auto i = 0; i < (int)max(other.samples.size(), samples.size()); i++) {
-		auto sample0 = i < (int)other.samples.size() ? other.samples[i] : 0;
-		auto sample1 = i < (int)samples.size() ? samples[i] : 0;
+	last.resize(max(other.size(), size()));
+	long *out = last.data();
+	for_each_chunk([out](const long *in, size_t count, size_t offset) {
+		for (size_t i = 0; i < count; i++) {
+			out[offset + i] = in[i];
+		}
+	});
 
-		last.push_sample(sample0 + sample1);
-	}
+	other.for_each_chunk([out](const long *in, size_t count, size_t offset) {
+		for (size_t i = 0; i < count; i++) {
+			out[offset + i] += in[i];
+		}
+	});
 
+	apply_overflow_policy(out, last.size(), last.bit_res);
 	return last;
 }
 
 Channel Channel::operator*(const Channel &other) {
 	// check if we should allow Channel addition
 	if (strict_data) {
-		if (other.samples.size() != samples.size()) {
+		if (other.size() != size()) {
 			throw length_error(length_msg);
 		} else if (other.bit_res != bit_res) {
 			throw invalid_argument(invalid_msg);
 		}
 	}
 
-	// all is good, perform the addition
-	Channel last = Channel(max(other.bit_res, bit_res));
-	for (auto i = 0; i < (int)max(other.samples.size(), samples.size()); i++) {
-		auto sample0 = i < (int)other.samples.size() ? other.samples[i] : 1;
-		auto sample1 = i < (int)samples.size() ? samples[i] : 1;
+	// floating point channels are multiplied without any quantization
+	if (float_format || other.float_format) {
+		Channel last = Channel(max(other.bit_res, bit_res), true);
+		last.float_samples.resize(max(other.size(), size()), 1.0);
+		for (auto i = 0; i < (int)size(); i++) {
+			last.float_samples[i] *= float_at(i);
+		}
+
+		for (auto i = 0; i < (int)other.size(); i++) {
+			last.float_samples[i] *= other.float_at(i);
+		}
 
-		last.push_sample(sample0 * sample1);
+		return last;
 	}
 
+	// all is good, perform the multiplication
+	Channel last = Channel(max(other.bit_res, bit_res));
+	last.set_samples(SampleVector(max(other.size(), size()), 1));
+	long *out = last.data();
+	for_each_chunk([out](const long *in, size_t count, size_t offset) {
+		for (size_t i = 0; i < count; i++) {
+			out[offset + i] = in[i];
+		}
+	});
+
+	other.for_each_chunk([out](const long *in, size_t count, size_t offset) {
+		for (size_t i = 0; i < count; i++) {
+			out[offset + i] *= in[i];
+		}
+	});
+
+	apply_overflow_policy(out, last.size(), last.bit_res);
 	return last;
 }
 
@@ -117,10 +211,12 @@ Channel Channel::concat(const Channel &other) {
 	
 	// all is good, concat 'other' Channel to this Channel
 	Channel last = Channel(max(other.bit_res, bit_res));
-	last.samples = samples;
-	for (auto x : other.samples) {
-		last.samples.push_back(x);
-	}
+	last.chunks = chunks;
+	last.offsets = offsets;
+	last.num_samples = num_samples;
+	last.float_samples = float_samples;
+	last.float_format = float_format;
+	last.append(other);
 
 	return last;
 }
@@ -133,20 +229,105 @@ void Channel::append(const Channel &other) {
 		}
 	}
 	
+	// mixing formats promotes the result to floating point
+	if (other.float_format && !float_format) {
+		convert_to_float();
+	}
+
 	// all is good, concat 'other' Channel to this Channel
-	for (auto x : other.samples) {
-		samples.push_back(x);
+	if (float_format) {
+		for (auto i = 0; i < (int)other.size(); i++) {
+			float_samples.push_back(other.float_at(i));
+		}
+
+		return;
+	}
+
+	// link the chunks of 'other', they are only copied if either Channel modifies them
+	for (auto &chunk : other.chunks) {
+		if (chunk->empty()) {
+			continue;
+		}
+
+		chunks.push_back(chunk);
+		offsets.push_back(num_samples);
+		num_samples += chunk->size();
+	}
+}
+
+Channel Channel::convert_bit_res(size_t BitRes, bool dither) const {
+	// floating point channels are rescaled, quantization happens later
+	if (float_format) {
+		Channel last = Channel(BitRes, true);
+		last.float_samples = float_samples;
+
+		const double scale = pow(2.0, (double)BitRes - (double)bit_res);
+		for (auto &sample : last.float_samples) {
+			sample *= scale;
+		}
+
+		return last;
+	}
+
+	Channel last = Channel(BitRes);
+	last.resize(size());
+
+	long *out = last.data();
+	const size_t bits = bit_res;
+
+	for_each_chunk([=](const long *src, size_t count, size_t offset) {
+		long *dst = out + offset;
+
+		if (BitRes >= bits || !dither) {
+			convert_samples(src, dst, count, bits, BitRes);
+
+		} else {
+			// saturate to the symmetric range so every writer can store the result
+			const long limit = (1L << (BitRes - 1)) - 1;
+			const double scale = 1.0 / (1L << (bits - BitRes));
+			Dither &noise = Dither::thread_instance();
+			for (size_t i = 0; i < count; i++) {
+				auto val = (long)floor(src[i] * scale + noise.next_tpdf() + 0.5);
+				dst[i] = min(max(val, -limit), limit);
+			}
+		}
+	});
+
+	return last;
+}
+
+void Channel::convert_samples(const long *src, long *dst, size_t count, size_t from, size_t to) {
+	const long limit = (1L << (to - 1)) - 1;
+
+	if (to >= from) {
+		// widening is exact, only +2^(from-1) leaves the symmetric range
+		const long scale = 1L << (to - from);
+		for (size_t i = 0; i < count; i++) {
+			dst[i] = min(max(src[i] * scale, -limit), limit);
+		}
+
+	} else {
+		// saturate to the symmetric range so every writer can store the result
+		const double scale = 1.0 / (1L << (from - to));
+		for (size_t i = 0; i < count; i++) {
+			dst[i] = min(max((long)floor(src[i] * scale + 0.5), -limit), limit);
+		}
 	}
 }
 
 Channel Channel::operator*(const double &scalar) {
 	Channel other = Channel(*this);
-	for (auto &sample : other.samples) {
-		if (is_valid_sample(sample * scalar)) {
-			sample *= scalar;
-		} else {
-			throw overflow_error(overflow_msg);
+	for (auto &sample : other.float_samples) {
+		sample *= scalar;
+	}
+
+	if (!float_format) {
+		long *data = other.data();
+		for (size_t i = 0; i < other.num_samples; i++) {
+			data[i] *= scalar;
 		}
+
+		apply_overflow_policy(data, other.num_samples, bit_res);
 	}
 
 	return other;
@@ -154,12 +335,17 @@ Channel Channel::operator*(const double &scalar) {
 
 Channel Channel::operator-() {
 	Channel other = *this;
-	for (auto &sample : other.samples) {
-		if (is_valid_sample(-sample)) {
-			sample = -sample;
-		} else {
-			throw overflow_error(overflow_msg);
+	for (auto &sample : other.float_samples) {
+		sample = -sample;
+	}
+
+	if (!float_format) {
+		long *data = other.data();
+		for (size_t i = 0; i < other.num_samples; i++) {
+			data[i] = -data[i];
 		}
+
+		apply_overflow_policy(data, other.num_samples, bit_res);
 	}
 
 	return other;
@@ -168,16 +354,144 @@ Channel Channel::operator-() {
 void Channel::push_sample(long sample) {
 	// check bounds specified by the bit resolution
 	if (!is_valid_sample(sample)) {
-		throw overflow_error(overflow_msg);
+		if (overflow_policy == OVERFLOW_THROW) {
+			throw overflow_error(overflow_msg);
+		}
+
+		// a single sample has nothing to look ahead to, so it can only be clipped
+		const long max_val = 1L << (bit_res - 1);
+		sample = min(max(sample, -(max_val - 1)), max_val);
+		clipped_samples++;
 	}
 
 	// all is good, add the sample to our samples vector
-	samples.push_back(sample);
+	if (float_format) {
+		float_samples.push_back(sample);
+		return;
+	}
+
+	// shared chunks are never modified, and full chunks are never grown (which would
+	// copy every sample), a new chunk is started after them instead, as large as the
+	// Channel so far so the number of chunks only grows with the log of the size
+	if (chunks.empty() || chunks.back().use_count() > 1 ||
+			chunks.back()->size() == chunks.back()->capacity()) {
+		if (chunks.empty() || !chunks.back()->empty() || chunks.back().use_count() > 1) {
+			chunks.push_back(make_shared<SampleVector>());
+			offsets.push_back(num_samples);
+		}
+
+		chunks.back()->reserve(max((size_t)CHANNEL_CHUNK_SIZE, num_samples));
+	}
+
+	chunks.back()->push_back(sample);
+	num_samples++;
+}
+
+void Channel::resize(size_t n) {
+	if (float_format) {
+		float_samples.resize(n, 0.0);
+	} else {
+		flatten().resize(n, 0);
+		num_samples = n;
+	}
+}
+
+void Channel::reserve(size_t n) {
+	if (float_format) {
+		float_samples.reserve(n);
+	} else {
+		flatten().reserve(n);
+	}
+}
+
+long Channel::find_sample(size_t n) const {
+	// the last chunk starting at or before 'n'
+	const size_t k = upper_bound(offsets.begin(), offsets.end(), n) - offsets.begin() - 1;
+	return (*chunks[k])[n - offsets[k]];
+}
+
+SampleVector& Channel::flatten_chunks() {
+	SampleVector flat;
+	flat.reserve(num_samples);
+	for (auto &chunk : chunks) {
+		flat.insert(flat.end(), chunk->begin(), chunk->end());
+	}
+
+	set_samples(move(flat));
+	return *chunks[0];
+}
+
+void Channel::set_samples(SampleVector &&flat) {
+	num_samples = flat.size();
+	chunks.assign(1, make_shared<SampleVector>(move(flat)));
+	offsets.assign(1, 0);
+}
+
+void Channel::push_float(double sample) {
+	if (!float_format) {
+		convert_to_float();
+	}
+
+	float_samples.push_back(sample);
+}
+
+void Channel::convert_to_float() {
+	if (float_format) {
+		return;
+	}
+
+	float_samples.resize(num_samples);
+	double *out = float_samples.data();
+	for_each_chunk([out](const long *in, size_t count, size_t offset) {
+		for (size_t i = 0; i < count; i++) {
+			out[offset + i] = in[i];
+		}
+	});
+
+	chunks.clear();
+	offsets.clear();
+	num_samples = 0;
+	float_format = true;
+}
+
+void Channel::quantize() {
+	if (!float_format) {
+		return;
+	}
+
+	SampleVector flat(float_samples.size());
+	for (auto i = 0; i < (int)float_samples.size(); i++) {
+		flat[i] = lround(float_samples[i]);
+	}
+
+	apply_overflow_policy(flat.data(), flat.size(), bit_res);
+	set_samples(move(flat));
+
+	float_samples.clear();
+	float_samples.shrink_to_fit();
+	float_format = false;
+}
+
+long Channel::quantize_sample(double sample) const {
+	const long max_val = 1L << (bit_res - 1);
+	const long min_val = -(max_val - 1);
+	const long val = lround(sample);
+
+	if (val > max_val || val < min_val) {
+		if (overflow_policy == OVERFLOW_THROW) {
+			throw overflow_error(overflow_msg);
+		}
+
+		clipped_samples++;
+		return min(max(val, min_val), max_val);
+	}
+
+	return val;
 }
 
-bool Channel::is_valid_sample(long sample) {
-	const long max_val = pow(2, bit_res) / 2;
-	const long min_val = -(pow(2, bit_res) / 2 - 1);
+bool Channel::is_valid_sample(long sample) const {
+	const long max_val = 1L << (bit_res - 1);
+	const long min_val = -(max_val - 1);
 
 	return sample <= max_val && sample >= min_val;
 }
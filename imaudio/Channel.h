@@ -2,24 +2,45 @@
 #define CHANNEL_H
 
 #include <vector>
+#include <memory>
 #include <iostream>
 
+#include "BufferPool.h"
+
 using namespace std;
 
 /**
  * Representation of a channel. A channel requires that
  * a bit resolution be specified, it will then insure that all
  * data added to it fits within the bit resolution.
- * Internally all data is stored within a vector.
+ * Internally the data is stored as a rope, a list of chunks which
+ * may be shared with other Channels. Copying, concat(...) and append(...)
+ * only link the chunks of the source Channel, chunks are copied the first
+ * time a shared chunk has to be modified, and the rope is flattened into a single
+ * contiguous chunk only when direct access to the samples is requested.
+ * Chunks are allocated from the BufferPool, so the storage of temporary
+ * Channels is reused by the next operations of the same thread.
+ * push_sample(...) never reallocates the samples already pushed, unless room
+ * was made with reserve(...) it adds chunks which double the size of the Channel.
  * A channel has no knowledge of it's sample rate, and
  * therefore could not be 'played' back to the user at all.
+ *
+ * A channel may optionally use a floating point working format.
+ * In this format samples are stored as unquantized doubles (on the
+ * same scale as the integer samples, exact for every integer sample
+ * up to MAX_BIT_RES bits) and are not checked against
+ * the bit resolution until the channel is quantized, either through
+ * quantize() or when a sample is requested through get_sample(...)
+ * (as the file writers do). This allows a chain of processing steps
+ * to only round to an integer once.
  */
 class Channel {
 public:
 	/**
 	 * \param BitRes Resolution (in bits) of the data stored in this channel.
+	 * \param FloatFormat Whether or not this channel uses the floating point working format.
 	 */
-	Channel(size_t BitRes);
+	Channel(size_t BitRes, bool FloatFormat = false);
 	Channel(const Channel &other);
 	Channel(const Channel &&other);
 	Channel& operator=(const Channel &other);
@@ -28,9 +49,10 @@ public:
 
 	/**
 	 * Scales each sample of this channel by the input scalar value.
-	 * Resulting integers are truncated.
+	 * Resulting integers are truncated (floating point channels are not quantized).
 	 * If the scalar were to cause a sample to exceed this channels
-	 * bit resolution, this operator will thrown an overflow_exception.
+	 * bit resolution, 'overflow_policy' decides what happens (see flags.h),
+	 * by default an overflow_exception is thrown.
 	 * \param scalar Scalar value to apply to each sample of this channel.
 	 */
 	Channel operator*(const double &scalar);
@@ -38,16 +60,17 @@ public:
 	/**
 	 * Inverts each sample of this Channel.
 	 * Because the max_value of the bit_res is 1 greater than the 
-	 * absolute value of the min_value of the bit_res, this operator
-	 * will throw an overflow_exception when trying to invert
-	 * any instances of max_value.
+	 * absolute value of the min_value of the bit_res, inverting
+	 * any instance of max_value is an overflow, handled as 'overflow_policy'
+	 * asks (by default an overflow_exception is thrown).
 	 */
 	Channel operator-();
 
 	/**
 	 * Creates a new channel where each sample is the sum of this channels samples
 	 * and the samples of the 'other' Channel. 
-	 * If the sum of any sample exceeds the resulting bit resolution an overflow_error is thrown.
+	 * If the sum of any sample exceeds the resulting bit resolution 'overflow_policy'
+	 * decides whether an overflow_error is thrown, or the result is clipped or limited.
 	 * If 'strict_data' is enabled in 'flags.h':
 	 * 	Both channels must have the same bit_resolution (invalid_argument exception).
 	 * 	Both channels must have the same size (length_error exception).
@@ -61,8 +84,8 @@ public:
 	/**
 	 * Creates a new channel where each sample is multiplied by the corresponding
 	 * sample in the 'other' CHannel.
-	 * If the sumer of any sample exceed the resulting bit resolution an 
-	 * overflow_error is thrown.
+	 * If the product of any sample exceeds the resulting bit resolution 'overflow_policy'
+	 * decides whether an overflow_error is thrown, or the result is clipped or limited.
 	 * If 'strict_data' is enabled in 'flags.h':
 	 * 	Both channels must have the same bit_resolution (invalid_argument exception).
 	 * 	Both channels must have the same size (length_error exception).
@@ -84,14 +107,46 @@ public:
 	/**
 	 * Similar to conat(...), but does not create a new channel.
 	 * Inplace adds the concat of other to this channel.
+	 * Integer samples are not copied, the chunks of 'other' are shared.
 	 * \param other The other Channelt to append to this channel.
 	 */
 	void append(const Channel &other);
 
+	/**
+	 * Creates a new Channel with every sample rescaled from this Channel's
+	 * bit resolution to the input bit resolution. Increasing the resolution
+	 * shifts each sample up by the difference in bits, which is exact for every
+	 * sample of the range [-(2^(n-1)-1), 2^(n-1)] but the top one: +2^(n-1) is
+	 * saturated to 2^(m-1)-1. Decreasing the resolution divides each sample and
+	 * rounds to the nearest integer. Either way the result is saturated to the
+	 * symmetric range +/-(2^(m-1)-1) so that every writer can store it.
+	 * When 'dither' is set, triangular (TPDF) noise of +/- 1 LSB of the target
+	 * resolution is added before rounding. Saturation never throws an overflow_error.
+	 * Floating point channels are only rescaled and remain unquantized.
+	 * If BitRes is not 8, 16, or 32 the Channel constructor throws an invalid_argument exception.
+	 * \param BitRes Resolution (in bits) of the returned Channel.
+	 * \param dither Whether or not to apply TPDF dither when reducing resolution.
+	 * \return A new Channel with the converted samples.
+	 */
+	Channel convert_bit_res(size_t BitRes, bool dither = false) const;
+
+	/**
+	 * Rescales integer samples from one bit resolution to another, as
+	 * convert_bit_res(...) does without dither, for callers streaming blocks
+	 * instead of holding whole Channels.
+	 * \param src Samples to convert.
+	 * \param dst Where to store the converted samples, may be 'src'.
+	 * \param count Number of samples to convert.
+	 * \param from Resolution (in bits) of the input samples.
+	 * \param to Resolution (in bits) of the output samples.
+	 */
+	static void convert_samples(const long *src, long *dst, size_t count, size_t from, size_t to);
+
 	/**
 	 * Attempts to push the input sample to the end of this Channels sample vector.
 	 * If the sample data will not fit in this Channel's bit resolution, this 
-	 * method will throw an overflow_error exception.
+	 * method will throw an overflow_error exception, unless 'overflow_policy'
+	 * is set to clip or limit, in which case the sample is clipped.
 	 * is_valid_sample will be used to determine whether or not the sample is valid.
 	 * \param Input sample to concat to the samples vector.
 	 */
@@ -103,27 +158,195 @@ public:
 	 * \param sample A sample to be tested.
 	 * \return Whether or not the sample is valid for this Channel.
 	 */
-	bool is_valid_sample(long sample);
+	bool is_valid_sample(long sample) const;
+
+	/**
+	 * Converts this Channel to the floating point working format.
+	 * This method does nothing if the Channel is already in that format.
+	 */
+	void convert_to_float();
+
+	/**
+	 * Rounds every sample of a floating point Channel to the nearest integer
+	 * and converts this Channel back to the integer format.
+	 * Samples that do not fit in this Channel's bit resolution are handled
+	 * as 'overflow_policy' asks. Integer Channels are left untouched.
+	 */
+	void quantize();
+
+	/**
+	 * Pushes an unquantized sample to the end of this Channel, the Channel
+	 * is converted to the floating point format first if necessary.
+	 * \param sample Input sample to concat to the samples vector.
+	 */
+	void push_float(double sample);
+
+	/**
+	 * Reads the sample at the given index as an integer. For floating point
+	 * Channels the sample is quantized on the fly, throwing an overflow_error
+	 * if it does not fit the bit resolution (or clipping it, when 'overflow_policy'
+	 * is not OVERFLOW_THROW). This is the accessor writers
+	 * should use, as it works for both formats.
+	 * \param n Index of the sample to grab.
+	 * \return The (quantized) sample at the given index.
+	 */
+	inline long get_sample(size_t n) const {
+		return float_format ? quantize_sample(float_samples[n]) : sample_at(n);
+	}
+
+	/**
+	 * Calls f(data, count, offset) for every chunk of integer samples
+	 * in order, where 'offset' is the index of the chunk's first sample.
+	 * This reads the samples of a Channel without flattening it.
+	 * Only valid for Channels in the integer format.
+	 * \param f Function to call for every chunk.
+	 */
+	template <typename F>
+	void for_each_chunk(F f) const {
+		size_t offset = 0;
+		for (auto &chunk : chunks) {
+			f((const long *)chunk->data(), chunk->size(), offset);
+			offset += chunk->size();
+		}
+	}
+
+	/**
+	 * \return The number of chunks the integer samples are split into.
+	 */
+	inline size_t num_chunks() const {
+		return chunks.size();
+	}
+
+	/**
+	 * \return Whether or not this Channel uses the floating point working format.
+	 */
+	inline bool is_float() const {
+		return float_format;
+	}
+
+	/**
+	 * Resizes this Channel to hold exactly 'n' samples. New samples are
+	 * set to 0, and are not checked against the bit resolution, this is meant
+	 * for preallocating storage that will then be filled through data().
+	 * \param n The new number of samples.
+	 */
+	void resize(size_t n);
+
+	/**
+	 * Allocates room for 'n' samples up front, so pushing samples up to that
+	 * count fills a single chunk. The Channel is flattened first, so this
+	 * should be called before any samples are added.
+	 * \param n The number of samples to make room for.
+	 */
+	void reserve(size_t n);
+
+	/**
+	 * Direct access to the samples of an integer Channel. Writes through this
+	 * pointer are not checked against the bit resolution.
+	 * The Channel is flattened first, and the pointer is only valid until
+	 * the Channel is copied or its size changes.
+	 * \return Pointer to the first sample.
+	 */
+	inline long * data() {
+		return flatten().data();
+	}
+
+	/**
+	 * Direct access to the unquantized samples of a floating point Channel.
+	 * \return Pointer to the first floating point sample.
+	 */
+	inline double * float_data() {
+		return float_samples.data();
+	}
 
 	/**
 	 * \returns The number of samples stored in this channel.
 	 */
 	inline size_t size() const {
-		return samples.size();
+		return float_format ? float_samples.size() : num_samples;
 	}
 
 	/**
 	 * Forwards the [] operator to the vector. Exceptions generated
 	 * by the vector's [] operator are not handled by this method.
+	 * Only valid for Channels in the integer format, flattens the Channel.
 	 * \param n Index of the sample to grab.
 	 * \return The sample at the given index.
 	 */
 	inline long& operator[](size_t n) {
-		return samples[n];
+		return flatten()[n];
 	}
-	
+
+	/**
+	 * \return Resolution (in bits) of the data stored in this channel.
+	 */
+	inline size_t get_bit_res() const {
+		return bit_res;
+	}
+
 private:
-	vector<long> samples; /**< The array of samples representing this channel. */
+	/**
+	 * Rounds a floating point sample to the nearest integer, and validates
+	 * the result against this Channel's bit resolution, clipping it unless
+	 * 'overflow_policy' is OVERFLOW_THROW.
+	 * \param sample The unquantized sample.
+	 * \return The quantized sample.
+	 */
+	long quantize_sample(double sample) const;
+
+	/**
+	 * \param n Index of the sample to grab.
+	 * \return The sample at the given index as a double, regardless of format.
+	 */
+	inline double float_at(size_t n) const {
+		return float_format ? float_samples[n] : sample_at(n);
+	}
+
+	/**
+	 * \param n Index of the sample to grab.
+	 * \return The integer sample at the given index, without flattening.
+	 */
+	inline long sample_at(size_t n) const {
+		return chunks.size() == 1 ? (*chunks[0])[n] : find_sample(n);
+	}
+
+	/**
+	 * Locates the chunk holding the sample at index 'n' with a binary search.
+	 * \param n Index of the sample to grab.
+	 * \return The integer sample at the given index.
+	 */
+	long find_sample(size_t n) const;
+
+	/**
+	 * Makes sure the samples are held by a single chunk owned only
+	 * by this Channel, copying them if needed.
+	 * \return The chunk holding every sample.
+	 */
+	inline SampleVector& flatten() {
+		if (chunks.size() == 1 && chunks[0].use_count() == 1) {
+			return *chunks[0];
+		}
+
+		return flatten_chunks();
+	}
+
+	/**
+	 * Slow path of flatten(), joins every chunk into a new one.
+	 * \return The chunk holding every sample.
+	 */
+	SampleVector& flatten_chunks();
+
+	/**
+	 * Replaces the integer samples of this Channel with a single chunk.
+	 * \param flat The new samples.
+	 */
+	void set_samples(SampleVector &&flat);
+
+	vector<shared_ptr<SampleVector>> chunks; /**< Rope of integer samples, shared between Channels until modified. */
+	vector<size_t> offsets; /**< Index of the first sample of each chunk. */
+	size_t num_samples; /**< Number of integer samples held by 'chunks'. */
+	vector<double> float_samples; /**< Unquantized samples, used in place of 'samples' by the floating point format. */
+	bool float_format; /**< Whether 'float_samples' or 'samples' holds this channel's data. */
 	const size_t bit_res; /**< Resolution (in bits) of the data for this channel. */
 };
 
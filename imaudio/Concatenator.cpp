@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <stdexcept>
+#include <memory>
+
+#include "Concatenator.h"
+
+void Concatenator::add_input(string file_name) {
+	inputs.push_back(file_name);
+}
+
+void Concatenator::check_inputs() {
+	if (inputs.empty()) {
+		throw invalid_argument("Concatenator requires at least one input.");
+	}
+
+	for (auto i = 0; i < (int)inputs.size(); i++) {
+		unique_ptr<iBlockReader> reader(make_reader());
+		reader->open_range(inputs[i]);
+
+		if (i == 0) {
+			sample_rate = reader->get_sample_rate();
+			bit_res = reader->get_bit_res();
+			num_channels = reader->get_num_channels();
+			num_samples = reader->get_num_samples();
+			continue;
+		}
+
+		if (strict_data) {
+			if (reader->get_bit_res() != bit_res) {
+				throw invalid_argument("other.bit_res must match this->bit_res");
+			}
+
+			if (reader->get_num_channels() != num_channels) {
+				throw invalid_argument("other.num_channels must match this->num_channels");
+			}
+
+			if (reader->get_sample_rate() != sample_rate) {
+				throw invalid_argument("other.sample_rate must ALWAYS match this->sample_rate");
+			}
+		}
+
+		// the input with more channels decides the sample rate, as in AudioFile::concat
+		if (!(num_channels > reader->get_num_channels())) {
+			sample_rate = reader->get_sample_rate();
+		}
+
+		bit_res = max(bit_res, reader->get_bit_res());
+		num_channels = max(num_channels, reader->get_num_channels());
+		if (num_samples >= 0 && reader->get_num_samples() >= 0) {
+			num_samples += reader->get_num_samples();
+		} else {
+			num_samples = -1;
+		}
+	}
+}
+
+void Concatenator::concat(iBlockWriter &writer, ostream &os) {
+	check_inputs();
+
+	SampleBlock output = SampleBlock(num_channels, block_size);
+	writer.begin(os, sample_rate, bit_res, num_channels, num_samples);
+
+	for (auto &name : inputs) {
+		unique_ptr<iBlockReader> reader(make_reader());
+		reader->open_range(name);
+
+		// inputs with every channel are passed straight through
+		if (reader->get_num_channels() == num_channels) {
+			while (reader->read_block(output) > 0) {
+				writer.write_block(output);
+			}
+
+			continue;
+		}
+
+		// others are padded with silent channels, block by block
+		SampleBlock block = SampleBlock(reader->get_num_channels(), block_size);
+		size_t frames = 0;
+		while ((frames = reader->read_block(block)) > 0) {
+			output.clear(frames);
+			for (size_t c = 0; c < block.get_num_channels(); c++) {
+				const long * in = block.channel(c);
+				long * out = output.channel(c);
+				for (size_t i = 0; i < frames; i++) {
+					out[i] = in[i];
+				}
+			}
+
+			writer.write_block(output);
+		}
+	}
+
+	writer.end();
+}
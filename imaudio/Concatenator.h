@@ -0,0 +1,69 @@
+#ifndef CONCATENATOR_H
+#define CONCATENATOR_H
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <functional>
+
+#include "iBlockReader.h"
+#include "iBlockWriter.h"
+#include "SampleBlock.h"
+#include "flags.h"
+
+using namespace std;
+
+/**
+ * Streams any number of input files, one after the other, into a single output.
+ * The header of every input is read and validated before any data is written,
+ * after which each input is reopened and its sample data is passed through to
+ * the writer one block at a time, so memory use does not depend on the input sizes.
+ * Inputs are only held open one at a time, so any number of files can be joined.
+ * The rules match AudioFile::concat:
+ * If strict data is enabled:
+ * 	Every input must have the same bit res, number of channels,
+ * 	and sample rate as the first input (invalid_argument exception).
+ * Else
+ * 	The output has the largest bit res and number of channels.
+ * 	Inputs with fewer channels are padded with silent channels.
+ * 	Samples are passed through unscaled, as Channel::append(...) does.
+ */
+class Concatenator {
+public:
+	/**
+	 * \param MakeReader Creates the reader used to open each input, the Concatenator owns the result.
+	 * \param BlockSize Number of frames to pass through at a time.
+	 */
+	Concatenator(function<iBlockReader*()> MakeReader, size_t BlockSize = STREAM_BLOCK_SIZE) :
+		make_reader{MakeReader}, block_size{BlockSize} { }
+
+	/**
+	 * Adds an input to the end of the output.
+	 * \param file_name Name of the file to read.
+	 */
+	void add_input(string file_name);
+
+	/**
+	 * Validates every input, then streams them in order through the writer.
+	 * \param writer Writer used to format the output.
+	 * \param os Output stream to write the result to.
+	 */
+	void concat(iBlockWriter &writer, ostream &os);
+
+private:
+	/**
+	 * Reads the header of every input, validates them against the first
+	 * input, and determines the format of the output.
+	 */
+	void check_inputs();
+
+	function<iBlockReader*()> make_reader; /**< Creates the reader for each input. */
+	vector<string> inputs; /**< Input file names in the order they were added. */
+	size_t block_size; /**< Frames passed through at a time. */
+	size_t sample_rate; /**< Sample rate of the output. */
+	size_t bit_res; /**< Bit resolution of the output. */
+	size_t num_channels; /**< Number of channels of the output. */
+	long num_samples; /**< Number of frames of the output, -1 if unknown. */
+};
+
+#endif
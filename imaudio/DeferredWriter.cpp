@@ -0,0 +1,26 @@
+#include "DeferredWriter.h"
+
+void DeferredWriter::begin(ostream &Os, size_t SampleRate, size_t BitRes, size_t NumChannels, long NumSamples) {
+	os = &Os;
+	sample_rate = SampleRate;
+	bit_res = BitRes;
+	num_channels = NumChannels;
+	num_samples = NumSamples;
+}
+
+void DeferredWriter::write_block(const SampleBlock &block) {
+	start();
+	target->write_block(block);
+}
+
+void DeferredWriter::end() {
+	start();
+	target->end();
+}
+
+void DeferredWriter::start() {
+	if (os) {
+		target->begin(*os, sample_rate, bit_res, num_channels, num_samples);
+		os = nullptr;
+	}
+}
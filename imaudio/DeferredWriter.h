@@ -0,0 +1,50 @@
+#ifndef DEFERREDWRITER_H
+#define DEFERREDWRITER_H
+
+#include <iostream>
+
+#include "iBlockWriter.h"
+#include "SampleBlock.h"
+
+using namespace std;
+
+/**
+ * Holds back the header of another writer until the first block reaches it.
+ * Streams written to the standard output can not be removed once written, so
+ * a stream failing before any of its frames was decoded (or passed the overflow
+ * check) should leave nothing behind. The header is still written by end()
+ * when the stream holds no frame at all.
+ * set_overview_file(...) must be called on the wrapped writer itself.
+ */
+class DeferredWriter : public iBlockWriter {
+public:
+	/**
+	 * \param Target Writer to forward to, it is not owned by this writer.
+	 */
+	DeferredWriter(iBlockWriter *Target) : target{Target}, os{nullptr},
+		sample_rate{0}, bit_res{0}, num_channels{0}, num_samples{-1} { }
+
+	/**
+	 * Only records the format, the header is written with the first block.
+	 */
+	virtual void begin(ostream &os, size_t SampleRate, size_t BitRes,
+			size_t NumChannels, long NumSamples = -1);
+
+	virtual void write_block(const SampleBlock &block);
+	virtual void end();
+
+private:
+	/**
+	 * Writes the header of the wrapped writer, if it was not written yet.
+	 */
+	void start();
+
+	iBlockWriter *target; /**< Writer the stream is forwarded to. */
+	ostream *os; /**< Stream given to begin(...), nullptr once the header was written. */
+	size_t sample_rate; /**< Format given to begin(...). */
+	size_t bit_res; /**< Format given to begin(...). */
+	size_t num_channels; /**< Format given to begin(...). */
+	long num_samples; /**< Format given to begin(...). */
+};
+
+#endif
@@ -0,0 +1,14 @@
+#include <atomic>
+#include "Dither.h"
+
+using namespace std;
+
+static const uint64_t base_seed = 0x9E3779B97F4A7C15ULL;
+
+Dither::Dither(uint64_t Seed) : state{Seed ? Seed : base_seed} { }
+
+Dither& Dither::thread_instance() {
+	static atomic<uint64_t> next_thread{0};
+	static thread_local Dither dither = Dither(base_seed * (++next_thread));
+	return dither;
+}
@@ -0,0 +1,53 @@
+#ifndef DITHER_H
+#define DITHER_H
+
+#include <stdint.h>
+
+/**
+ * Small and fast pseudo random number generator used to produce
+ * dither noise when reducing the bit resolution of a Channel.
+ * Internally this is an xorshift64* generator, which is more than
+ * good enough for noise shaping and costs only a few instructions
+ * per sample.
+ * Each thread should use its own instance (see thread_instance()),
+ * as the generator state is not protected by any lock.
+ */
+class Dither {
+public:
+	/**
+	 * \param Seed Initial state for the generator, a seed of 0 is remapped to a non zero value.
+	 */
+	Dither(uint64_t Seed);
+
+	/**
+	 * \return A uniformly distributed value in the range [0.0, 1.0).
+	 */
+	inline double next_uniform() {
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+		return ((state * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+	/**
+	 * Triangular probability density function noise, computed as
+	 * the difference of two uniform values.
+	 * \return A value in the range (-1.0, 1.0) with a triangular distribution.
+	 */
+	inline double next_tpdf() {
+		return next_uniform() - next_uniform();
+	}
+
+	/**
+	 * Each thread is given its own generator the first time it calls
+	 * this method. Seeds are handed out in the order threads ask for them,
+	 * so single threaded programs always produce the same dither noise.
+	 * \return The generator owned by the calling thread.
+	 */
+	static Dither& thread_instance();
+
+private:
+	uint64_t state; /**< Current state of the xorshift generator. */
+};
+
+#endif
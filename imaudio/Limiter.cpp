@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <stdlib.h>
+#include <math.h>
+
+#include "Limiter.h"
+
+Limiter::Limiter(size_t NumChannels, size_t BitRes, size_t Lookahead) :
+	num_channels{NumChannels}, lookahead{max(Lookahead, (size_t)1)} {
+
+	max_val = 1L << (BitRes - 1);
+	min_val = -(max_val - 1);
+	ceiling = max_val - 1;
+	delay.resize(num_channels * lookahead);
+	smoothed.resize(lookahead);
+	reset();
+}
+
+void Limiter::reset() {
+	frame = 0;
+	fill(smoothed.begin(), smoothed.end(), 1.0);
+	smoothed_sum = lookahead;
+	window.clear();
+}
+
+size_t Limiter::process(const SampleBlock &in, SampleBlock &out) {
+	vector<const long *> in_ptrs(num_channels);
+	vector<long *> out_ptrs(num_channels);
+	for (size_t c = 0; c < num_channels; c++) {
+		in_ptrs[c] = in.channel(c);
+		out_ptrs[c] = out.channel(c);
+	}
+
+	const size_t written = process(in_ptrs.data(), in.get_frames(), out_ptrs.data());
+	out.set_frames(written);
+	return written;
+}
+
+size_t Limiter::flush(SampleBlock &out) {
+	vector<long *> out_ptrs(num_channels);
+	for (size_t c = 0; c < num_channels; c++) {
+		out_ptrs[c] = out.channel(c);
+	}
+
+	const size_t written = flush(out_ptrs.data());
+	out.set_frames(written);
+	return written;
+}
+
+void Limiter::limit(long *samples, size_t count, size_t BitRes) {
+	Limiter limiter = Limiter(1, BitRes);
+	long * const ptrs[] = { samples };
+
+	// the output is written behind the input, so this can work in place
+	const size_t written = limiter.process(ptrs, count, ptrs);
+	long * const rest[] = { samples + written };
+	limiter.flush(rest);
+}
+
+size_t Limiter::process(const long * const *in, size_t frames, long * const *out) {
+	size_t written = 0;
+	unsigned long overs = 0;
+
+	for (size_t i = 0; i < frames; i++) {
+		const size_t slot = frame % lookahead;
+		long peak = 0;
+
+		for (size_t c = 0; c < num_channels; c++) {
+			const long val = in[c][i];
+			overs += (val > max_val) | (val < min_val);
+			peak = max(peak, labs(val));
+			delay[c * lookahead + slot] = val;
+		}
+
+		if (advance(peak > ceiling ? ceiling / peak : 1.0, out, written)) {
+			written++;
+		}
+	}
+
+	clipped_samples += overs;
+	return written;
+}
+
+size_t Limiter::flush(long * const *out) {
+	size_t written = 0;
+	const size_t pushes = frame > 0 ? lookahead - 1 : 0;
+
+	// push silence through the delay line until the last real frame comes out
+	for (size_t i = 0; i < pushes; i++) {
+		const size_t slot = frame % lookahead;
+		for (size_t c = 0; c < num_channels; c++) {
+			delay[c * lookahead + slot] = 0;
+		}
+
+		if (advance(1.0, out, written)) {
+			written++;
+		}
+	}
+
+	reset();
+	return written;
+}
+
+bool Limiter::advance(double gain, long * const *out, size_t index) {
+	// sliding minimum of the required gain over the look-ahead window
+	while (!window.empty() && window.back().second >= gain) {
+		window.pop_back();
+	}
+
+	window.push_back(make_pair(frame, gain));
+	while (window.front().first + lookahead <= frame) {
+		window.pop_front();
+	}
+
+	// box filter the windowed minimum, the slot being replaced is also
+	// the delay line slot of the frame leaving the limiter
+	const size_t slot = (frame + 1) % lookahead;
+	smoothed_sum += window.front().second - smoothed[slot];
+	smoothed[slot] = window.front().second;
+	if (slot == 0) {
+		// avoid drifting away from the true sum
+		smoothed_sum = 0.0;
+		for (auto val : smoothed) {
+			smoothed_sum += val;
+		}
+	}
+
+	frame++;
+	if (frame < lookahead) {
+		return false;
+	}
+
+	const double applied = smoothed_sum / lookahead;
+	for (size_t c = 0; c < num_channels; c++) {
+		const long val = lround(delay[c * lookahead + slot] * applied);
+		out[c][index] = min(max(val, min_val), max_val);
+	}
+
+	return true;
+}
@@ -0,0 +1,90 @@
+#ifndef LIMITER_H
+#define LIMITER_H
+
+#include <vector>
+#include <deque>
+#include <utility>
+
+#include "SampleBlock.h"
+#include "flags.h"
+
+using namespace std;
+
+/**
+ * Look-ahead peak limiter used by the OVERFLOW_LIMIT policy.
+ * For every frame the limiter computes the gain needed to bring the
+ * loudest channel within the bit resolution, takes the minimum of that
+ * gain over the next 'lookahead' frames, and smooths it with a box filter
+ * of the same length. The smoothed gain is never above the gain any frame
+ * needs, so limited frames always fit, while the gain ramps down before
+ * a peak and back up after it instead of jumping. Every channel shares
+ * the same gain so the stereo image is kept.
+ *
+ * The output lags the input by 'lookahead - 1' frames, so process(...)
+ * may write fewer frames than it reads. Once the input runs out, flush(...)
+ * writes the frames still held by the limiter.
+ * Samples that left the bit resolution are counted in 'clipped_samples'.
+ */
+class Limiter {
+public:
+	/**
+	 * \param NumChannels Number of channels in each frame.
+	 * \param BitRes Resolution (in bits) the output must fit in.
+	 * \param Lookahead Number of frames the gain starts ramping down before a peak.
+	 */
+	Limiter(size_t NumChannels, size_t BitRes, size_t Lookahead = LIMITER_LOOKAHEAD);
+
+	/**
+	 * Limits the frames of 'in', and writes the delayed output to 'out'.
+	 * 'out' may be the same block as 'in'.
+	 * \param in Block of frames to limit.
+	 * \param out Block receiving the limited frames.
+	 * \return The number of frames written to 'out'.
+	 */
+	size_t process(const SampleBlock &in, SampleBlock &out);
+
+	/**
+	 * Writes the frames still held by the limiter, and resets it.
+	 * \param out Block receiving the frames, its capacity must be at least 'lookahead'.
+	 * \return The number of frames written to 'out'.
+	 */
+	size_t flush(SampleBlock &out);
+
+	/**
+	 * Limits a single channel of samples in place.
+	 * \param samples Samples to limit.
+	 * \param count Number of samples.
+	 * \param BitRes Resolution (in bits) the samples must fit in.
+	 */
+	static void limit(long *samples, size_t count, size_t BitRes);
+
+private:
+	/**
+	 * Core of the limiter, works on arrays of channel pointers.
+	 * \return The number of frames written to 'out'.
+	 */
+	size_t process(const long * const *in, size_t frames, long * const *out);
+	size_t flush(long * const *out);
+
+	/**
+	 * Feeds the gain required by the newest frame, and if a delayed frame
+	 * is ready writes it to 'out' at 'index'.
+	 * \return Whether or not a frame was written.
+	 */
+	bool advance(double gain, long * const *out, size_t index);
+
+	void reset();
+
+	size_t num_channels; /**< Number of channels in each frame. */
+	size_t lookahead; /**< Length of the look-ahead window and of the smoothing filter. */
+	long max_val; /**< Largest valid sample. */
+	long min_val; /**< Smallest valid sample. */
+	double ceiling; /**< Largest magnitude the limiter aims for. */
+	size_t frame; /**< Number of frames fed to the limiter so far. */
+	vector<long> delay; /**< Delay line, 'lookahead' samples per channel. */
+	vector<double> smoothed; /**< Last 'lookahead' windowed minimum gains. */
+	double smoothed_sum; /**< Sum of 'smoothed'. */
+	deque<pair<size_t, double>> window; /**< Candidates for the minimum gain of the window. */
+};
+
+#endif
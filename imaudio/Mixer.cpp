@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "Mixer.h"
+#include "Limiter.h"
+#include "Saturate.h"
+#include "Profile.h"
+
+static const string overflow_msg = "Sample exceeds this Channels bit resolution!";
+
+void Mixer::add_input(iBlockReader *reader, double gain) {
+	inputs.push_back({reader, gain});
+}
+
+void Mixer::check_inputs() {
+	if (inputs.empty()) {
+		throw invalid_argument("Mixer requires at least one input.");
+	}
+
+	iBlockReader *first = inputs[0].reader;
+	sample_rate = first->get_sample_rate();
+	bit_res = first->get_bit_res();
+	num_channels = first->get_num_channels();
+	num_samples = first->get_num_samples();
+
+	for (auto i = 1; i < (int)inputs.size(); i++) {
+		iBlockReader *other = inputs[i].reader;
+
+		if (strict_data) {
+			if (other->get_bit_res() != bit_res) {
+				throw invalid_argument("other.bit_res must match this->bit_res");
+			}
+
+			if (other->get_num_channels() != num_channels) {
+				throw invalid_argument("other.num_channels must match this->num_channels");
+			}
+
+			if (other->get_num_samples() >= 0 && num_samples >= 0 && other->get_num_samples() != num_samples) {
+				throw invalid_argument("other.num_samples must match this->num_samples");
+			}
+
+			if (other->get_sample_rate() != sample_rate) {
+				throw invalid_argument("other.sample_rate must ALWAYS match this->sample_rate");
+			}
+		}
+
+		// the input with more channels decides the sample rate, as in AudioFile::operator+
+		if (!(num_channels > other->get_num_channels())) {
+			sample_rate = other->get_sample_rate();
+		}
+
+		bit_res = max(bit_res, other->get_bit_res());
+		num_channels = max(num_channels, other->get_num_channels());
+		if (num_samples >= 0 && other->get_num_samples() >= 0) {
+			num_samples = max(num_samples, other->get_num_samples());
+		} else if (!strict_data || num_samples < 0) {
+			num_samples = -1;
+		}
+	}
+}
+
+void Mixer::mix(iBlockWriter &writer, ostream &os) {
+	check_inputs();
+
+	const long max_val = 1L << (bit_res - 1);
+	const long min_val = -(max_val - 1);
+
+	vector<SampleBlock> blocks;
+	vector<size_t> frames_read(inputs.size(), 0);
+	vector<bool> finished(inputs.size(), false);
+	for (auto &input : inputs) {
+		blocks.push_back(SampleBlock(input.reader->get_num_channels(), block_size));
+	}
+
+	SampleBlock output = SampleBlock(num_channels, block_size);
+	Limiter limiter = Limiter(num_channels, bit_res, min((size_t)LIMITER_LOOKAHEAD, block_size));
+	writer.begin(os, sample_rate, bit_res, num_channels, num_samples);
+
+	while (true) {
+		// pull the next block from every input that still has data
+		size_t frames = 0;
+		for (auto k = 0; k < (int)inputs.size(); k++) {
+			frames_read[k] = finished[k] ? 0 : inputs[k].reader->read_block(blocks[k]);
+			finished[k] = finished[k] || frames_read[k] < block_size;
+			frames = max(frames, frames_read[k]);
+		}
+
+		if (frames == 0) {
+			break;
+		}
+
+		if (strict_data) {
+			for (auto n : frames_read) {
+				if (n != frames) {
+					throw invalid_argument("other.num_samples must match this->num_samples");
+				}
+			}
+		}
+
+		{
+			PROFILE_SCOPE(TIMER_ARITHMETIC);
+
+			// scale each input (truncating, as Channel::operator*(double) does) and sum it
+			output.clear(frames);
+			for (auto k = 0; k < (int)inputs.size(); k++) {
+				const double gain = inputs[k].gain;
+				const long in_max = 1L << (inputs[k].reader->get_bit_res() - 1);
+				const long in_min = -(in_max - 1);
+
+				for (size_t c = 0; c < blocks[k].get_num_channels(); c++) {
+					const long * in = blocks[k].channel(c);
+					long * out = output.channel(c);
+
+					if (overflow_policy != OVERFLOW_THROW) {
+						// the accumulator has plenty of headroom, only the final sum is clipped or limited
+						for (size_t i = 0; i < frames_read[k]; i++) {
+							out[i] += (long)(in[i] * gain);
+						}
+
+						continue;
+					}
+
+					for (size_t i = 0; i < frames_read[k]; i++) {
+						const long scaled = in[i] * gain;
+						if (scaled > in_max || scaled < in_min) {
+							throw overflow_error(overflow_msg);
+						}
+
+						out[i] += scaled;
+					}
+				}
+			}
+
+			for (size_t c = 0; c < num_channels; c++) {
+				long * out = output.channel(c);
+				if (overflow_policy == OVERFLOW_THROW) {
+					if (count_overflows(out, frames, min_val, max_val)) {
+						throw overflow_error(overflow_msg);
+					}
+				} else if (overflow_policy == OVERFLOW_SATURATE) {
+					clipped_samples += saturate(out, frames, min_val, max_val);
+				}
+			}
+
+			PROFILE_COUNT(COUNTER_OVERFLOW_CHECKS, frames * num_channels);
+		}
+
+		if (overflow_policy != OVERFLOW_LIMIT) {
+			writer.write_block(output);
+		} else if (limiter.process(output, output) > 0) {
+			writer.write_block(output);
+		}
+
+		if (find(finished.begin(), finished.end(), false) == finished.end()) {
+			break;
+		}
+	}
+
+	// the limiter still holds the end of the mix
+	if (overflow_policy == OVERFLOW_LIMIT && limiter.flush(output) > 0) {
+		writer.write_block(output);
+	}
+
+	writer.end();
+}
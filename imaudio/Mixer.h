@@ -0,0 +1,77 @@
+#ifndef MIXER_H
+#define MIXER_H
+
+#include <vector>
+#include <iostream>
+
+#include "iBlockReader.h"
+#include "iBlockWriter.h"
+#include "SampleBlock.h"
+#include "flags.h"
+
+using namespace std;
+
+/**
+ * Streams any number of inputs into a single mixed output.
+ * Each input is read one block at a time, scaled by its own gain,
+ * and summed into a single accumulator block which is then passed
+ * to the writer, so memory use does not depend on the input sizes.
+ * The result matches folding the inputs with AudioFile::operator*(double)
+ * and AudioFile::operator+, including the strict_data rules:
+ * If strict data is enabled:
+ * 	Every input must have the same bit res, number of channels,
+ * 	number of samples, and sample rate (invalid_argument exception).
+ * Else
+ * 	The output has the largest bit res and number of channels.
+ * 	Shorter inputs are treated as if they had 0's beyond their end.
+ */
+class Mixer {
+public:
+	/**
+	 * \param BlockSize Number of frames to read from each input at a time.
+	 */
+	Mixer(size_t BlockSize = STREAM_BLOCK_SIZE) : block_size{BlockSize} { }
+
+	/**
+	 * Adds an input to this mixer. The reader must already be open,
+	 * and is not owned by the mixer.
+	 * \param reader Source of the input samples.
+	 * \param gain Scalar to multiply each sample of the input by.
+	 */
+	void add_input(iBlockReader *reader, double gain);
+
+	/**
+	 * Mixes every input and streams the result through the writer.
+	 * If a scaled or summed sample does not fit within its bit resolution
+	 * an overflow_error is thrown, unless 'overflow_policy' says otherwise.
+	 * When clipping or limiting, inputs are summed with the full headroom of
+	 * a long and only the final mix is brought back within the bit resolution.
+	 * \param writer Writer used to format the output.
+	 * \param os Output stream to write the mix to.
+	 */
+	void mix(iBlockWriter &writer, ostream &os);
+
+private:
+	/**
+	 * Validates the inputs against each other, and determines the
+	 * format of the output.
+	 */
+	void check_inputs();
+
+	/**
+	 * Single input of the mixer.
+	 */
+	struct Input {
+		iBlockReader *reader;
+		double gain;
+	};
+
+	vector<Input> inputs; /**< Inputs in the order they were added. */
+	size_t block_size; /**< Frames read from each input at a time. */
+	size_t sample_rate; /**< Sample rate of the output. */
+	size_t bit_res; /**< Bit resolution of the output. */
+	size_t num_channels; /**< Number of channels of the output. */
+	long num_samples; /**< Number of frames of the output, -1 if unknown. */
+};
+
+#endif
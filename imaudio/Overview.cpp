@@ -0,0 +1,327 @@
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+
+#include "Overview.h"
+#include "AudioFile.h"
+#include "AudioInfo.h"
+
+static const char overview_magic[4] = { 'O', 'V', 'W', '2' };
+static const string invalid_overview = "File is not a valid overview.";
+
+/**
+ * \param filename Name of a file.
+ * \param stamp Set to the size and the modification time (in nanoseconds) of the file, 0 if it can not be found.
+ */
+static void file_stamp(const string &filename, uint64_t stamp[2]) {
+	struct stat info;
+	stamp[0] = stamp[1] = 0;
+	if (stat(filename.c_str(), &info) != 0) {
+		return;
+	}
+
+	stamp[0] = info.st_size;
+#ifdef __APPLE__
+	stamp[1] = (uint64_t)info.st_mtimespec.tv_sec * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+	stamp[1] = (uint64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+}
+
+double OverviewEntry::rms() const {
+	return count ? sqrt(sum_squares / count) : 0.0;
+}
+
+Overview::Overview(size_t NumChannels, size_t BitRes, size_t SampleRate) :
+		num_channels{NumChannels}, bit_res{BitRes}, sample_rate{SampleRate},
+		num_frames{0}, source_stamp{0, 0}, levels(1), levels_valid{false} { }
+
+void Overview::add_block(const SampleBlock &block) {
+	const size_t frames = block.get_frames();
+	vector<OverviewEntry> &level = levels[0];
+	size_t offset = 0;
+
+	while (offset < frames) {
+		// start a new block once the last one is full
+		if (level.empty() || level.back().count == OVERVIEW_BLOCK_SIZE) {
+			level.resize(level.size() + num_channels, { LONG_MAX, LONG_MIN, 0.0, 0 });
+		}
+
+		const size_t base = level.size() - num_channels;
+		const size_t len = min(OVERVIEW_BLOCK_SIZE - level.back().count, frames - offset);
+
+		for (size_t c = 0; c < num_channels; c++) {
+			const long * in = block.channel(c) + offset;
+			OverviewEntry &entry = level[base + c];
+
+			long min_val = entry.min_val;
+			long max_val = entry.max_val;
+			double sum_squares = 0.0;
+			for (size_t i = 0; i < len; i++) {
+				min_val = min(min_val, in[i]);
+				max_val = max(max_val, in[i]);
+				sum_squares += (double)in[i] * in[i];
+			}
+
+			entry.min_val = min_val;
+			entry.max_val = max_val;
+			entry.sum_squares += sum_squares;
+			entry.count += len;
+		}
+
+		offset += len;
+		num_frames += len;
+	}
+
+	levels_valid = false;
+}
+
+void Overview::add_file(const AudioFile &file) {
+	SampleBlock block = SampleBlock(num_channels, STREAM_BLOCK_SIZE);
+	vector<Channel> channels;
+	for (size_t c = 0; c < num_channels; c++) {
+		channels.push_back(file.get_channel(c));
+	}
+
+	for (size_t start = 0; start < file.get_num_samples(); start += STREAM_BLOCK_SIZE) {
+		const size_t frames = min((size_t)STREAM_BLOCK_SIZE, file.get_num_samples() - start);
+		for (size_t c = 0; c < num_channels; c++) {
+			long * out = block.channel(c);
+			for (size_t i = 0; i < frames; i++) {
+				out[i] = channels[c].get_sample(start + i);
+			}
+		}
+
+		block.set_frames(frames);
+		add_block(block);
+	}
+}
+
+OverviewEntry Overview::merge(const OverviewEntry &a, const OverviewEntry &b) {
+	return { min(a.min_val, b.min_val), max(a.max_val, b.max_val),
+		a.sum_squares + b.sum_squares, a.count + b.count };
+}
+
+void Overview::build_levels() {
+	if (levels_valid) {
+		return;
+	}
+
+	// every level pairs up the blocks of the level below, until one block is left
+	levels.resize(1);
+	while (levels.back().size() > num_channels) {
+		const vector<OverviewEntry> &below = levels.back();
+		const size_t blocks = below.size() / num_channels;
+
+		vector<OverviewEntry> level;
+		level.reserve(((blocks + 1) / 2) * num_channels);
+		for (size_t b = 0; b < blocks; b += 2) {
+			for (size_t c = 0; c < num_channels; c++) {
+				const OverviewEntry &first = below[b * num_channels + c];
+				level.push_back(b + 1 < blocks ? merge(first, below[(b + 1) * num_channels + c]) : first);
+			}
+		}
+
+		levels.push_back(move(level));
+	}
+
+	levels_valid = true;
+}
+
+const vector<OverviewEntry>& Overview::get_level(size_t level) {
+	build_levels();
+	return levels.at(level);
+}
+
+size_t Overview::get_num_levels() {
+	build_levels();
+	return levels.size();
+}
+
+vector<OverviewEntry> Overview::query(size_t channel, size_t start, size_t end, size_t pixels) {
+	build_levels();
+
+	vector<OverviewEntry> columns(pixels, { 0, 0, 0.0, 0 });
+	end = min(end, num_frames);
+	if (start >= end || pixels == 0) {
+		return columns;
+	}
+
+	// the coarsest level that still has a block for every column
+	const double frames_per_pixel = (end - start) / (double)pixels;
+	size_t level = 0;
+	while (level + 1 < levels.size() && get_block_size(level + 1) <= frames_per_pixel) {
+		level++;
+	}
+
+	const vector<OverviewEntry> &entries = levels[level];
+	const size_t block_size = get_block_size(level);
+
+	for (size_t p = 0; p < pixels; p++) {
+		const size_t first = start + (size_t)(p * frames_per_pixel);
+		const size_t last = max(first + 1, start + (size_t)((p + 1) * frames_per_pixel));
+
+		bool empty = true;
+		for (size_t b = first / block_size; b <= (last - 1) / block_size; b++) {
+			const OverviewEntry &entry = entries[b * num_channels + channel];
+			columns[p] = empty ? entry : merge(columns[p], entry);
+			empty = false;
+		}
+	}
+
+	return columns;
+}
+
+void Overview::save(string filename) {
+	ofstream os(filename, ios::out | ios::binary);
+	if (!os.is_open()) {
+		throw invalid_argument("Failed to open file for writing.");
+	}
+
+	const vector<OverviewEntry> &level = levels[0];
+	const uint32_t header[4] = { (uint32_t)num_channels, (uint32_t)bit_res,
+		(uint32_t)sample_rate, (uint32_t)OVERVIEW_BLOCK_SIZE };
+	const uint64_t sizes[2] = { (uint64_t)num_frames, (uint64_t)level.size() };
+
+	os.write(overview_magic, sizeof(overview_magic));
+	os.write((const char *)header, sizeof(header));
+	os.write((const char *)source_stamp, sizeof(source_stamp));
+	os.write((const char *)sizes, sizeof(sizes));
+
+	for (auto &entry : level) {
+		const int64_t bounds[2] = { entry.min_val, entry.max_val };
+		const uint64_t count = entry.count;
+		os.write((const char *)bounds, sizeof(bounds));
+		os.write((const char *)&entry.sum_squares, sizeof(entry.sum_squares));
+		os.write((const char *)&count, sizeof(count));
+	}
+}
+
+Overview Overview::load(string filename) {
+	ifstream is(filename, ios::in | ios::binary);
+	if (!is.is_open()) {
+		throw invalid_argument("Failed to open file for reading.");
+	}
+
+	char magic[4];
+	uint32_t header[4];
+	uint64_t stamp[2];
+	uint64_t sizes[2];
+	is.read(magic, sizeof(magic));
+	is.read((char *)header, sizeof(header));
+	is.read((char *)stamp, sizeof(stamp));
+	is.read((char *)sizes, sizeof(sizes));
+
+	if (!is || memcmp(magic, overview_magic, sizeof(magic)) != 0 ||
+			header[0] == 0 || header[3] != OVERVIEW_BLOCK_SIZE ||
+			sizes[1] % header[0] != 0) {
+		throw invalid_argument(invalid_overview);
+	}
+
+	Overview overview = Overview(header[0], header[1], header[2]);
+	overview.num_frames = sizes[0];
+	overview.source_stamp[0] = stamp[0];
+	overview.source_stamp[1] = stamp[1];
+	vector<OverviewEntry> &level = overview.levels[0];
+	level.resize(sizes[1]);
+
+	for (auto &entry : level) {
+		int64_t bounds[2];
+		uint64_t count;
+		is.read((char *)bounds, sizeof(bounds));
+		is.read((char *)&entry.sum_squares, sizeof(entry.sum_squares));
+		is.read((char *)&count, sizeof(count));
+		entry.min_val = bounds[0];
+		entry.max_val = bounds[1];
+		entry.count = count;
+	}
+
+	if (!is) {
+		throw invalid_argument(invalid_overview);
+	}
+
+	return overview;
+}
+
+string Overview::sidecar_name(string filename) {
+	return filename + ".ovw";
+}
+
+Overview Overview::update(string filename) {
+	ifstream is(filename, ios::in | ios::binary);
+	if (!is.is_open()) {
+		throw invalid_argument("Failed to open file for reading.");
+	}
+
+	string extension;
+	auto reader = AudioInfo::open_reader(is, filename, extension);
+	Overview overview = Overview(reader->get_num_channels(), reader->get_bit_res(), reader->get_sample_rate());
+
+	uint64_t stamp[2];
+	file_stamp(filename, stamp);
+
+	// reuse the stored overview if it still describes the start of this file
+	try {
+		Overview stored = load(sidecar_name(filename));
+		const long frames = reader->get_num_samples();
+		if (stored.num_channels == overview.num_channels && stored.bit_res == overview.bit_res &&
+				stored.sample_rate == overview.sample_rate && (frames < 0 || stored.num_frames <= (size_t)frames)) {
+			overview = stored;
+		}
+	} catch (exception &e) {
+		// missing or invalid, rebuild it from scratch
+	}
+
+	// a file written again since the sidecar was saved may hold other samples, even with the same length
+	const bool unchanged = stamp[0] && equal(stamp, stamp + 2, overview.source_stamp);
+	if (unchanged ? reader->skip_frames(overview.num_frames) != overview.num_frames : !overview.matches_tail(*reader)) {
+		overview = Overview(reader->get_num_channels(), reader->get_bit_res(), reader->get_sample_rate());
+		is.clear();
+		is.seekg(0);
+		reader = AudioInfo::open_reader(is, filename, extension);
+	}
+
+	SampleBlock block = SampleBlock(overview.num_channels, STREAM_BLOCK_SIZE);
+	while (reader->read_block(block) > 0) {
+		overview.add_block(block);
+	}
+
+	overview.source_stamp[0] = stamp[0];
+	overview.source_stamp[1] = stamp[1];
+	overview.save(sidecar_name(filename));
+	return overview;
+}
+
+bool Overview::matches_tail(iBlockReader &reader) {
+	if (num_frames == 0) {
+		return true;
+	}
+
+	// the last block, which is only partial if the file ended within it
+	const size_t start = (levels[0].size() / num_channels - 1) * OVERVIEW_BLOCK_SIZE;
+	const size_t count = num_frames - start;
+	SampleBlock block = SampleBlock(num_channels, count);
+	if (reader.skip_frames(start) != start || reader.read_block(block) != count) {
+		return false;
+	}
+
+	Overview tail = Overview(num_channels, bit_res, sample_rate);
+	tail.add_block(block);
+	for (size_t c = 0; c < num_channels; c++) {
+		const OverviewEntry &stored = levels[0][start / OVERVIEW_BLOCK_SIZE * num_channels + c];
+		const OverviewEntry &decoded = tail.levels[0][c];
+
+		// the sums of squares may have been added up in other pieces
+		if (stored.min_val != decoded.min_val || stored.max_val != decoded.max_val || stored.count != decoded.count ||
+				fabs(stored.sum_squares - decoded.sum_squares) > 1e-9 * max(1.0, decoded.sum_squares)) {
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,187 @@
+#ifndef OVERVIEW_H
+#define OVERVIEW_H
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <stdint.h>
+
+#include "SampleBlock.h"
+#include "flags.h"
+
+using namespace std;
+
+class AudioFile;
+class iBlockReader;
+
+/**
+ * Summary of a block of samples of a single channel.
+ */
+struct OverviewEntry {
+	long min_val; /**< Smallest sample of the block. */
+	long max_val; /**< Largest sample of the block. */
+	double sum_squares; /**< Sum of the squared samples of the block. */
+	size_t count; /**< Number of samples in the block. */
+
+	/**
+	 * \return The root mean square of the block.
+	 */
+	double rms() const;
+};
+
+/**
+ * Multi resolution min/max/RMS summary of a file, used to draw waveforms
+ * without reading every sample. Level 0 summarizes blocks of
+ * OVERVIEW_BLOCK_SIZE frames, and every following level summarizes blocks
+ * twice as long as the level below it, up to a single block for the whole file.
+ * Drawing a range of the file then only touches the level with roughly one
+ * block per pixel, so its cost depends on the number of pixels, not samples.
+ *
+ * An Overview is built one block of samples at a time, and is stored as a
+ * sidecar file next to the audio file (see sidecar_name(...)). Only level 0
+ * is stored, its last block may be partial and is completed by the next samples
+ * added, the other levels are rebuilt from it when needed. A stored overview can
+ * therefore be extended, so update(...) only reads the part of a file the sidecar
+ * does not cover yet. The sidecar records the size and modification time of the
+ * file it summarizes, when they changed the last block it summarizes is decoded
+ * again, and the overview is rebuilt from scratch unless that block still holds
+ * the same samples (as it does when the file was only appended to).
+ */
+class Overview {
+public:
+	/**
+	 * \param NumChannels Number of channels of the file.
+	 * \param BitRes Bit resolution of the file.
+	 * \param SampleRate Number of samples per second of the file.
+	 */
+	Overview(size_t NumChannels, size_t BitRes, size_t SampleRate);
+
+	/**
+	 * Adds every valid frame of the block after the frames already summarized.
+	 * \param block Block of samples, with the same number of channels.
+	 */
+	void add_block(const SampleBlock &block);
+
+	/**
+	 * Adds every sample of the file after the frames already summarized.
+	 * \param file File with the same number of channels.
+	 */
+	void add_file(const AudioFile &file);
+
+	/**
+	 * Summarizes the frames [start, end) of a channel into 'pixels' columns.
+	 * Each column is built from the coarsest level with at least one block per
+	 * column, so columns may cover a few extra frames at their edges.
+	 * \param channel Index of the channel.
+	 * \param start First frame to summarize.
+	 * \param end Frame after the last frame to summarize.
+	 * \param pixels Number of columns to return.
+	 * \return One entry per column, columns with no frames have a count of 0.
+	 */
+	vector<OverviewEntry> query(size_t channel, size_t start, size_t end, size_t pixels);
+
+	/**
+	 * \param level Level of the overview, 0 being the finest.
+	 * \return The entries of the level, ordered by block and then by channel.
+	 */
+	const vector<OverviewEntry>& get_level(size_t level);
+
+	/**
+	 * \return The number of levels, including level 0.
+	 */
+	size_t get_num_levels();
+
+	/**
+	 * \param level Level of the overview, 0 being the finest.
+	 * \return The number of frames summarized by a block of that level.
+	 */
+	inline size_t get_block_size(size_t level) const {
+		return (size_t)OVERVIEW_BLOCK_SIZE << level;
+	}
+
+	/**
+	 * \return The number of frames summarized so far.
+	 */
+	inline size_t get_num_frames() const {
+		return num_frames;
+	}
+
+	/**
+	 * \return The number of channels of the file.
+	 */
+	inline size_t get_num_channels() const {
+		return num_channels;
+	}
+
+	/**
+	 * \return The bit resolution of the file.
+	 */
+	inline size_t get_bit_res() const {
+		return bit_res;
+	}
+
+	/**
+	 * \return The number of samples per second of the file.
+	 */
+	inline size_t get_sample_rate() const {
+		return sample_rate;
+	}
+
+	/**
+	 * Writes level 0 of this overview to a sidecar file.
+	 * \param filename Name of the sidecar file.
+	 */
+	void save(string filename);
+
+	/**
+	 * Reads an overview written by save(...).
+	 * An invalid_argument exception is thrown if the file is not an overview.
+	 * \param filename Name of the sidecar file.
+	 * \return The stored overview.
+	 */
+	static Overview load(string filename);
+
+	/**
+	 * \param filename Name of an audio file.
+	 * \return The name of the sidecar file holding the overview of that file.
+	 */
+	static string sidecar_name(string filename);
+
+	/**
+	 * Brings the sidecar of an audio file up to date, and returns it.
+	 * If a sidecar exists for a file of the same format, whose size and modification
+	 * time match the file, or whose last block still matches the samples of the file,
+	 * only the frames past the ones it already covers are read, otherwise it is rebuilt.
+	 * \param filename Name of the .cs229 or .wav file.
+	 * \return The overview of the whole file.
+	 */
+	static Overview update(string filename);
+
+private:
+	/**
+	 * Rebuilds every level above level 0.
+	 */
+	void build_levels();
+
+	/**
+	 * Decodes the frames of the last block of level 0 again, and compares them with it.
+	 * \param reader Reader at the first frame of the file, left after the frames summarized.
+	 * \return Whether or not the block still summarizes the same samples.
+	 */
+	bool matches_tail(iBlockReader &reader);
+
+	/**
+	 * \return The entry summarizing both entries.
+	 */
+	static OverviewEntry merge(const OverviewEntry &a, const OverviewEntry &b);
+
+	size_t num_channels; /**< Number of channels of the file. */
+	size_t bit_res; /**< Bit resolution of the file. */
+	size_t sample_rate; /**< Number of samples per second of the file. */
+	size_t num_frames; /**< Number of frames summarized. */
+	uint64_t source_stamp[2]; /**< Size and modification time (in nanoseconds) of the file summarized, 0 if unknown. */
+	vector<vector<OverviewEntry>> levels; /**< Entries of each level, ordered by block and then by channel. */
+	bool levels_valid; /**< Whether the levels above 0 match level 0. */
+};
+
+#endif
@@ -0,0 +1,450 @@
+#include <math.h>
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <exception>
+
+#include "Pipeline.h"
+#include "Mixer.h"
+#include "Limiter.h"
+#include "ProcessChain.h"
+#include "Saturate.h"
+#include "Profile.h"
+#include "Trace.h"
+#include "ThreadPool.h"
+
+static const string overflow_msg = "Sample exceeds this Channels bit resolution!";
+
+/**
+ * Applies 'overflow_policy' to the blocks of a stage on their way out,
+ * the way Mixer::mix(...) treats its sums. The limiter delays its output,
+ * so the last frames only leave through end(...).
+ */
+class OverflowFilter {
+public:
+	/**
+	 * \param NumChannels Number of channels of the stream.
+	 * \param BitRes Bit resolution every sample must fit in.
+	 * \param BlockSize Capacity of the blocks given to write(...).
+	 */
+	OverflowFilter(size_t NumChannels, size_t BitRes, size_t BlockSize) :
+		max_val{1L << (BitRes - 1)}, min_val{-((1L << (BitRes - 1)) - 1)},
+		limiter(NumChannels, BitRes, min((size_t)LIMITER_LOOKAHEAD, BlockSize)) { }
+
+	/**
+	 * Brings the block within the bit resolution, and writes it.
+	 * \param block Block to check, modified in place.
+	 * \param out Writer to pass the block on to.
+	 */
+	void write(SampleBlock &block, iBlockWriter &out) {
+		for (size_t c = 0; c < block.get_num_channels(); c++) {
+			long * samples = block.channel(c);
+			if (overflow_policy == OVERFLOW_THROW) {
+				if (count_overflows(samples, block.get_frames(), min_val, max_val)) {
+					throw overflow_error(overflow_msg);
+				}
+			} else if (overflow_policy == OVERFLOW_SATURATE) {
+				clipped_samples += saturate(samples, block.get_frames(), min_val, max_val);
+			}
+		}
+
+		PROFILE_COUNT(COUNTER_OVERFLOW_CHECKS, block.get_frames() * block.get_num_channels());
+		if (overflow_policy != OVERFLOW_LIMIT) {
+			out.write_block(block);
+		} else if (limiter.process(block, block) > 0) {
+			out.write_block(block);
+		}
+	}
+
+	/**
+	 * Writes the frames still held by the limiter, if any.
+	 * \param block Scratch block, with at least the capacity given to the constructor.
+	 * \param out Writer to pass the frames on to.
+	 */
+	void end(SampleBlock &block, iBlockWriter &out) {
+		if (overflow_policy == OVERFLOW_LIMIT && limiter.flush(block) > 0) {
+			out.write_block(block);
+		}
+	}
+
+private:
+	long max_val; /**< Largest valid sample. */
+	long min_val; /**< Smallest valid sample. */
+	Limiter limiter; /**< Limiter of the OVERFLOW_LIMIT policy. */
+};
+
+/**
+ * \return The format of the stream of an open reader.
+ */
+static BlockQueue::Header header_of(const iBlockReader &reader) {
+	return { reader.get_sample_rate(), reader.get_bit_res(), reader.get_num_channels(), reader.get_num_samples() };
+}
+
+/**
+ * Runs a stream through a ProcessChain, rounding the results.
+ */
+static void process_stream(ProcessChain &chain, size_t block_size, QueueReader &in, QueueWriter &out) {
+	out.begin(header_of(in));
+	SampleBlock block = SampleBlock(in.get_num_channels(), block_size);
+	OverflowFilter filter = OverflowFilter(in.get_num_channels(), in.get_bit_res(), block_size);
+	const double sample_rate = in.get_sample_rate();
+	double samples[RENDER_BLOCK_SIZE];
+	size_t first_frame = 0;
+	size_t frames = 0;
+
+	while ((frames = in.read_block(block)) > 0) {
+		{
+			PROFILE_SCOPE(TIMER_ARITHMETIC);
+			for (size_t c = 0; c < block.get_num_channels(); c++) {
+				long * data = block.channel(c);
+				for (size_t start = 0; start < frames; start += RENDER_BLOCK_SIZE) {
+					const size_t count = min((size_t)RENDER_BLOCK_SIZE, frames - start);
+					for (size_t i = 0; i < count; i++) {
+						samples[i] = data[start + i];
+					}
+
+					chain.process_block(samples, count, first_frame + start, sample_rate);
+					for (size_t i = 0; i < count; i++) {
+						data[start + i] = lround(samples[i]);
+					}
+				}
+			}
+		}
+
+		first_frame += frames;
+		filter.write(block, out);
+	}
+
+	filter.end(block, out);
+	out.end();
+}
+
+Pipeline::Node Pipeline::read(iBlockReader *reader) {
+	const size_t frames_per_block = block_size;
+	return add_source("read", [reader, frames_per_block](QueueWriter &out) {
+		out.begin(header_of(*reader));
+		SampleBlock block = SampleBlock(reader->get_num_channels(), frames_per_block);
+		while (reader->read_block(block) > 0) {
+			out.write_block(block);
+		}
+
+		out.end();
+	});
+}
+
+Pipeline::Node Pipeline::audio(AudioFile file) {
+	const size_t frames_per_block = block_size;
+	auto source = make_shared<AudioFile>(move(file));
+	return add_source("audio", [source, frames_per_block](QueueWriter &out) {
+		AudioFile &file = *source;
+		const size_t num_channels = file.get_num_channels();
+		const size_t num_samples = file.get_num_samples();
+		out.begin({ file.get_sample_rate(), file.get_bit_res(), num_channels, (long)num_samples });
+
+		SampleBlock block = SampleBlock(num_channels, frames_per_block);
+		for (size_t start = 0; start < num_samples; start += frames_per_block) {
+			const size_t count = min(frames_per_block, num_samples - start);
+			for (size_t c = 0; c < num_channels; c++) {
+				const Channel &channel = file[c];
+				long * data = block.channel(c);
+				// channels shorter than the file are padded with 0's
+				for (size_t i = 0; i < count; i++) {
+					data[i] = start + i < channel.size() ? channel.get_sample(start + i) : 0;
+				}
+			}
+
+			block.set_frames(count);
+			out.write_block(block);
+		}
+
+		out.end();
+	});
+}
+
+Pipeline::Node Pipeline::render(RenderGraph *graph, size_t SampleRate, double Length, size_t BitRes) {
+	const size_t frames_per_block = block_size;
+	return add_source("render", [=](QueueWriter &out) {
+		const size_t sample_count = Length > 0.0 ? (size_t)ceil(Length * SampleRate) : 0;
+		out.begin({ SampleRate, BitRes, 1, (long)sample_count });
+
+		// a batch of blocks is rendered on the shared pool, one block per task,
+		// then the blocks are passed on in order
+		ThreadPool &pool = ThreadPool::shared();
+		const size_t batch_size = max((size_t)1, pool.size());
+		vector<SampleBlock> batch;
+		for (size_t b = 0; b < batch_size; b++) {
+			batch.emplace_back(1, frames_per_block);
+		}
+
+		OverflowFilter filter = OverflowFilter(1, BitRes, frames_per_block);
+		for (size_t first = 0; first < sample_count; first += batch_size * frames_per_block) {
+			const size_t blocks = min(batch_size, (sample_count - first + frames_per_block - 1) / frames_per_block);
+			auto render_one = [&](size_t b) {
+				PROFILE_SCOPE(TIMER_SYNTHESIS);
+				TRACE_SCOPE("render_chunk");
+				double samples[RENDER_BLOCK_SIZE];
+				const size_t block_first = first + b * frames_per_block;
+				const size_t frames = min(frames_per_block, sample_count - block_first);
+				long * data = batch[b].channel(0);
+				for (size_t start = 0; start < frames; start += RENDER_BLOCK_SIZE) {
+					const size_t count = min((size_t)RENDER_BLOCK_SIZE, frames - start);
+					graph->render_block(block_first + start, SampleRate, samples, count);
+					for (size_t i = 0; i < count; i++) {
+						data[start + i] = lround(samples[i]);
+					}
+				}
+
+				batch[b].set_frames(frames);
+			};
+
+			if (blocks > 1) {
+				pool.parallel_for(blocks, render_one);
+			} else {
+				render_one(0);
+			}
+
+			for (size_t b = 0; b < blocks; b++) {
+				filter.write(batch[b], out);
+			}
+		}
+
+		filter.end(batch[0], out);
+		out.end();
+	});
+}
+
+Pipeline::Node Pipeline::gain(Node input, double scalar) {
+	const size_t frames_per_block = block_size;
+	return add_transform("gain", input, [scalar, frames_per_block](QueueReader &in, QueueWriter &out) {
+		ProcessChain chain;
+		chain.gain(scalar);
+		process_stream(chain, frames_per_block, in, out);
+	});
+}
+
+Pipeline::Node Pipeline::envelope(Node input, iFunction *func) {
+	const size_t frames_per_block = block_size;
+	return add_transform("envelope", input, [func, frames_per_block](QueueReader &in, QueueWriter &out) {
+		ProcessChain chain;
+		chain.envelope(func);
+		process_stream(chain, frames_per_block, in, out);
+	});
+}
+
+Pipeline::Node Pipeline::mute(Node input, size_t channel) {
+	const size_t frames_per_block = block_size;
+	return add_transform("mute", input, [channel, frames_per_block](QueueReader &in, QueueWriter &out) {
+		if (channel >= in.get_num_channels()) {
+			throw out_of_range("the muted channel does not exist");
+		}
+
+		out.begin(header_of(in));
+		SampleBlock block = SampleBlock(in.get_num_channels(), frames_per_block);
+		size_t frames = 0;
+		while ((frames = in.read_block(block)) > 0) {
+			fill(block.channel(channel), block.channel(channel) + frames, 0L);
+			out.write_block(block);
+		}
+
+		out.end();
+	});
+}
+
+Pipeline::Node Pipeline::resample(Node input, size_t SampleRate) {
+	const size_t frames_per_block = block_size;
+	return add_transform("resample", input, [SampleRate, frames_per_block](QueueReader &in, QueueWriter &out) {
+		const size_t num_channels = in.get_num_channels();
+		const size_t in_rate = in.get_sample_rate();
+		if (!SampleRate || !in_rate) {
+			throw invalid_argument("sample rates must be non-zero to resample");
+		}
+
+		// output frame j lies at input frame j * in_rate / SampleRate, the last
+		// output frame is the last one lying on (or before) the last input frame
+		BlockQueue::Header header = header_of(in);
+		header.sample_rate = SampleRate;
+		if (header.num_samples > 0) {
+			header.num_samples = (header.num_samples * SampleRate - 1) / in_rate + 1;
+		}
+
+		out.begin(header);
+		SampleBlock block = SampleBlock(num_channels, frames_per_block);
+		SampleBlock output = SampleBlock(num_channels, frames_per_block);
+		vector<long> last(num_channels, 0);
+		size_t base = 0; // input frame held by block.channel(c)[0], 'last' holds the frame before it
+		size_t next = 0; // next output frame
+		size_t written = 0;
+
+		auto sample = [&](size_t c, size_t frame) {
+			return frame < base ? last[c] : block.channel(c)[frame - base];
+		};
+
+		auto emit = [&](size_t i0, double frac, size_t i1) {
+			for (size_t c = 0; c < num_channels; c++) {
+				const double a = sample(c, i0);
+				output.channel(c)[written] = lround(a + (sample(c, i1) - a) * frac);
+			}
+
+			if (++written == output.get_capacity()) {
+				output.set_frames(written);
+				out.write_block(output);
+				written = 0;
+			}
+
+			next++;
+		};
+
+		size_t frames = 0;
+		while ((frames = in.read_block(block)) > 0) {
+			PROFILE_SCOPE(TIMER_ARITHMETIC);
+			while (true) {
+				const size_t position = next * in_rate;
+				const size_t i0 = position / SampleRate;
+				if (i0 + 1 >= base + frames) {
+					break;
+				}
+
+				emit(i0, (position % SampleRate) / (double)SampleRate, i0 + 1);
+			}
+
+			for (size_t c = 0; c < num_channels; c++) {
+				last[c] = block.channel(c)[frames - 1];
+			}
+
+			base += frames;
+		}
+
+		// frames lying past the last input frame repeat it, 'block' is no longer read
+		while (base && next * in_rate / SampleRate == base - 1) {
+			emit(base - 1, 0.0, base - 1);
+		}
+
+		output.set_frames(written);
+		if (written) {
+			out.write_block(output);
+		}
+
+		out.end();
+	});
+}
+
+Pipeline::Node Pipeline::mix(const vector<pair<Node, double>> &inputs) {
+	vector<pair<BlockQueue *, double>> sources;
+	for (auto &input : inputs) {
+		sources.push_back({ consume(input.first), input.second });
+	}
+
+	const size_t frames_per_block = block_size;
+	return add_source("mix", [sources, frames_per_block](QueueWriter &out) {
+		vector<unique_ptr<QueueReader>> readers;
+		Mixer mixer = Mixer(frames_per_block);
+		for (auto &source : sources) {
+			readers.push_back(unique_ptr<QueueReader>(new QueueReader(source.first)));
+			readers.back()->open_queue();
+			mixer.add_input(readers.back().get(), source.second);
+		}
+
+		// the QueueWriter ignores the stream, it only feeds the queue
+		mixer.mix(out, cout);
+	});
+}
+
+void Pipeline::write(Node input, iBlockWriter *writer, ostream *os) {
+	BlockQueue *queue = consume(input);
+	const size_t frames_per_block = block_size;
+	stages.push_back({ "write", [queue, writer, os, frames_per_block]() {
+		QueueReader in(queue);
+		in.open_queue();
+		writer->begin(*os, in.get_sample_rate(), in.get_bit_res(), in.get_num_channels(), in.get_num_samples());
+
+		SampleBlock block = SampleBlock(in.get_num_channels(), frames_per_block);
+		while (in.read_block(block) > 0) {
+			writer->write_block(block);
+		}
+
+		writer->end();
+	}});
+}
+
+void Pipeline::collect(Node input, unique_ptr<AudioFile> *file) {
+	BlockQueue *queue = consume(input);
+	stages.push_back({ "collect", [queue, file]() {
+		QueueReader in(queue);
+		in.open_queue();
+		file->reset(new AudioFile(in.read_rest()));
+	}});
+}
+
+void Pipeline::run() {
+	for (size_t i = 0; i < consumed.size(); i++) {
+		if (!consumed[i]) {
+			throw invalid_argument("every node of a Pipeline must be consumed by a stage");
+		}
+	}
+
+	// the first stage to fail stops every other one through its queues
+	mutex error_lock;
+	exception_ptr error;
+	vector<thread> threads;
+	for (size_t i = 0; i < stages.size(); i++) {
+		Stage &stage = stages[i];
+		threads.push_back(thread([this, &stage, &error_lock, &error, i]() {
+			Trace::set_thread_name("pipeline " + to_string(i) + " " + stage.name);
+			try {
+				stage.body();
+			} catch (...) {
+				{
+					unique_lock<mutex> guard(error_lock);
+					if (!error) {
+						error = current_exception();
+					}
+				}
+
+				for (auto &queue : queues) {
+					queue->abort();
+				}
+			}
+		}));
+	}
+
+	for (auto &t : threads) {
+		t.join();
+	}
+
+	stages.clear();
+	if (error) {
+		rethrow_exception(error);
+	}
+}
+
+Pipeline::Node Pipeline::add_source(const char *name, function<void(QueueWriter &out)> body) {
+	queues.push_back(unique_ptr<BlockQueue>(new BlockQueue(queue_blocks, block_size)));
+	consumed.push_back(false);
+
+	BlockQueue *queue = queues.back().get();
+	stages.push_back({ name, [queue, body]() {
+		QueueWriter out(queue);
+		body(out);
+	}});
+
+	return queues.size() - 1;
+}
+
+Pipeline::Node Pipeline::add_transform(const char *name, Node input, function<void(QueueReader &in, QueueWriter &out)> body) {
+	BlockQueue *queue = consume(input);
+	return add_source(name, [queue, body](QueueWriter &out) {
+		QueueReader in(queue);
+		in.open_queue();
+		body(in, out);
+	});
+}
+
+BlockQueue * Pipeline::consume(Node input) {
+	if (input >= queues.size() || consumed[input]) {
+		throw invalid_argument("a node of a Pipeline can only be consumed once");
+	}
+
+	consumed[input] = true;
+	return queues[input].get();
+}
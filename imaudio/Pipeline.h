@@ -0,0 +1,188 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <iostream>
+#include <utility>
+#include <functional>
+
+#include "AudioFile.h"
+#include "BlockQueue.h"
+#include "RenderGraph.h"
+#include "iBlockReader.h"
+#include "iBlockWriter.h"
+#include "func/iFunction.h"
+#include "flags.h"
+
+using namespace std;
+
+/**
+ * Dataflow graph of streaming stages: sources (readers, render graphs,
+ * AudioFiles), transforms (gain, envelope, mute, resample, mix) and sinks
+ * (writers). Every stage runs on a thread of its own, and passes its output
+ * to the stage consuming it through a bounded BlockQueue, so a long chain of
+ * operations overlaps instead of materializing a whole AudioFile per step,
+ * and a slow stage holds back the stages feeding it (backpressure) instead
+ * of letting them buffer the whole stream.
+ *
+ * Stages are added by the methods below, each returning the Node holding its
+ * output, which must then be consumed by exactly one other stage. Nothing
+ * happens until run(), which starts every stage, and waits for all of them.
+ * Values leaving their bit resolution follow 'overflow_policy' (see flags.h),
+ * and the inputs of a mix follow the strict_data rules of Mixer.
+ *
+ *	Pipeline pipeline;
+ *	auto voice = pipeline.envelope(pipeline.read(&reader), &adsr);
+ *	auto tone = pipeline.render(&graph, 44100, 2.0, 16);
+ *	pipeline.write(pipeline.mix({{voice, 0.5}, {tone, 0.5}}), &writer, &file);
+ *	pipeline.run();
+ */
+class Pipeline {
+public:
+	/**
+	 * Output of a stage.
+	 */
+	typedef size_t Node;
+
+	/**
+	 * \param QueueBlocks Number of blocks in flight between two stages.
+	 * \param BlockSize Number of frames in each block.
+	 */
+	Pipeline(size_t QueueBlocks = PIPELINE_QUEUE_BLOCKS, size_t BlockSize = STREAM_BLOCK_SIZE) :
+		queue_blocks{QueueBlocks}, block_size{BlockSize} { }
+
+	Pipeline(const Pipeline &other) = delete;
+	Pipeline& operator=(const Pipeline &other) = delete;
+
+	/**
+	 * Streams every frame left in a reader, which must already be open.
+	 * \param reader Source of the samples, it is not owned by the pipeline.
+	 * \return The samples of the reader.
+	 */
+	Node read(iBlockReader *reader);
+
+	/**
+	 * Streams the samples of an AudioFile, for sources which are only available
+	 * as a whole file, such as a score read by ABC229Reader.
+	 * \param file File to stream, kept by the pipeline until it is destroyed.
+	 * \return The samples of the file.
+	 */
+	Node audio(AudioFile file);
+
+	/**
+	 * Renders a single channel from a RenderGraph, block by block, rounding every
+	 * sample as RenderGraph::render(...) does. Consecutive blocks are rendered
+	 * on the shared ThreadPool at once, and passed on in order.
+	 * \param graph Graph to render, it is not owned by the pipeline.
+	 * \param SampleRate Number of samples per second.
+	 * \param Length Length (in seconds) of the output.
+	 * \param BitRes Bit resolution of the output.
+	 * \return The rendered samples.
+	 */
+	Node render(RenderGraph *graph, size_t SampleRate, double Length, size_t BitRes);
+
+	/**
+	 * Multiplies every sample by a scalar, rounding the result.
+	 * \param input Stream to scale.
+	 * \param scalar Scalar to multiply each sample by.
+	 * \return The scaled stream.
+	 */
+	Node gain(Node input, double scalar);
+
+	/**
+	 * Multiplies every sample by the value of a function at the time of that sample.
+	 * \param input Stream to scale.
+	 * \param func Function to multiply each sample by, it is not owned by the pipeline.
+	 * \return The scaled stream.
+	 */
+	Node envelope(Node input, iFunction *func);
+
+	/**
+	 * Replaces every sample of a channel with 0, as AudioFile::mute_channel(...) does.
+	 * \param input Stream to mute a channel of.
+	 * \param channel Index of the channel to mute.
+	 * \return The stream with the channel muted.
+	 */
+	Node mute(Node input, size_t channel);
+
+	/**
+	 * Converts a stream to another sample rate, interpolating linearly
+	 * between the two input frames around each output frame.
+	 * \param input Stream to convert.
+	 * \param SampleRate Sample rate of the output.
+	 * \return The converted stream.
+	 */
+	Node resample(Node input, size_t SampleRate);
+
+	/**
+	 * Sums every input scaled by its gain, as Mixer::mix(...) does.
+	 * \param inputs Streams to mix, each with its gain.
+	 * \return The mixed stream.
+	 */
+	Node mix(const vector<pair<Node, double>> &inputs);
+
+	/**
+	 * Writes a stream with a writer.
+	 * \param input Stream to write.
+	 * \param writer Writer used to format the stream, it is not owned by the pipeline.
+	 * \param os Output stream to write to, it is not owned by the pipeline.
+	 */
+	void write(Node input, iBlockWriter *writer, ostream *os);
+
+	/**
+	 * Collects a stream into an AudioFile, for callers needing the whole result.
+	 * \param input Stream to collect.
+	 * \param file Set to a new AudioFile holding the collected samples by run().
+	 */
+	void collect(Node input, unique_ptr<AudioFile> *file);
+
+	/**
+	 * Runs every stage on a thread of its own, and waits for all of them to finish.
+	 * If any stage throws an exception, every other stage is stopped, and the
+	 * first such exception is rethrown here. A pipeline can only be run once.
+	 */
+	void run();
+
+private:
+	/**
+	 * Adds a stage producing a stream.
+	 * \param name Name of the stage, as shown by traces.
+	 * \param body Body of the stage, it must begin(...) and end() the writer.
+	 * \return The output of the stage.
+	 */
+	Node add_source(const char *name, function<void(QueueWriter &out)> body);
+
+	/**
+	 * Adds a stage turning one stream into another.
+	 * \param name Name of the stage, as shown by traces.
+	 * \param input Stream consumed by the stage.
+	 * \param body Body of the stage, the reader is open, it must begin(...) and end() the writer.
+	 * \return The output of the stage.
+	 */
+	Node add_transform(const char *name, Node input, function<void(QueueReader &in, QueueWriter &out)> body);
+
+	/**
+	 * Marks a stream as consumed, a stream can only be consumed once.
+	 * \param input The stream.
+	 * \return The queue of the stream.
+	 */
+	BlockQueue * consume(Node input);
+
+	/**
+	 * Single stage of the pipeline.
+	 */
+	struct Stage {
+		string name; /**< Name of the thread of the stage, as shown by traces. */
+		function<void()> body; /**< Work done by the thread of the stage. */
+	};
+
+	size_t queue_blocks; /**< Blocks in flight between two stages. */
+	size_t block_size; /**< Frames in each block. */
+	vector<Stage> stages; /**< Every stage, in the order they were added. */
+	vector<unique_ptr<BlockQueue>> queues; /**< Output of every Node, indexed by Node. */
+	vector<bool> consumed; /**< Whether each Node is consumed by a stage. */
+};
+
+#endif
@@ -0,0 +1,76 @@
+#include <math.h>
+#include <algorithm>
+
+#include "ProcessChain.h"
+
+ProcessChain& ProcessChain::gain(double scalar) {
+	stages.push_back({scalar, nullptr});
+	return *this;
+}
+
+ProcessChain& ProcessChain::envelope(iFunction *func) {
+	stages.push_back({1.0, func});
+	return *this;
+}
+
+void ProcessChain::process_block(double *block, size_t count, size_t first_sample, double sample_rate) {
+	// kept on the stack so blocks may be processed on several threads at once
+	double scratch[RENDER_BLOCK_SIZE];
+	for (auto &stage : stages) {
+		if (stage.func) {
+			stage.func->sample_block(first_sample, sample_rate, scratch, count);
+			for (size_t i = 0; i < count; i++) {
+				block[i] *= scratch[i];
+			}
+		} else {
+			const double scalar = stage.scalar;
+			for (size_t i = 0; i < count; i++) {
+				block[i] *= scalar;
+			}
+		}
+	}
+}
+
+void ProcessChain::apply(AudioFile &file) {
+	const double sample_rate = file.get_sample_rate();
+	double block[RENDER_BLOCK_SIZE];
+
+	for (auto c = 0; c < (int)file.get_num_channels(); c++) {
+		Channel &channel = file[c];
+		const size_t size = channel.size();
+
+		for (size_t start = 0; start < size; start += RENDER_BLOCK_SIZE) {
+			const size_t count = min((size_t)RENDER_BLOCK_SIZE, size - start);
+
+			// load the block, run it through every stage, then store it again
+			if (channel.is_float()) {
+				double * data = channel.float_data() + start;
+				for (size_t i = 0; i < count; i++) {
+					block[i] = data[i];
+				}
+
+				process_block(block, count, start, sample_rate);
+
+				for (size_t i = 0; i < count; i++) {
+					data[i] = block[i];
+				}
+			} else {
+				long * data = channel.data() + start;
+				for (size_t i = 0; i < count; i++) {
+					block[i] = data[i];
+				}
+
+				process_block(block, count, start, sample_rate);
+
+				for (size_t i = 0; i < count; i++) {
+					const long val = lround(block[i]);
+					if (!channel.is_valid_sample(val)) {
+						throw overflow_error("Sample exceeds this Channels bit resolution!");
+					}
+
+					data[i] = val;
+				}
+			}
+		}
+	}
+}
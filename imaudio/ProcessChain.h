@@ -0,0 +1,77 @@
+#ifndef PROCESSCHAIN_H
+#define PROCESSCHAIN_H
+
+#include <vector>
+
+#include "AudioFile.h"
+#include "func/iFunction.h"
+#include "flags.h"
+
+using namespace std;
+
+/**
+ * A ProcessChain collects a series of per sample operations
+ * (gains and time varying functions such as an AdsrEnvelope)
+ * and applies all of them to an AudioFile in a single pass.
+ * Intermediate results are kept as doubles, so the samples are
+ * only quantized once, after the last step of the chain.
+ * This replaces expressions such as 'adsr * (file * volume)', which
+ * copy the file and truncate every sample once per operator.
+ */
+class ProcessChain {
+public:
+	/**
+	 * Adds a constant scalar to the end of this chain.
+	 * \param scalar Scalar to multiply each sample by.
+	 * \return This chain, so calls may be strung together.
+	 */
+	ProcessChain& gain(double scalar);
+
+	/**
+	 * Adds a function of time to the end of this chain, each sample will
+	 * be multiplied by the value of 'func' at the time of that sample.
+	 * The function is not owned by the chain, and must outlive it.
+	 * \param func Function to multiply each sample by.
+	 * \return This chain, so calls may be strung together.
+	 */
+	ProcessChain& envelope(iFunction *func);
+
+	/**
+	 * Applies every step of this chain to every channel of the input file in place.
+	 * Floating point files remain unquantized. Integer files are rounded once at
+	 * the end of the chain, throwing an overflow_error if a result does not fit
+	 * the files bit resolution.
+	 * \param file The AudioFile to process.
+	 */
+	void apply(AudioFile &file);
+
+	/**
+	 * Applies every step of this chain to a block of consecutive samples.
+	 * Several blocks may be processed at once, from different threads.
+	 * \param block Array of 'count' samples to process in place.
+	 * \param count Number of samples in the block (at most RENDER_BLOCK_SIZE).
+	 * \param first_sample Index (in the whole file) of the first sample of the block.
+	 * \param sample_rate Number of samples per second.
+	 */
+	void process_block(double *block, size_t count, size_t first_sample, double sample_rate);
+
+	/**
+	 * \return True if this chain contains no steps.
+	 */
+	inline bool empty() const {
+		return stages.empty();
+	}
+
+private:
+	/**
+	 * Single step of the chain, either 'func' is set, or 'scalar' is used.
+	 */
+	struct Stage {
+		double scalar;
+		iFunction *func;
+	};
+
+	vector<Stage> stages; /**< Steps of this chain in the order they were added. */
+};
+
+#endif
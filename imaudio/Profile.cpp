@@ -0,0 +1,65 @@
+#include <iomanip>
+#include <stdlib.h>
+
+#include "Profile.h"
+
+atomic<unsigned long> Profile::timer_calls[NUM_PROFILE_TIMERS];
+atomic<unsigned long> Profile::timer_ns[NUM_PROFILE_TIMERS];
+atomic<unsigned long> Profile::counters[NUM_PROFILE_COUNTERS];
+
+static const char * timer_names[NUM_PROFILE_TIMERS] = {
+	"read_file", "read_block", "synthesis", "arithmetic", "write_file", "write_block"
+};
+
+static const char * counter_names[NUM_PROFILE_COUNTERS] = {
+	"samples_parsed", "bytes_written", "allocations", "buffers_reused", "overflow_checks"
+};
+
+const char * Profile::timer_name(ProfileTimer timer) {
+	return timer_names[timer];
+}
+
+void Profile::print_at_exit() {
+	static bool registered = false;
+	if (!registered) {
+		registered = true;
+		atexit([] { Profile::print(cerr); });
+	}
+}
+
+void Profile::reset() {
+	for (size_t i = 0; i < NUM_PROFILE_TIMERS; i++) {
+		timer_calls[i] = 0;
+		timer_ns[i] = 0;
+	}
+
+	for (size_t i = 0; i < NUM_PROFILE_COUNTERS; i++) {
+		counters[i] = 0;
+	}
+}
+
+void Profile::print(ostream &os) {
+	const ios::fmtflags flags = os.flags();
+	const streamsize precision = os.precision();
+
+	os << "{" << endl;
+	os << "  \"timers\": {" << endl;
+	for (size_t i = 0; i < NUM_PROFILE_TIMERS; i++) {
+		os << "    \"" << timer_names[i] << "\": { \"calls\": " << timer_calls[i]
+			<< ", \"seconds\": " << fixed << setprecision(6) << timer_ns[i] / 1e9 << " }"
+			<< (i + 1 < NUM_PROFILE_TIMERS ? "," : "") << endl;
+	}
+
+	os << "  }," << endl;
+	os << "  \"counters\": {" << endl;
+	for (size_t i = 0; i < NUM_PROFILE_COUNTERS; i++) {
+		os << "    \"" << counter_names[i] << "\": " << counters[i] << "," << endl;
+	}
+
+	os << "    \"clipped_samples\": " << clipped_samples << endl;
+	os << "  }" << endl;
+	os << "}" << endl;
+
+	os.flags(flags);
+	os.precision(precision);
+}
@@ -0,0 +1,137 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <atomic>
+#include <iostream>
+
+#include "Trace.h"
+#include "flags.h"
+
+using namespace std;
+
+/**
+ * Stages timed by PROFILE_SCOPE(...). Stages nest (reading an .abc229 file
+ * includes its synthesis), so each time includes the stages called from it,
+ * and time spent on several threads at once is summed.
+ */
+enum ProfileTimer {
+	TIMER_READ_FILE, /**< iFileReader::read_file(...), a whole file at once. */
+	TIMER_READ_BLOCK, /**< iBlockReader::read_block(...), decoding one block. */
+	TIMER_SYNTHESIS, /**< Rendering notes and waveforms into samples. */
+	TIMER_ARITHMETIC, /**< The AudioFile operators, and the sums of the Mixer. */
+	TIMER_WRITE_FILE, /**< iFileWriter::write_file(...), a whole file at once. */
+	TIMER_WRITE_BLOCK, /**< iBlockWriter::write_block(...), encoding one block. */
+	NUM_PROFILE_TIMERS
+};
+
+/**
+ * Quantities counted by PROFILE_COUNT(...).
+ */
+enum ProfileCounter {
+	COUNTER_SAMPLES_PARSED, /**< Samples decoded by the readers, or synthesized from a score. */
+	COUNTER_BYTES_WRITTEN, /**< Bytes written by the writers. */
+	COUNTER_ALLOCATIONS, /**< Sample buffers BufferPool had to get from the system. */
+	COUNTER_BUFFERS_REUSED, /**< Sample buffers BufferPool handed out from its free lists. */
+	COUNTER_OVERFLOW_CHECKS, /**< Samples checked against their bit resolution. */
+	NUM_PROFILE_COUNTERS
+};
+
+/**
+ * Process wide timers and counters, recorded while 'profiling' (see flags.h)
+ * is set, which is what the '--profile' option of the tools does.
+ * Instrumented code uses the PROFILE_SCOPE(...) and PROFILE_COUNT(...) macros,
+ * which only test 'profiling' when it is not set, and compile to nothing
+ * when IMAUDIO_NO_PROFILE is defined. While the Trace recorder is on,
+ * every timed scope is also recorded as an event of its timeline.
+ */
+class Profile {
+public:
+	/**
+	 * \param timer Stage the time was spent in.
+	 * \param ns Number of nanoseconds spent.
+	 */
+	static inline void add_time(ProfileTimer timer, long ns) {
+		timer_calls[timer].fetch_add(1, memory_order_relaxed);
+		timer_ns[timer].fetch_add(ns, memory_order_relaxed);
+	}
+
+	/**
+	 * \param counter Counter to increase.
+	 * \param n Amount to add to the counter.
+	 */
+	static inline void add(ProfileCounter counter, unsigned long n) {
+		counters[counter].fetch_add(n, memory_order_relaxed);
+	}
+
+	/**
+	 * \param timer A stage.
+	 * \return The name of the stage, as printed by print(...).
+	 */
+	static const char * timer_name(ProfileTimer timer);
+
+	/**
+	 * Prints every timer and counter to standard error when the program
+	 * exits, through any return of main(...). Calling it again has no effect.
+	 */
+	static void print_at_exit();
+
+	/**
+	 * Sets every timer and counter back to 0.
+	 */
+	static void reset();
+
+	/**
+	 * Prints every timer and counter as a JSON object, along
+	 * with the number of samples clipped so far (see flags.h).
+	 * \param os Output stream to print to.
+	 */
+	static void print(ostream &os);
+
+private:
+	static atomic<unsigned long> timer_calls[NUM_PROFILE_TIMERS]; /**< Number of scopes timed per stage. */
+	static atomic<unsigned long> timer_ns[NUM_PROFILE_TIMERS]; /**< Nanoseconds spent per stage. */
+	static atomic<unsigned long> counters[NUM_PROFILE_COUNTERS]; /**< Value of every counter. */
+};
+
+/**
+ * Adds the time between its construction and its destruction to a stage,
+ * provided 'profiling' was set when it was constructed, and records it
+ * as an event when the Trace recorder is on.
+ */
+class ProfileScope {
+public:
+	ProfileScope(ProfileTimer Timer) : timer{Timer}, active{profiling || Trace::is_enabled()} {
+		if (active) {
+			start = Trace::now();
+		}
+	}
+
+	~ProfileScope() {
+		if (active) {
+			const uint64_t end = Trace::now();
+			if (profiling) {
+				Profile::add_time(timer, end - start);
+			}
+
+			if (Trace::is_enabled()) {
+				Trace::record(Profile::timer_name(timer), start, end);
+			}
+		}
+	}
+
+private:
+	ProfileTimer timer; /**< Stage being timed. */
+	bool active; /**< Whether 'profiling' or the Trace recorder was on at construction. */
+	uint64_t start; /**< Value of Trace::now() on construction. */
+};
+
+#ifdef IMAUDIO_NO_PROFILE
+#define PROFILE_SCOPE(timer)
+#define PROFILE_COUNT(counter, n)
+#else
+// times the rest of the enclosing scope, at most once per scope
+#define PROFILE_SCOPE(timer) ProfileScope profile_scope(timer)
+#define PROFILE_COUNT(counter, n) do { if (profiling) { Profile::add(counter, n); } } while (0)
+#endif
+
+#endif
@@ -0,0 +1,94 @@
+#include <math.h>
+#include <algorithm>
+
+#include "RenderGraph.h"
+#include "func/BlockRenderer.h"
+#include "Profile.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include "flags.h"
+
+static const string overflow_msg = "Sample exceeds this Channels bit resolution!";
+
+RenderGraph& RenderGraph::gain(double scalar) {
+	chain.gain(scalar);
+	total_gain *= scalar;
+	return *this;
+}
+
+RenderGraph& RenderGraph::envelope(iFunction *func) {
+	chain.envelope(func);
+
+	// only a single adsr envelope can be folded into the fused renderer
+	AdsrEnvelope *env = dynamic_cast<AdsrEnvelope *>(func);
+	if (env && !adsr) {
+		adsr = env;
+	} else {
+		fused = false;
+	}
+
+	return *this;
+}
+
+void RenderGraph::render_block(size_t first_sample, double SampleRate, double *out, size_t count) {
+	iWaveform *wave = fused ? dynamic_cast<iWaveform *>(source) : nullptr;
+
+	// oscillator -> gain -> envelope, all within the same block
+	if (wave) {
+		render_waveform_block(*wave, adsr, total_gain, first_sample, SampleRate, out, count);
+	} else {
+		source->sample_block(first_sample, SampleRate, out, count);
+		chain.process_block(out, count, first_sample, SampleRate);
+	}
+}
+
+AudioFile RenderGraph::render(size_t SampleRate, double Length, size_t BitRes, bool FloatFormat) {
+	PROFILE_SCOPE(TIMER_SYNTHESIS);
+	AudioFile file = AudioFile(source->function_name(), "iFunction", SampleRate, BitRes, 1, FloatFormat);
+	const size_t sample_count = Length > 0.0 ? (size_t)ceil(Length * SampleRate) : 0;
+	const long max_val = 1L << (BitRes - 1);
+	const long min_val = -(max_val - 1);
+
+	const size_t task_count = (sample_count + RENDER_TASK_SIZE - 1) / RENDER_TASK_SIZE;
+
+	Channel &channel = file[0];
+	channel.resize(sample_count);
+
+	// every task renders its own range of the channel, so no locking is needed
+	auto render_range = [&](size_t task) {
+		TRACE_SCOPE("render_chunk");
+		double block[RENDER_BLOCK_SIZE];
+		const size_t end = min(sample_count, (task + 1) * RENDER_TASK_SIZE);
+
+		for (size_t start = task * RENDER_TASK_SIZE; start < end; start += RENDER_BLOCK_SIZE) {
+			const size_t count = min((size_t)RENDER_BLOCK_SIZE, end - start);
+			render_block(start, SampleRate, block, count);
+
+			// quantize straight into the output channel
+			if (FloatFormat) {
+				double * out = channel.float_data() + start;
+				for (size_t i = 0; i < count; i++) {
+					out[i] = block[i];
+				}
+			} else {
+				long * out = channel.data() + start;
+				for (size_t i = 0; i < count; i++) {
+					const long val = lround(block[i]);
+					if (val > max_val || val < min_val) {
+						throw overflow_error(overflow_msg);
+					}
+
+					out[i] = val;
+				}
+			}
+		}
+	};
+
+	if (task_count > 1) {
+		ThreadPool::shared().parallel_for(task_count, render_range);
+	} else if (task_count == 1) {
+		render_range(0);
+	}
+
+	return file;
+}
@@ -0,0 +1,79 @@
+#ifndef RENDERGRAPH_H
+#define RENDERGRAPH_H
+
+#include "AudioFile.h"
+#include "ProcessChain.h"
+#include "func/iFunction.h"
+#include "func/iWaveform.h"
+#include "func/AdsrEnvelope.h"
+
+using namespace std;
+
+/**
+ * Describes how to synthesize a single channel AudioFile:
+ * a source function (usually an iWaveform oscillator), followed by
+ * any number of gain and envelope stages, followed by a final quantize.
+ * The whole graph is evaluated block by block (RENDER_BLOCK_SIZE samples
+ * at a time), each block staying in cache while it passes through every
+ * stage and is then written directly to the output Channel, so no
+ * intermediate AudioFile is ever created.
+ * When the graph is a known iWaveform followed by gains and at most one
+ * AdsrEnvelope, the whole graph is rendered by a single template
+ * instantiation (see func/BlockRenderer.h) with no virtual calls per sample.
+ * Ranges of RENDER_TASK_SIZE samples are rendered on the shared ThreadPool,
+ * so the functions of a graph must not change while it is rendered.
+ */
+class RenderGraph {
+public:
+	/**
+	 * \param Source Function that produces the raw samples, it is not owned by the graph.
+	 */
+	RenderGraph(iFunction *Source) : source{Source}, total_gain{1.0}, adsr{nullptr}, fused{true} { }
+
+	/**
+	 * Adds a constant gain to the end of this graph.
+	 * \param scalar Scalar to multiply each sample by.
+	 * \return This graph, so calls may be strung together.
+	 */
+	RenderGraph& gain(double scalar);
+
+	/**
+	 * Adds an envelope (or any other function of time) to the end of this graph.
+	 * The function is not owned by the graph, and must outlive it.
+	 * \param func Function to multiply each sample by.
+	 * \return This graph, so calls may be strung together.
+	 */
+	RenderGraph& envelope(iFunction *func);
+
+	/**
+	 * Evaluates this graph from time 0 to time 'Length', producing the same
+	 * samples iFunction::generate_audio_file(...) would before the gain and
+	 * envelope stages are applied. Results are rounded to the nearest integer,
+	 * throwing an overflow_error if a sample does not fit in 'BitRes'.
+	 * \param SampleRate Number of samples per second.
+	 * \param Length Length (in seconds) of the output AudioFile.
+	 * \param BitRes Bit resolution to use in the generated AudioFile.
+	 * \param FloatFormat If true the output is left unquantized (see Channel).
+	 * \return Single channel AudioFile holding the output of this graph.
+	 */
+	AudioFile render(size_t SampleRate, double Length, size_t BitRes, bool FloatFormat = false);
+
+	/**
+	 * Evaluates this graph for a block of consecutive samples, without quantizing
+	 * them, for callers streaming the output (see Pipeline::render(...)).
+	 * \param first_sample Index of the first sample of the block.
+	 * \param SampleRate Number of samples per second.
+	 * \param out Array of at least 'count' values to store the samples in.
+	 * \param count Number of samples in the block (at most RENDER_BLOCK_SIZE).
+	 */
+	void render_block(size_t first_sample, double SampleRate, double *out, size_t count);
+
+private:
+	iFunction *source; /**< Oscillator at the start of the graph. */
+	ProcessChain chain; /**< Gain and envelope stages, in order. */
+	double total_gain; /**< Product of every gain stage. */
+	AdsrEnvelope *adsr; /**< The graphs only envelope, when it can be fused. */
+	bool fused; /**< Whether the graph can be rendered by render_waveform_block(...). */
+};
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef SAMPLEBLOCK_H
+#define SAMPLEBLOCK_H
+
+#include <vector>
+#include <stddef.h>
+
+#include "BufferPool.h"
+
+using namespace std;
+
+/**
+ * Fixed capacity buffer holding a run of consecutive frames
+ * (one sample per channel) for streaming operations.
+ * Samples are stored planar, every channel has its own contiguous
+ * array of 'capacity' samples, of which the first 'frames' are valid.
+ * Unlike a Channel, a SampleBlock performs no bit resolution checks,
+ * and is reused from one block to the next to avoid allocations.
+ */
+class SampleBlock {
+public:
+	/**
+	 * \param NumChannels Number of channels held by this block.
+	 * \param Capacity Maximum number of frames this block can hold.
+	 */
+	SampleBlock(size_t NumChannels, size_t Capacity) : 
+		num_channels{NumChannels}, capacity{Capacity}, frames{0},
+		samples(NumChannels * Capacity, 0) { }
+
+	/**
+	 * \param c Index of the channel.
+	 * \return Pointer to the first sample of the given channel.
+	 */
+	inline long * channel(size_t c) {
+		return samples.data() + c * capacity;
+	}
+
+	/**
+	 * \param c Index of the channel.
+	 * \return Pointer to the first sample of the given channel.
+	 */
+	inline const long * channel(size_t c) const {
+		return samples.data() + c * capacity;
+	}
+
+	/**
+	 * \return Number of channels held by this block.
+	 */
+	inline size_t get_num_channels() const {
+		return num_channels;
+	}
+
+	/**
+	 * \return Maximum number of frames this block can hold.
+	 */
+	inline size_t get_capacity() const {
+		return capacity;
+	}
+
+	/**
+	 * \return Number of valid frames currently held by this block.
+	 */
+	inline size_t get_frames() const {
+		return frames;
+	}
+
+	/**
+	 * Sets the number of valid frames, must not exceed the capacity.
+	 * \param Frames The new number of valid frames.
+	 */
+	inline void set_frames(size_t Frames) {
+		frames = Frames;
+	}
+
+	/**
+	 * Sets the first 'Frames' samples of every channel to 0,
+	 * and marks them as valid.
+	 * \param Frames Number of frames to clear.
+	 */
+	void clear(size_t Frames) {
+		for (size_t c = 0; c < num_channels; c++) {
+			long * data = channel(c);
+			for (size_t i = 0; i < Frames; i++) {
+				data[i] = 0;
+			}
+		}
+
+		frames = Frames;
+	}
+
+private:
+	size_t num_channels; /**< Number of channels held by this block. */
+	size_t capacity; /**< Maximum number of frames per channel. */
+	size_t frames; /**< Number of valid frames per channel. */
+	SampleVector samples; /**< Planar sample storage, 'capacity' samples per channel. */
+};
+
+#endif
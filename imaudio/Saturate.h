@@ -0,0 +1,44 @@
+#ifndef SATURATE_H
+#define SATURATE_H
+
+#include <stddef.h>
+
+/**
+ * Counts the samples that fall outside of [min_val, max_val].
+ * The loop is branch free so the compiler can vectorize it.
+ * \param samples Samples to test.
+ * \param count Number of samples to test.
+ * \param min_val Smallest valid sample.
+ * \param max_val Largest valid sample.
+ * \return The number of samples out of range.
+ */
+inline size_t count_overflows(const long *samples, size_t count, long min_val, long max_val) {
+	size_t overs = 0;
+	for (size_t i = 0; i < count; i++) {
+		overs += (samples[i] > max_val) | (samples[i] < min_val);
+	}
+
+	return overs;
+}
+
+/**
+ * Clips every sample to [min_val, max_val] in place.
+ * The loop is branch free so the compiler can vectorize it.
+ * \param samples Samples to clip.
+ * \param count Number of samples to clip.
+ * \param min_val Smallest valid sample.
+ * \param max_val Largest valid sample.
+ * \return The number of samples that were clipped.
+ */
+inline size_t saturate(long *samples, size_t count, long min_val, long max_val) {
+	size_t overs = 0;
+	for (size_t i = 0; i < count; i++) {
+		const long val = samples[i];
+		overs += (val > max_val) | (val < min_val);
+		samples[i] = val > max_val ? max_val : (val < min_val ? min_val : val);
+	}
+
+	return overs;
+}
+
+#endif
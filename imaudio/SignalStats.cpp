@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <stdexcept>
+#include <math.h>
+#include <stdlib.h>
+
+#include "SignalStats.h"
+#include "Trace.h"
+#include "flags.h"
+
+SignalStats::SignalStats(size_t NumChannels, size_t BitRes, size_t SampleRate) :
+		bit_res{BitRes}, sample_rate{SampleRate} {
+	channels.resize(NumChannels, { 0, 0.0, 0.0, 0, 0, 0, 0, 0, 0 });
+}
+
+void SignalStats::add(size_t channel, const long *samples, size_t count) {
+	if (count == 0) {
+		return;
+	}
+
+	Totals &totals = channels[channel];
+
+	// writers saturate to the symmetric range, so full scale is one below the largest valid sample
+	const long rail = (1L << (bit_res - 1)) - 1;
+
+	// integer sums are exact and vectorize, work in runs short enough for them not to overflow
+	for (size_t start = 0; start < count; start += RENDER_BLOCK_SIZE) {
+		const long *run = samples + start;
+		const size_t len = min((size_t)RENDER_BLOCK_SIZE, count - start);
+
+		long sum = 0;
+		long min_val = run[0];
+		long max_val = run[0];
+		size_t clipped = 0;
+		for (size_t i = 0; i < len; i++) {
+			const long val = run[i];
+			sum += val;
+			min_val = min(min_val, val);
+			max_val = max(max_val, val);
+			clipped += (val >= rail) | (val <= -rail);
+		}
+
+		double sum_squares = 0.0;
+		if (bit_res <= 16) {
+			long squares = 0;
+			for (size_t i = 0; i < len; i++) {
+				squares += run[i] * run[i];
+			}
+
+			sum_squares = squares;
+		} else {
+			for (size_t i = 0; i < len; i++) {
+				sum_squares += (double)run[i] * run[i];
+			}
+		}
+
+		size_t crossings = 0;
+		for (size_t i = 1; i < len; i++) {
+			crossings += (run[i - 1] ^ run[i]) < 0;
+		}
+
+		// join this run to the samples before it
+		if (totals.count == 0) {
+			totals.first = run[0];
+			totals.min_val = min_val;
+			totals.max_val = max_val;
+		} else {
+			crossings += (totals.last ^ run[0]) < 0;
+			totals.min_val = min(totals.min_val, min_val);
+			totals.max_val = max(totals.max_val, max_val);
+		}
+
+		totals.count += len;
+		totals.sum += sum;
+		totals.sum_squares += sum_squares;
+		totals.clipped += clipped;
+		totals.crossings += crossings;
+		totals.last = run[len - 1];
+	}
+}
+
+void SignalStats::add_block(const SampleBlock &block) {
+	for (size_t c = 0; c < channels.size(); c++) {
+		add(c, block.channel(c), block.get_frames());
+	}
+}
+
+void SignalStats::merge(const SignalStats &other) {
+	if (other.channels.size() != channels.size()) {
+		throw invalid_argument("Only statistics of the same format can be merged.");
+	}
+
+	for (size_t c = 0; c < channels.size(); c++) {
+		Totals &totals = channels[c];
+		const Totals &next = other.channels[c];
+
+		if (next.count == 0) {
+			continue;
+		} else if (totals.count == 0) {
+			totals = next;
+			continue;
+		}
+
+		totals.crossings += next.crossings + ((totals.last ^ next.first) < 0);
+		totals.min_val = min(totals.min_val, next.min_val);
+		totals.max_val = max(totals.max_val, next.max_val);
+		totals.count += next.count;
+		totals.sum += next.sum;
+		totals.sum_squares += next.sum_squares;
+		totals.clipped += next.clipped;
+		totals.last = next.last;
+	}
+}
+
+SignalStats SignalStats::analyze(iBlockReader &reader, ThreadPool *pool) {
+	const size_t num_channels = reader.get_num_channels();
+	SignalStats stats = SignalStats(num_channels, reader.get_bit_res(), reader.get_sample_rate());
+
+	if (!pool) {
+		SampleBlock block = SampleBlock(num_channels, STREAM_BLOCK_SIZE);
+		while (reader.read_block(block) > 0) {
+			stats.add_block(block);
+		}
+
+		return stats;
+	}
+
+	// read one block per worker, analyze them together, then merge them in order
+	const size_t batch = max(pool->size(), (size_t)1);
+	vector<SampleBlock> blocks(batch, SampleBlock(num_channels, STREAM_BLOCK_SIZE));
+	vector<SignalStats> partials(batch, stats);
+
+	while (true) {
+		size_t filled = 0;
+		while (filled < batch && reader.read_block(blocks[filled]) > 0) {
+			filled++;
+		}
+
+		if (filled == 0) {
+			break;
+		}
+
+		pool->parallel_for(filled, [&](size_t i) {
+			TRACE_SCOPE("stats_block");
+			partials[i] = SignalStats(num_channels, stats.bit_res, stats.sample_rate);
+			partials[i].add_block(blocks[i]);
+		});
+
+		for (size_t i = 0; i < filled; i++) {
+			stats.merge(partials[i]);
+		}
+
+		if (filled < batch) {
+			break;
+		}
+	}
+
+	return stats;
+}
+
+long SignalStats::get_peak(size_t c) const {
+	return max(labs(channels[c].min_val), labs(channels[c].max_val));
+}
+
+double SignalStats::get_rms(size_t c) const {
+	return channels[c].count ? sqrt(channels[c].sum_squares / channels[c].count) : 0.0;
+}
+
+double SignalStats::get_dc(size_t c) const {
+	return channels[c].count ? channels[c].sum / channels[c].count : 0.0;
+}
+
+double SignalStats::get_zero_crossing_rate(size_t c) const {
+	return channels[c].count ? channels[c].crossings * (double)sample_rate / channels[c].count : 0.0;
+}
+
+/**
+ * \return The level in decibels relative to full scale.
+ */
+static double to_dbfs(double level, size_t bit_res) {
+	const double full_scale = (1L << (bit_res - 1)) - 1;
+	return level > 0.0 ? 20.0 * log10(level / full_scale) : -INFINITY;
+}
+
+ostream& operator<<(ostream &os, const SignalStats &stats) {
+	for (size_t c = 0; c < stats.channels.size(); c++) {
+		os << "Channel " << c << ":" << endl;
+		os << "  Peak:\t\t" << stats.get_peak(c) << " (" << to_dbfs(stats.get_peak(c), stats.bit_res) << " dBFS)" << endl;
+		os << "  RMS:\t\t" << stats.get_rms(c) << " (" << to_dbfs(stats.get_rms(c), stats.bit_res) << " dBFS)" << endl;
+		os << "  DC Offset:\t" << stats.get_dc(c) << endl;
+		os << "  Zero Crossings:\t" << stats.get_zero_crossing_rate(c) << " per second" << endl;
+		os << "  Clipped:\t" << stats.get_clipped(c) << endl;
+	}
+
+	return os;
+}
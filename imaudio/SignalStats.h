@@ -0,0 +1,124 @@
+#ifndef SIGNAL_STATS_H
+#define SIGNAL_STATS_H
+
+#include <vector>
+#include <iostream>
+
+#include "iBlockReader.h"
+#include "SampleBlock.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+/**
+ * Per channel statistics of a signal: peak, RMS, DC offset (mean),
+ * zero crossing rate and the number of samples at full scale.
+ * Statistics are gathered in a single pass, with tight integer loops
+ * the compiler can vectorize. Partial results over consecutive runs of
+ * the signal can be merged, so a long signal can be split into chunks
+ * which are analyzed in parallel and then merged in order.
+ */
+class SignalStats {
+public:
+	/**
+	 * \param NumChannels Number of channels in the signal.
+	 * \param BitRes Resolution (in bits) of the samples, which decides full scale.
+	 * \param SampleRate Number of samples per second, used for the zero crossing rate.
+	 */
+	SignalStats(size_t NumChannels, size_t BitRes, size_t SampleRate);
+
+	/**
+	 * Adds the next run of samples of a channel.
+	 * \param channel Index of the channel.
+	 * \param samples The samples that follow those already added to the channel.
+	 * \param count Number of samples.
+	 */
+	void add(size_t channel, const long *samples, size_t count);
+
+	/**
+	 * Adds every valid frame of the block, in order.
+	 * \param block Block of samples, with the same number of channels.
+	 */
+	void add_block(const SampleBlock &block);
+
+	/**
+	 * Merges the statistics of the run of samples following the run described by this object.
+	 * \param other Statistics of the next run, with the same format.
+	 */
+	void merge(const SignalStats &other);
+
+	/**
+	 * Reads every remaining block of the reader and gathers their statistics.
+	 * When a pool is given, several blocks are read at a time and analyzed in parallel.
+	 * \param reader An open reader.
+	 * \param pool Pool to analyze blocks on, or nullptr to analyze them on the calling thread.
+	 * \return Statistics of the whole stream.
+	 */
+	static SignalStats analyze(iBlockReader &reader, ThreadPool *pool = nullptr);
+
+	/**
+	 * Writes the statistics of every channel, one field per line.
+	 */
+	friend ostream& operator<<(ostream &os, const SignalStats &stats);
+
+	/**
+	 * \return The number of frames added so far.
+	 */
+	inline size_t get_num_samples() const {
+		return channels.empty() ? 0 : channels[0].count;
+	}
+
+	/**
+	 * \param c Index of the channel.
+	 * \return The largest absolute sample value of the channel.
+	 */
+	long get_peak(size_t c) const;
+
+	/**
+	 * \param c Index of the channel.
+	 * \return The root mean square of the channel.
+	 */
+	double get_rms(size_t c) const;
+
+	/**
+	 * \param c Index of the channel.
+	 * \return The mean of the channel (DC offset).
+	 */
+	double get_dc(size_t c) const;
+
+	/**
+	 * \param c Index of the channel.
+	 * \return The number of times the channel changes sign per second.
+	 */
+	double get_zero_crossing_rate(size_t c) const;
+
+	/**
+	 * \param c Index of the channel.
+	 * \return The number of samples at (or past) full scale.
+	 */
+	inline size_t get_clipped(size_t c) const {
+		return channels[c].clipped;
+	}
+
+private:
+	/**
+	 * Running totals of a single channel.
+	 */
+	struct Totals {
+		size_t count; /**< Number of samples added. */
+		double sum; /**< Sum of the samples. */
+		double sum_squares; /**< Sum of the squared samples. */
+		long min_val; /**< Smallest sample. */
+		long max_val; /**< Largest sample. */
+		size_t clipped; /**< Samples at full scale. */
+		size_t crossings; /**< Sign changes between consecutive samples. */
+		long first; /**< First sample added. */
+		long last; /**< Last sample added. */
+	};
+
+	size_t bit_res; /**< Resolution (in bits) of the samples. */
+	size_t sample_rate; /**< Number of samples per second. */
+	vector<Totals> channels; /**< Totals of each channel. */
+};
+
+#endif
@@ -0,0 +1,198 @@
+#include <string>
+
+#include "ThreadPool.h"
+#include "Trace.h"
+
+// pool and queue index of the worker running on the current thread
+static thread_local ThreadPool *current_pool = nullptr;
+static thread_local size_t current_index = 0;
+
+ThreadPool::ThreadPool(size_t NumThreads, size_t MaxPending) :
+		max_pending{MaxPending}, pending{0}, queued{0}, next_queue{0}, stopping{false} {
+	if (NumThreads == 0) {
+		NumThreads = max(thread::hardware_concurrency(), 1u);
+	}
+
+	for (size_t i = 0; i < NumThreads; i++) {
+		queues.push_back(unique_ptr<WorkQueue>(new WorkQueue()));
+	}
+
+	for (size_t i = 0; i < NumThreads; i++) {
+		workers.push_back(thread(&ThreadPool::run, this, i));
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		unique_lock<mutex> guard(lock);
+		stopping = true;
+	}
+
+	task_ready.notify_all();
+	for (auto &worker : workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::submit(function<void()> task) {
+	const bool from_worker = current_pool == this;
+	size_t index = current_index;
+
+	{
+		unique_lock<mutex> guard(lock);
+		if (max_pending && !from_worker && pending >= max_pending) {
+			TRACE_SCOPE("submit_blocked");
+			task_done.wait(guard, [this] { return pending < max_pending; });
+		}
+
+		pending++;
+		if (!from_worker) {
+			index = next_queue++ % queues.size();
+		}
+	}
+
+	{
+		unique_lock<mutex> guard(queues[index]->lock);
+		queues[index]->tasks.push_back(move(task));
+	}
+
+	{
+		unique_lock<mutex> guard(lock);
+		queued++;
+	}
+
+	task_ready.notify_one();
+}
+
+void ThreadPool::wait() {
+	TRACE_SCOPE("pool_wait");
+	unique_lock<mutex> guard(lock);
+	task_done.wait(guard, [this] { return pending == 0; });
+
+	if (error) {
+		exception_ptr e = error;
+		error = nullptr;
+		rethrow_exception(e);
+	}
+}
+
+void ThreadPool::parallel_for(size_t count, function<void(size_t)> body) {
+	if (count == 1) {
+		body(0);
+		return;
+	}
+
+	// the tasks report to the group, never to the pool wide 'pending' and 'error'
+	TaskGroup group = { count, nullptr };
+	for (size_t i = 0; i < count; i++) {
+		submit([this, &body, &group, i] {
+			exception_ptr e = nullptr;
+			try {
+				body(i);
+			} catch (...) {
+				e = current_exception();
+			}
+
+			unique_lock<mutex> guard(lock);
+			if (e && !group.error) {
+				group.error = e;
+			}
+
+			group.remaining--;
+		});
+	}
+
+	// a worker waiting for its own tasks would hold back the pool, so it runs queued tasks meanwhile
+	TRACE_SCOPE("pool_wait");
+	const bool from_worker = current_pool == this;
+	function<void()> task;
+	while (from_worker && take_task(current_index, task)) {
+		run_task(task);
+		task = nullptr;
+	}
+
+	// every task left was taken by another worker
+	unique_lock<mutex> guard(lock);
+	task_done.wait(guard, [&group] { return group.remaining == 0; });
+	if (group.error) {
+		rethrow_exception(group.error);
+	}
+}
+
+ThreadPool& ThreadPool::shared() {
+	static ThreadPool pool;
+	return pool;
+}
+
+bool ThreadPool::take_task(size_t index, function<void()> &task) {
+	// our own queue first, newest task first while it is still hot in the cache
+	{
+		WorkQueue &own = *queues[index];
+		unique_lock<mutex> guard(own.lock);
+		if (!own.tasks.empty()) {
+			task = move(own.tasks.back());
+			own.tasks.pop_back();
+			return true;
+		}
+	}
+
+	// then steal the oldest task of another worker
+	for (size_t i = 1; i < queues.size(); i++) {
+		WorkQueue &other = *queues[(index + i) % queues.size()];
+		unique_lock<mutex> guard(other.lock);
+		if (!other.tasks.empty()) {
+			task = move(other.tasks.front());
+			other.tasks.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ThreadPool::run(size_t index) {
+	current_pool = this;
+	current_index = index;
+	Trace::set_thread_name("worker " + to_string(index));
+
+	while (true) {
+		function<void()> task;
+		if (!take_task(index, task)) {
+			TRACE_SCOPE("idle");
+			unique_lock<mutex> guard(lock);
+			task_ready.wait(guard, [this] { return stopping || queued > 0; });
+			if (stopping && queued <= 0) {
+				return;
+			}
+
+			continue;
+		}
+
+		run_task(task);
+	}
+}
+
+void ThreadPool::run_task(function<void()> &task) {
+	{
+		unique_lock<mutex> guard(lock);
+		queued--;
+	}
+
+	try {
+		TRACE_SCOPE("task");
+		task();
+	} catch (...) {
+		unique_lock<mutex> guard(lock);
+		if (!error) {
+			error = current_exception();
+		}
+	}
+
+	{
+		unique_lock<mutex> guard(lock);
+		pending--;
+	}
+
+	// wakes wait(), parallel_for(...), and any submit(...) blocked on a bounded pool
+	task_done.notify_all();
+}
@@ -0,0 +1,131 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+
+using namespace std;
+
+/**
+ * Fixed size pool of worker threads with work stealing.
+ * Every worker owns a queue of tasks. Tasks submitted from outside the pool
+ * are spread across the queues in turn, tasks submitted by a worker go to its
+ * own queue. A worker runs the newest task of its own queue first, and once it
+ * runs dry steals the oldest task from the other queues, so a worker stuck on
+ * a long task does not hold back the tasks queued behind it.
+ * The pool may be bounded, in which case submit(...) blocks while too many tasks
+ * are queued or running, which keeps producers from racing ahead of the workers.
+ * If a task throws an exception, the first such exception is stored and rethrown
+ * to the caller of wait(). parallel_for(...) keeps the count and the exception of
+ * its own tasks instead, so calls made at the same time never wait for (or get
+ * the exceptions of) each other's tasks.
+ */
+class ThreadPool {
+public:
+	/**
+	 * \param NumThreads Number of worker threads, 0 uses the number of hardware threads.
+	 * \param MaxPending Maximum number of tasks queued or running at once, 0 for no limit.
+	 */
+	ThreadPool(size_t NumThreads = 0, size_t MaxPending = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool &other) = delete;
+	ThreadPool& operator=(const ThreadPool &other) = delete;
+
+	/**
+	 * Queues a task to be run by one of the workers.
+	 * If the pool is bounded and full, this blocks until a task finishes.
+	 * Tasks submitting further tasks are never blocked, as that could dead lock the pool.
+	 * \param task The task to run.
+	 */
+	void submit(function<void()> task);
+
+	/**
+	 * Blocks until every submitted task has finished, including those of
+	 * any parallel_for(...) running at the same time.
+	 * If any task given to submit(...) threw an exception, it is rethrown here.
+	 */
+	void wait();
+
+	/**
+	 * Calls body(i) for every i in the range [0, count) spread across
+	 * the workers, and blocks until all calls have finished. The first
+	 * exception thrown by the body is rethrown once they all finished.
+	 * When count is 1 the body is run directly on the calling thread.
+	 * A task of the same pool calling this runs queued tasks while it waits,
+	 * so nested calls can not dead lock the pool.
+	 * \param count Number of calls to make.
+	 * \param body Function to call with each index.
+	 */
+	void parallel_for(size_t count, function<void(size_t)> body);
+
+	/**
+	 * \return The number of worker threads in this pool.
+	 */
+	inline size_t size() const {
+		return workers.size();
+	}
+
+	/**
+	 * \return A process wide pool with one worker per hardware thread.
+	 */
+	static ThreadPool& shared();
+
+private:
+	/**
+	 * Main loop of each worker thread.
+	 * \param index Index of the worker, and of the queue it owns.
+	 */
+	void run(size_t index);
+
+	/**
+	 * Takes the newest task of the worker's own queue, or else
+	 * the oldest task of any other queue.
+	 * \param index Index of the worker looking for a task.
+	 * \param task Set to the task found.
+	 * \return Whether or not a task was found.
+	 */
+	bool take_task(size_t index, function<void()> &task);
+
+	/**
+	 * Runs a task taken from a queue, and updates the counts of the pool.
+	 * \param task The task to run.
+	 */
+	void run_task(function<void()> &task);
+
+	/**
+	 * Queue of tasks owned by a single worker.
+	 */
+	struct WorkQueue {
+		mutex lock; /**< Guards 'tasks'. */
+		deque<function<void()>> tasks; /**< Tasks waiting to run, newest at the back. */
+	};
+
+	/**
+	 * Tasks of a single parallel_for(...) call.
+	 */
+	struct TaskGroup {
+		size_t remaining; /**< Tasks not finished yet, guarded by 'lock' of the pool. */
+		exception_ptr error; /**< First exception thrown by a task of the group. */
+	};
+
+	vector<thread> workers; /**< Threads owned by this pool. */
+	vector<unique_ptr<WorkQueue>> queues; /**< One queue per worker. */
+	mutex lock; /**< Guards every member below. */
+	condition_variable task_ready; /**< Signaled when a task is queued or the pool stops. */
+	condition_variable task_done; /**< Signaled when a task finishes. */
+	size_t max_pending; /**< Bound on 'pending', 0 if unbounded. */
+	size_t pending; /**< Tasks queued or running. */
+	long queued; /**< Tasks waiting in the queues (briefly negative while a task is stolen as it is queued). */
+	size_t next_queue; /**< Queue receiving the next task submitted from outside the pool. */
+	exception_ptr error; /**< First exception thrown by a task given to submit(...). */
+	bool stopping; /**< Set by the destructor to end the workers. */
+};
+
+#endif
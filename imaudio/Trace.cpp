@@ -0,0 +1,134 @@
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "Trace.h"
+#include "flags.h"
+
+/**
+ * Ring buffer of the events of a single thread. Only that thread writes
+ * to it, and it publishes 'head' after each event, so a reader loading
+ * 'head' first only ever sees complete events.
+ */
+struct TraceBuffer {
+	/**
+	 * An event, from its beginning to its end.
+	 */
+	struct Event {
+		const char *name; /**< Name given to Trace::record(...). */
+		uint64_t begin; /**< Trace::now() when the event began. */
+		uint64_t end; /**< Trace::now() when the event ended. */
+	};
+
+	TraceBuffer(size_t Index) : index{Index}, head{0}, events(TRACE_BUFFER_EVENTS) { }
+
+	size_t index; /**< Thread id in the trace. */
+	string name; /**< Name given to Trace::set_thread_name(...), if any. */
+	atomic<size_t> head; /**< Number of events ever recorded, the next goes to head % TRACE_BUFFER_EVENTS. */
+	vector<Event> events; /**< The last TRACE_BUFFER_EVENTS events. */
+};
+
+bool Trace::enabled = false;
+static string trace_file;
+static uint64_t trace_start = 0;
+
+// every buffer ever created, the lock is only taken by the first event of each thread
+static mutex buffers_lock;
+static vector<TraceBuffer *> buffers;
+static thread_local TraceBuffer *current_buffer = nullptr;
+
+/**
+ * \return The buffer of the calling thread, created by its first call.
+ */
+static TraceBuffer * get_buffer() {
+	if (!current_buffer) {
+		unique_lock<mutex> guard(buffers_lock);
+		current_buffer = new TraceBuffer(buffers.size());
+		buffers.push_back(current_buffer);
+	}
+
+	return current_buffer;
+}
+
+/**
+ * Writes the trace to the file given to Trace::start(...), registered with atexit(...).
+ */
+static void write_trace() {
+	ofstream os(trace_file);
+	if (!os.is_open()) {
+		cerr << trace_file << ": failed to open the trace for writing." << endl;
+		return;
+	}
+
+	Trace::write(os);
+}
+
+// turns the recorder on before main(...) when IMAUDIO_TRACE is set, any thread
+// pool is created after this, so it is joined before the trace is written
+static const bool trace_from_env = [] {
+	const char * filename = getenv("IMAUDIO_TRACE");
+	if (filename && *filename) {
+		Trace::start(filename);
+	}
+
+	return true;
+}();
+
+void Trace::start(string filename) {
+	if (enabled) {
+		return;
+	}
+
+	trace_file = filename;
+	trace_start = now();
+	enabled = true;
+
+	set_thread_name("main");
+	atexit(write_trace);
+}
+
+void Trace::record(const char *name, uint64_t begin, uint64_t end) {
+	TraceBuffer *buffer = get_buffer();
+	const size_t head = buffer->head.load(memory_order_relaxed);
+	buffer->events[head % TRACE_BUFFER_EVENTS] = { name, begin, end };
+	buffer->head.store(head + 1, memory_order_release);
+}
+
+void Trace::set_thread_name(string name) {
+	if (enabled) {
+		get_buffer()->name = name;
+	}
+}
+
+void Trace::write(ostream &os) {
+	unique_lock<mutex> guard(buffers_lock);
+	const pid_t pid = getpid();
+	const ios::fmtflags flags = os.flags();
+	const streamsize precision = os.precision();
+	bool first = true;
+
+	os << "{\"traceEvents\":[" << fixed << setprecision(3);
+	for (auto buffer : buffers) {
+		const string name = buffer->name.empty() ? "thread " + to_string(buffer->index) : buffer->name;
+		os << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid
+			<< ",\"tid\":" << buffer->index << ",\"args\":{\"name\":\"" << name << "\"}}";
+		first = false;
+
+		// once the ring wrapped only its last TRACE_BUFFER_EVENTS events are left
+		const size_t head = buffer->head.load(memory_order_acquire);
+		for (size_t i = head > TRACE_BUFFER_EVENTS ? head - TRACE_BUFFER_EVENTS : 0; i < head; i++) {
+			const TraceBuffer::Event &event = buffer->events[i % TRACE_BUFFER_EVENTS];
+			os << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"imaudio\",\"ph\":\"X\",\"pid\":" << pid
+				<< ",\"tid\":" << buffer->index << ",\"ts\":" << (event.begin - trace_start) / 1e3
+				<< ",\"dur\":" << (event.end - event.begin) / 1e3 << "}";
+		}
+	}
+
+	os << "\n],\"displayTimeUnit\":\"ms\"}" << endl;
+	os.flags(flags);
+	os.precision(precision);
+}
@@ -0,0 +1,100 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <stdint.h>
+
+using namespace std;
+
+/**
+ * Process wide timeline of what every thread was doing, written in the
+ * Chrome trace event format (chrome://tracing, ui.perfetto.dev).
+ * Setting the IMAUDIO_TRACE environment variable to a file name turns the
+ * recorder on for any program linked with imaudio, and the trace is written
+ * to that file when the program exits.
+ * Each thread records its events to a ring buffer of its own, holding the
+ * last TRACE_BUFFER_EVENTS events (see flags.h), so recording never takes a lock.
+ * The buffers outlive their threads, and are only read once the program exits.
+ */
+class Trace {
+public:
+	/**
+	 * Turns the recorder on, and writes the trace to the given file on exit.
+	 * Called on start up when IMAUDIO_TRACE is set.
+	 * \param filename Name of the file to write the trace to.
+	 */
+	static void start(string filename);
+
+	/**
+	 * \return Whether or not events are being recorded.
+	 */
+	static inline bool is_enabled() {
+		return enabled;
+	}
+
+	/**
+	 * \return Nanoseconds since an arbitrary, fixed, point in time.
+	 */
+	static inline uint64_t now() {
+		return chrono::duration_cast<chrono::nanoseconds>(
+				chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/**
+	 * Records an event of the calling thread.
+	 * \param name Name of the event, must remain valid until the trace is written (usually a literal).
+	 * \param begin Value of now() when the event began.
+	 * \param end Value of now() when the event ended.
+	 */
+	static void record(const char *name, uint64_t begin, uint64_t end);
+
+	/**
+	 * Names the calling thread in the trace, threads are otherwise named after their index.
+	 * \param name Name of the thread.
+	 */
+	static void set_thread_name(string name);
+
+	/**
+	 * Writes every event recorded so far as a Chrome trace event JSON object.
+	 * Must not be called while other threads are recording.
+	 * \param os Output stream to write to.
+	 */
+	static void write(ostream &os);
+
+private:
+	static bool enabled; /**< Set by start(...). */
+};
+
+/**
+ * Records an event spanning from its construction to its destruction,
+ * provided the recorder was on when it was constructed.
+ */
+class TraceScope {
+public:
+	TraceScope(const char *Name) : name{Trace::is_enabled() ? Name : nullptr} {
+		if (name) {
+			begin = Trace::now();
+		}
+	}
+
+	~TraceScope() {
+		if (name) {
+			Trace::record(name, begin, Trace::now());
+		}
+	}
+
+private:
+	const char *name; /**< Name of the event, nullptr when not recording. */
+	uint64_t begin; /**< Value of Trace::now() on construction. */
+};
+
+#ifdef IMAUDIO_NO_PROFILE
+#define TRACE_SCOPE(name)
+#else
+// records the rest of the enclosing scope as an event, at most once per scope
+#define TRACE_SCOPE(name) TraceScope trace_scope(name)
+#endif
+
+#endif
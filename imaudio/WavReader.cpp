@@ -3,14 +3,110 @@
 #include <string>
 #include <string.h>
 #include <stdint.h>
+#include <strings.h>
+#include <algorithm>
 
 #include "AudioFile.h"
 #include "WavReader.h"
 
 AudioFile WavReader::read_file(istream &is, string filename) {
+	read_header(is);
+
+	// create the AudioFile we will be returning
+	AudioFile ret = AudioFile(filename, ".wav", sample_rate, bit_res, num_channels);
+
+	unsigned current_channel = 0;
+	unsigned num_samples = bytes_in_data / (bit_res / 8);
+
+	// the size of the data chunk is known, so every channel is allocated once
+	ret.reserve(num_samples / num_channels);
+
+	for (unsigned i = 0; i < num_samples; i++) {
+		ret[current_channel].push_sample(get_sample(is));
+		current_channel = (current_channel + 1) % num_channels;
+	}
+
+	PROFILE_COUNT(COUNTER_SAMPLES_PARSED, num_samples);
+	return ret;
+}
+
+void WavReader::open(istream &is, string filename) {
+	read_header(is);
+
+	if (num_channels < 1 || num_channels >= 128) {
+		throw invalid_argument("Invalid num_channels in constructor.");
+	}
+
+	if (bit_res != 8 && bit_res != 16 && bit_res != 32) {
+		throw invalid_argument("Invalid bit_res in constructor.");
+	}
+
+	// the iBlockReader view of the header
+	iBlockReader::sample_rate = sample_rate;
+	iBlockReader::bit_res = bit_res;
+	iBlockReader::num_channels = num_channels;
+	iBlockReader::num_samples = bytes_in_data / (bit_res / 8) / num_channels;
+	frames_left = iBlockReader::num_samples;
+	stream = &is;
+	file_name = filename;
+}
+
+size_t WavReader::read_frames(SampleBlock &block, size_t max_frames) {
+	const size_t bytes = bit_res / 8;
+	const size_t frames = min(frames_left, max_frames);
+
+	// read the whole block at once, then decode it
+	buffer.resize(frames * num_channels * bytes);
+	stream->read(buffer.data(), buffer.size());
+	if ((size_t)stream->gcount() != buffer.size()) {
+		throw invalid_argument("Unexpected end of data chunk.");
+	}
+
+	const char * data = buffer.data();
+	for (size_t i = 0; i < frames; i++) {
+		for (size_t c = 0; c < (size_t)num_channels; c++) {
+			long sample;
+			if (bit_res == 8) {
+				// wav files use unsigned values, so convert to a signed value for the rest of the program
+				sample = (long)*(const uint8_t *)data - 127;
+			} else if (bit_res == 16) {
+				int16_t val;
+				memcpy(&val, data, 2);
+				sample = val;
+			} else {
+				int32_t val;
+				memcpy(&val, data, 4);
+				sample = val;
+			}
+
+			block.channel(c)[i] = sample;
+			data += bytes;
+		}
+	}
+
+	frames_left -= frames;
+	block.set_frames(frames);
+	return frames;
+}
+
+size_t WavReader::skip_frames(size_t frames) {
+	frames = min(frames, frames_left);
+	const streampos pos = stream->tellg();
+	if (pos < 0) {
+		// not seekable (std::cin), read through the frames instead
+		return iBlockReader::skip_frames(frames);
+	}
+
+	// block_align is not trusted, older versions of WavWriter wrote it in bits
+	stream->seekg(pos + (streamoff)(frames * num_channels * (bit_res / 8)));
+	frames_left -= frames;
+	return frames;
+}
+
+void WavReader::read_header(istream &is) {
 	// read the header
-	char * header = new char[5];
-	char * wave = new char[5];
+	char header[5];
+	char wave[5];
 	header[4] = 0;
 	wave[4] = 0;
 
@@ -24,11 +120,8 @@ AudioFile WavReader::read_file(istream &is, string filename) {
 		throw invalid_argument("Input file is not of Wav format.");
 	}
 
-	delete header;
-	delete wave;
-
 	// next read the format chunk
-	char * format = new char[5];
+	char format[5];
 	format[4] = 0;
 	int32_t bytes_in_format = 0;
 	int16_t audio_format = 0;
@@ -45,21 +138,16 @@ AudioFile WavReader::read_file(istream &is, string filename) {
 		throw invalid_argument("expected an audio format of '1'");
 	}
 
-	delete format;
-
 	is.read((char *)&num_channels, 2);
 	is.read((char *)&sample_rate, 4);
 	is.read((char *)&byte_rate, 4);
 	is.read((char *)&block_align, 2);
 	is.read((char *)&bit_res, 2);
 
-	// create the AudioFile we will be returning
-	AudioFile ret = AudioFile(filename, ".wav", sample_rate, bit_res, num_channels);
-
 	// read the data chunk
-	char * data = new char[5];
+	char data[5];
 	data[4] = 0;
-	int32_t bytes_in_data = 0;
+	bytes_in_data = 0;
 
 	is.read(data, 4);
 	is.read((char *)&bytes_in_data, 4);
@@ -67,16 +155,6 @@ AudioFile WavReader::read_file(istream &is, string filename) {
 	if (strcasecmp(data, "data") != 0) {
 		throw invalid_argument("Expection data chunk after reading the format.");
 	}
-
-	unsigned current_channel = 0;
-	unsigned num_samples = bytes_in_data / (bit_res / 8);
-
-	for (unsigned i = 0; i < num_samples; i++) {
-		ret[current_channel].push_sample(get_sample(is));
-		current_channel = (current_channel + 1) % num_channels;
-	}
-
-	return ret;
 }
 
 long WavReader::get_sample(istream &is) {
@@ -2,16 +2,44 @@
 #define WAVREADER_H
 
 #include "iFileReader.h"
+#include "iBlockReader.h"
 #include "AudioFile.h"
 
 using namespace std;
 
-class WavReader : public iFileReader {
+/**
+ * Implements the necessary methods of iFileReader
+ * to support reading from the .wav file format.
+ * The file may also be streamed one SampleBlock at a time
+ * through the iBlockReader interface.
+ */
+class WavReader : public iFileReader, public iBlockReader {
 public:
 	AudioFile read_file(string filename) { return iFileReader::read_file(filename); }
 	virtual AudioFile read_file(istream &is, string filename = "std::cin");
 
+	void open(string filename) { iBlockReader::open(filename); }
+	virtual void open(istream &is, string filename = "std::cin");
+	virtual string get_extension() const { return ".wav"; }
+
+	/**
+	 * Seeks past the frames when the stream allows it, every frame of a
+	 * Wav file has the same size so this takes constant time.
+	 */
+	virtual size_t skip_frames(size_t frames);
+
+protected:
+	virtual size_t read_frames(SampleBlock &block, size_t max_frames);
+
 private:
+	/**
+	 * Reads the RIFF header, the format chunk, and the header of the data
+	 * chunk, leaving the stream at the first sample.
+	 * This method will throw an exception if the file is not a supported Wav file.
+	 * \param is Input stream to read the header from.
+	 */
+	void read_header(istream &is);
+
 	/**
 	 * Reads 'bit_res' /  8 bytes of data from the input stream.
 	 * The data read is then returned as a long integer.
@@ -25,6 +53,9 @@ private:
 	int16_t num_channels; /**< Number of Channels as read from the Wav file. */
 	int32_t byte_rate; /**< Byte Rate as read from the Wav file. */
 	int16_t block_align; /**< Block Align as read from the Wav file. */
+	int32_t bytes_in_data; /**< Size of the data chunk as read from the Wav file. */
+	size_t frames_left; /**< Frames not yet returned by read_block(...). */
+	vector<char> buffer; /**< Raw bytes of the block being decoded. */
 };
 
 #endif
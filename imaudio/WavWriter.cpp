@@ -1,12 +1,89 @@
 #include <iostream>
 #include <fstream>
 #include <stdint.h>
+#include <string.h>
 
 #include "WavWriter.h"
 
 void WavWriter::write_file(AudioFile &file, ostream &os) {
+	file.quantize();
+
 	long samples_count = file.get_num_samples() * file.get_num_channels();
 	long samples_bytes = samples_count * (file.get_bit_res() / 8);
+	write_header(os, file.get_sample_rate(), file.get_bit_res(),
+			file.get_num_channels(), samples_bytes);
+
+	// finally write all the data (samples_bytes + 8 bytes total)
+	for (size_t i = 0; i < file.get_num_samples(); i++) {
+		for (size_t c = 0; c < file.get_num_channels(); c++) {
+			write_integer(file[c].get_sample(i), file.get_bit_res(), os);
+		}
+	}
+}
+
+void WavWriter::begin(ostream &os, size_t SampleRate, size_t BitRes,
+		size_t NumChannels, long NumSamples) {
+	stream = &os;
+	bit_res = BitRes;
+	num_channels = NumChannels;
+	frames_written = 0;
+	declared_frames = NumSamples;
+	header_pos = os.tellp();
+	begin_overview(SampleRate, BitRes, NumChannels);
+
+	long samples_bytes = NumSamples < 0 ? 0 : NumSamples * NumChannels * (BitRes / 8);
+	write_header(os, SampleRate, BitRes, NumChannels, samples_bytes);
+}
+
+void WavWriter::write_block(const SampleBlock &block) {
+	PROFILE_SCOPE(TIMER_WRITE_BLOCK);
+	const size_t bytes = bit_res / 8;
+	buffer.resize(block.get_frames() * num_channels * bytes);
+
+	// interleave the channels of the block, then write it all at once
+	char * data = buffer.data();
+	for (size_t i = 0; i < block.get_frames(); i++) {
+		for (size_t c = 0; c < num_channels; c++) {
+			const long sample = block.channel(c)[i];
+			if (bit_res == 8) {
+				*(uint8_t *)data = (uint8_t)(sample + 127);
+			} else if (bit_res == 16) {
+				int16_t out = (int16_t)sample;
+				memcpy(data, &out, 2);
+			} else {
+				int32_t out = (int32_t)sample;
+				memcpy(data, &out, 4);
+			}
+
+			data += bytes;
+		}
+	}
+
+	stream->write(buffer.data(), buffer.size());
+	PROFILE_COUNT(COUNTER_BYTES_WRITTEN, buffer.size());
+	frames_written += block.get_frames();
+	add_overview(block);
+}
+
+void WavWriter::end() {
+	// fix up the size fields if the length was not known up front
+	if (declared_frames != (long)frames_written && header_pos >= 0) {
+		const long samples_bytes = frames_written * num_channels * (bit_res / 8);
+		const streampos end_pos = stream->tellp();
+
+		stream->seekp(header_pos + (streamoff)4);
+		write_integer((4) + (24) + (samples_bytes + 8), 32, *stream);
+		stream->seekp(header_pos + (streamoff)40);
+		write_integer(samples_bytes, 32, *stream);
+		stream->seekp(end_pos);
+	}
+
+	stream->flush();
+	end_overview();
+}
+
+void WavWriter::write_header(ostream &os, size_t SampleRate, size_t BitRes,
+		size_t NumChannels, long samples_bytes) {
 	const char * header = "RIFF";
 	const char * wave = "WAVE";
 	os.write(header, 4);
@@ -15,26 +92,21 @@ void WavWriter::write_file(AudioFile &file, ostream &os) {
 
 	// write the format chunk (24 bytes total)
 	const char * fmt = "fmt ";
-	size_t byte_rate = file.get_sample_rate() * file.get_num_channels() * file.get_bit_res();
-	size_t block_align = file.get_num_channels() * file.get_bit_res();
+	size_t byte_rate = SampleRate * NumChannels * BitRes;
+	size_t block_align = NumChannels * BitRes;
 	os.write(fmt, 4);
 	write_integer(16, 32, os); // remaining bytes in chunk
 	write_integer(1, 16, os); // AudioFormat
-	write_integer(file.get_num_channels(), 16, os); // NumChannels
-	write_integer(file.get_sample_rate(), 32, os); // SampleRate
+	write_integer(NumChannels, 16, os); // NumChannels
+	write_integer(SampleRate, 32, os); // SampleRate
 	write_integer(byte_rate, 32, os); // ByteRate
 	write_integer(block_align, 16, os); // BlockAlign
-	write_integer(file.get_bit_res(), 16, os); // BitDepth
+	write_integer(BitRes, 16, os); // BitDepth
 
-	// finally write all the data (samples_bytes + 8 bytes total)
+	// the data chunk header, the samples follow (samples_bytes + 8 bytes total)
 	const char * data = "data";
 	os.write(data, 4);
 	write_integer(samples_bytes, 32, os); // remaining bytes in chunk
-	for (size_t i = 0; i < file.get_num_samples(); i++) {
-		for (size_t c = 0; c < file.get_num_channels(); c++) {
-			write_integer(file[c][i], file.get_bit_res(), os);
-		}
-	}
 }
 
 void WavWriter::write_integer(long data, size_t bits, ostream &os) {
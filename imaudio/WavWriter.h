@@ -2,13 +2,36 @@
 #define WAVWRITER_H
 
 #include "iFileWriter.h"
+#include "iBlockWriter.h"
 
-class WavWriter : public iFileWriter {
+/**
+ * Implements iFileWriter to output the .wav file format,
+ * and iBlockWriter to stream the same format block by block.
+ */
+class WavWriter : public iFileWriter, public iBlockWriter {
 public:
+	WavWriter() : stream{nullptr}, bit_res{0}, num_channels{0}, frames_written{0}, header_pos{-1} { }
+
 	void write_file(AudioFile &file, string filename) { iFileWriter::write_file(file, filename); }
 	virtual void write_file(AudioFile &file, ostream &os);
 
+	/**
+	 * When NumSamples is unknown, the size fields of the header are
+	 * written as 0 and fixed up by end(), provided the stream is seekable.
+	 */
+	virtual void begin(ostream &os, size_t SampleRate, size_t BitRes,
+			size_t NumChannels, long NumSamples = -1);
+	virtual void write_block(const SampleBlock &block);
+	virtual void end();
+
 private:
+	/**
+	 * Writes the RIFF header, the format chunk, and the header of the data chunk.
+	 * \param samples_bytes Number of bytes that will follow in the data chunk.
+	 */
+	void write_header(ostream &os, size_t SampleRate, size_t BitRes,
+			size_t NumChannels, long samples_bytes);
+
 	/**
 	 * Writes 'data' to the output stream 'os' such that it fits within the 'bits' size.
 	 * \param data Data to write to the file.
@@ -16,6 +39,14 @@ private:
 	 * \param os Ouput stream to write to.
 	 */
 	void write_integer(long data, size_t bits, ostream &os);
+
+	ostream *stream; /**< Stream given to begin(...). */
+	size_t bit_res; /**< Bit resolution given to begin(...). */
+	size_t num_channels; /**< Number of channels given to begin(...). */
+	size_t frames_written; /**< Frames written since begin(...). */
+	long declared_frames; /**< NumSamples given to begin(...). */
+	streamoff header_pos; /**< Position of the header in the stream, -1 if not seekable. */
+	vector<char> buffer; /**< Raw bytes of the block being encoded. */
 };
 
 #endif
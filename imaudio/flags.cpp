@@ -1,3 +1,9 @@
 #include "flags.h"
 
 bool strict_data = true;
+bool write_overviews = false;
+bool use_buffer_pool = true;
+bool async_io = true;
+bool profiling = false;
+OverflowPolicy overflow_policy = OVERFLOW_THROW;
+std::atomic<unsigned long> clipped_samples(0);
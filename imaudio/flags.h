@@ -1,9 +1,89 @@
 #ifndef FLAGS_H
 #define FLAGS_H
 
+#include <atomic>
+
 #define MIN_BIT_RES 8
 #define MAX_BIT_RES 32
 
+// number of samples processed at a time by block based operations
+#define RENDER_BLOCK_SIZE 1024
+
+// number of samples rendered by a single task when rendering in parallel
+#define RENDER_TASK_SIZE (64 * RENDER_BLOCK_SIZE)
+
+// number of frames moved at a time by streaming readers and writers
+#define STREAM_BLOCK_SIZE 4096
+
+// number of frames the limiter looks ahead to reduce the gain before a peak
+#define LIMITER_LOOKAHEAD 64
+
+// number of frames summarized by each block of the finest level of an Overview
+#define OVERVIEW_BLOCK_SIZE 256
+
+// number of lines of data between two entries of the line index of a .cs229 file
+#define CS229_INDEX_INTERVAL 1024
+
+// smallest chunk Channel::push_sample(...) starts once the last chunk is full
+#define CHANNEL_CHUNK_SIZE 4096
+
+// number of blocks in flight between two stages of a Pipeline (see BlockQueue)
+#define PIPELINE_QUEUE_BLOCKS 4
+
+// size of the cache lines kept apart by lock-free structures (see BlockRing)
+#define CACHE_LINE_SIZE 64
+
+// number of times a BlockRing is checked before its waiting side sleeps (or yields)
+#define RING_SPIN_TRIES 1024
+
+// size of each of the two buffers a file is read ahead (or written behind) with (see AsyncFile.h)
+#define IO_BUFFER_SIZE (1 << 20)
+
+// bytes of buffers the open files may hold at once, files opened past it get smaller buffers
+#define IO_BUFFER_BUDGET (16 << 20)
+
+// smallest size the buffers of a file are shrunk to by that budget
+#define IO_BUFFER_MIN (64 << 10)
+
+// number of threads making the reads and writes of every open file
+#define IO_THREADS 2
+
+// alignment of those buffers, a page, so the kernel can copy whole pages
+#define IO_BUFFER_ALIGN 4096
+
+// number of events each thread keeps in its ring buffer while tracing (see Trace.h)
+#define TRACE_BUFFER_EVENTS 65536
+
+// number of bytes of freed sample buffers each thread keeps for reuse (see BufferPool)
+#define BUFFER_POOL_MAX_CACHED (64 << 20)
+
 extern bool strict_data;
 
+// whether writers should also save an Overview sidecar next to the files they write
+extern bool write_overviews;
+
+// whether freed sample buffers are kept for reuse by BufferPool
+extern bool use_buffer_pool;
+
+// whether files are read ahead and written behind by the I/O threads (see AsyncFile.h)
+extern bool async_io;
+
+// whether the timers and counters of Profile.h are recorded
+extern bool profiling;
+
+/**
+ * What the arithmetic operators and the mixer do with
+ * results that leave their bit resolution.
+ */
+enum OverflowPolicy {
+	OVERFLOW_THROW, /**< Throw an overflow_error (default). */
+	OVERFLOW_SATURATE, /**< Clip the sample to the closest valid value. */
+	OVERFLOW_LIMIT /**< Smoothly reduce the gain around peaks with a look-ahead limiter. */
+};
+
+extern OverflowPolicy overflow_policy;
+
+// number of samples that left their bit resolution and were clipped or limited
+extern std::atomic<unsigned long> clipped_samples;
+
 #endif
@@ -28,30 +28,12 @@ AdsrEnvelope::AdsrEnvelope(double Attack, double Decay, double Sustain, double R
 	// otherwise we are good, continue as normal
 }
 
-double AdsrEnvelope::sample_at_time(double time) {
-	if (time < 0.0 || time > length) {
-		return 0.0;
-	}
-
-	if (time < a) {
-		return max((1.0 / a) * time, 0.0);
-	}
-
-	if (time < a + d) {
-		auto slope = (1.0 - s) / d;
-		auto t = (time - a);
-		return max(1.0 - (slope * t), 0.0);
-	}
-
-	if (time < length - r) {
-		return s;
-	}
-
-	if (time < length) {
-		auto slope = s / r;
-		auto t = time - (length - r);
-		return max(s - (slope * t), 0.0);
+void AdsrEnvelope::sample_block(size_t first_sample, double SampleRate, double *out, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		out[i] = sample((first_sample + i) / SampleRate);
 	}
+}
 
-	return 0.0;
+double AdsrEnvelope::sample_at_time(double time) {
+	return sample(time);
 }
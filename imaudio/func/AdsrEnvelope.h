@@ -1,8 +1,11 @@
 #ifndef ASDRENVELOPE_H
 #define ASDRENVELOPE_H
 
+#include <algorithm>
 #include "iFunction.h"
 
+using namespace std;
+
 class AdsrEnvelope : public iFunction {
 public:
 	/**
@@ -16,6 +19,38 @@ public:
 	AdsrEnvelope(double Attack, double Decay, double Sustain, double Release, double Length);
 
 	virtual double sample_at_time(double time);
+	virtual void sample_block(size_t first_sample, double SampleRate, double *out, size_t count);
+
+	/**
+	 * Non virtual version of sample_at_time(...), used by the block renderers.
+	 */
+	inline double sample(double time) const {
+		if (time < 0.0 || time > length) {
+			return 0.0;
+		}
+
+		if (time < a) {
+			return max((1.0 / a) * time, 0.0);
+		}
+
+		if (time < a + d) {
+			auto slope = (1.0 - s) / d;
+			auto t = (time - a);
+			return max(1.0 - (slope * t), 0.0);
+		}
+
+		if (time < length - r) {
+			return s;
+		}
+
+		if (time < length) {
+			auto slope = s / r;
+			auto t = time - (length - r);
+			return max(s - (slope * t), 0.0);
+		}
+
+		return 0.0;
+	}
 
 	/**
 	 * \return The current length (in seconds) of this adsr envelope.
@@ -0,0 +1,38 @@
+#include "BlockRenderer.h"
+#include "SinWave.h"
+#include "TriangleWave.h"
+#include "SawToothWave.h"
+#include "PulseWave.h"
+
+/**
+ * Selects the envelope instantiation for a known waveform type.
+ */
+template <class Wave>
+static void render_with_envelope(const Wave &wave, const AdsrEnvelope *env, double gain,
+		size_t first_sample, double SampleRate, double *out, size_t count) {
+	if (env) {
+		render_block(wave, *env, gain, first_sample, SampleRate, out, count);
+	} else {
+		render_block(wave, NoEnvelope(), gain, first_sample, SampleRate, out, count);
+	}
+}
+
+void render_waveform_block(iWaveform &wave, const AdsrEnvelope *env, double gain,
+		size_t first_sample, double SampleRate, double *out, size_t count) {
+	if (auto sin_wave = dynamic_cast<SinWave *>(&wave)) {
+		render_with_envelope(*sin_wave, env, gain, first_sample, SampleRate, out, count);
+	} else if (auto triangle_wave = dynamic_cast<TriangleWave *>(&wave)) {
+		render_with_envelope(*triangle_wave, env, gain, first_sample, SampleRate, out, count);
+	} else if (auto sawtooth_wave = dynamic_cast<SawToothWave *>(&wave)) {
+		render_with_envelope(*sawtooth_wave, env, gain, first_sample, SampleRate, out, count);
+	} else if (auto pulse_wave = dynamic_cast<PulseWave *>(&wave)) {
+		render_with_envelope(*pulse_wave, env, gain, first_sample, SampleRate, out, count);
+	} else {
+		// not a waveform we know about, use the virtual interface
+		for (size_t i = 0; i < count; i++) {
+			const double time = (first_sample + i) / SampleRate;
+			const double adsr = env ? env->sample(time) : 1.0;
+			out[i] = gain * wave.sample_at_time(time) * adsr;
+		}
+	}
+}
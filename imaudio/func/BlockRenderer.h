@@ -0,0 +1,58 @@
+#ifndef BLOCKRENDERER_H
+#define BLOCKRENDERER_H
+
+#include <stddef.h>
+
+#include "iWaveform.h"
+#include "AdsrEnvelope.h"
+
+/**
+ * Envelope that leaves every sample unchanged, used when a
+ * waveform is rendered without an AdsrEnvelope.
+ */
+struct NoEnvelope {
+	inline double sample(double time) const {
+		return 1.0;
+	}
+};
+
+/**
+ * Renders a block of 'gain * wave(t) * env(t)' where sample 'i' of the block
+ * is taken at time (first_sample + i) / SampleRate.
+ * Wave and Envelope are concrete types (SinWave, AdsrEnvelope, NoEnvelope, ...)
+ * providing a non virtual 'sample(double time) const', so the compiler is
+ * free to inline both into the loop and vectorize it.
+ * \param wave Waveform to sample.
+ * \param env Envelope to apply to each sample.
+ * \param gain Constant scalar applied to each sample.
+ * \param first_sample Index of the first sample of the block.
+ * \param SampleRate Number of samples per second.
+ * \param out Array of at least 'count' values to store the samples in.
+ * \param count Number of samples in the block.
+ */
+template <class Wave, class Envelope>
+inline void render_block(const Wave &wave, const Envelope &env, double gain,
+		size_t first_sample, double SampleRate, double *out, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		const double time = (first_sample + i) / SampleRate;
+		out[i] = gain * wave.sample(time) * env.sample(time);
+	}
+}
+
+/**
+ * Runtime entry point for render_block(...). The concrete type of 'wave' is
+ * determined once for the whole block, and the matching instantiation
+ * (one exists for every waveform and envelope combination) is called.
+ * Unknown iWaveform subclasses fall back to sample_at_time(...).
+ * \param wave Waveform to sample.
+ * \param env Envelope to apply to each sample, or nullptr for none.
+ * \param gain Constant scalar applied to each sample.
+ * \param first_sample Index of the first sample of the block.
+ * \param SampleRate Number of samples per second.
+ * \param out Array of at least 'count' values to store the samples in.
+ * \param count Number of samples in the block.
+ */
+void render_waveform_block(iWaveform &wave, const AdsrEnvelope *env, double gain,
+		size_t first_sample, double SampleRate, double *out, size_t count);
+
+#endif
@@ -9,6 +9,25 @@ public:
 		iWaveform(Amplitude, Frequency), pulse_ratio{PulseRatio} { }
 
 	virtual double sample_at_time(double time);
+	virtual void sample_block(size_t first_sample, double SampleRate, double *out, size_t count);
+
+	/**
+	 * Non virtual version of sample_at_time(...), used by the block renderers.
+	 */
+	inline double sample(double time) const {
+		time = time * frequency; // adjust time to frequency
+		time = time - (int)time; // remap to range [0, 1)
+
+		// time may be 0 but may never be 1, therefore 
+		// I am using an exclusive comparison
+		// (ie. if pulse_ratio = 0.5, an equal number of possible
+		// instances will be 'up' as will be 'down')
+		if (time < pulse_ratio) {
+			return amplitude;
+		} else {
+			return -amplitude;
+		}
+	}
 
 	inline virtual string function_name() {
 		return "pulsewave";
@@ -1,10 +1,10 @@
-#include <math.h>
 #include "SawToothWave.h"
+#include "BlockRenderer.h"
 
 double SawToothWave::sample_at_time(double time) {
-	double slope = 2 * iWaveform::amplitude;
-	time = time * iWaveform::frequency; // adjust time to frequency
-	time = time - (int)time; // remap to range [0, 1)
-	
-	return -iWaveform::amplitude + slope * time;
+	return sample(time);
+}
+
+void SawToothWave::sample_block(size_t first_sample, double SampleRate, double *out, size_t count) {
+	render_block(*this, NoEnvelope(), 1.0, first_sample, SampleRate, out, count);
 }
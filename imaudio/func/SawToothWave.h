@@ -8,6 +8,18 @@ public:
 	SawToothWave(double Amplitude, double Frequency) : iWaveform(Amplitude, Frequency) { }
 
 	virtual double sample_at_time(double time);
+	virtual void sample_block(size_t first_sample, double SampleRate, double *out, size_t count);
+
+	/**
+	 * Non virtual version of sample_at_time(...), used by the block renderers.
+	 */
+	inline double sample(double time) const {
+		double slope = 2 * amplitude;
+		time = time * frequency; // adjust time to frequency
+		time = time - (int)time; // remap to range [0, 1)
+
+		return -amplitude + slope * time;
+	}
 
 	inline virtual string function_name() {
 		return "sawtoothwave";
@@ -1,7 +1,10 @@
-#include <math.h>
 #include "SinWave.h"
+#include "BlockRenderer.h"
 
 double SinWave::sample_at_time(double time) {
-	time = (time * 2 * M_PI) * iWaveform::frequency;
-	return sin(time) * iWaveform::amplitude;
+	return sample(time);
+}
+
+void SinWave::sample_block(size_t first_sample, double SampleRate, double *out, size_t count) {
+	render_block(*this, NoEnvelope(), 1.0, first_sample, SampleRate, out, count);
 }
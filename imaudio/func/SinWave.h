@@ -1,6 +1,7 @@
 #ifndef SINWAVE_H
 #define SINWAVE_H
 
+#include <math.h>
 #include "iWaveform.h"
 
 class SinWave : public iWaveform {
@@ -8,6 +9,15 @@ public:
 	SinWave(double Amplitude, double Frequency) : iWaveform(Amplitude, Frequency) { }
 
 	virtual double sample_at_time(double time);
+	virtual void sample_block(size_t first_sample, double SampleRate, double *out, size_t count);
+
+	/**
+	 * Non virtual version of sample_at_time(...), used by the block renderers.
+	 */
+	inline double sample(double time) const {
+		time = (time * 2 * M_PI) * frequency;
+		return sin(time) * amplitude;
+	}
 
 	inline virtual string function_name() {
 		return "sinwave";
@@ -1,14 +1,10 @@
-#include <math.h>
 #include "TriangleWave.h"
+#include "BlockRenderer.h"
 
 double TriangleWave::sample_at_time(double time) {
-	double slope = 2 * iWaveform::amplitude / 0.5;
-	time = time * iWaveform::frequency; // adjust time to frequency
-	time = time - (int)time; // remap to range [0, 1)
+	return sample(time);
+}
 
-	if (time < 0.5) {
-		return -iWaveform::amplitude + slope * time;
-	} else {
-		return iWaveform::amplitude - slope * (time - 0.5);
-	}
+void TriangleWave::sample_block(size_t first_sample, double SampleRate, double *out, size_t count) {
+	render_block(*this, NoEnvelope(), 1.0, first_sample, SampleRate, out, count);
 }
@@ -0,0 +1,51 @@
+#include <math.h>
+#include <algorithm>
+
+#include "iFunction.h"
+#include "../ThreadPool.h"
+#include "../Trace.h"
+
+AudioFile iFunction::generate_audio_file(size_t SampleRate, double Length, size_t BitRes, bool FloatFormat) {
+	AudioFile f = AudioFile(function_name(), "iFunction", SampleRate, BitRes, 1, FloatFormat);
+	const size_t sample_count = Length > 0.0 ? (size_t)ceil(Length * SampleRate) : 0;
+	const size_t chunk_count = (sample_count + RENDER_TASK_SIZE - 1) / RENDER_TASK_SIZE;
+
+	Channel &channel = f[0];
+	channel.resize(sample_count);
+	long * data = FloatFormat ? nullptr : channel.data();
+	double * float_data = FloatFormat ? channel.float_data() : nullptr;
+
+	// every chunk writes to its own range of the channel, so no locking is needed
+	auto generate_chunk = [&](size_t chunk) {
+		TRACE_SCOPE("render_chunk");
+		double block[RENDER_BLOCK_SIZE];
+		const size_t end = min(sample_count, (chunk + 1) * RENDER_TASK_SIZE);
+
+		for (size_t start = chunk * RENDER_TASK_SIZE; start < end; start += RENDER_BLOCK_SIZE) {
+			const size_t count = min((size_t)RENDER_BLOCK_SIZE, end - start);
+			sample_block(start, SampleRate, block, count);
+
+			for (size_t i = 0; i < count; i++) {
+				if (FloatFormat) {
+					float_data[start + i] = block[i];
+				} else {
+					// samples are truncated, as push_sample(...) would
+					const long val = block[i];
+					if (!channel.is_valid_sample(val)) {
+						throw overflow_error("Sample exceeds this Channels bit resolution!");
+					}
+
+					data[start + i] = val;
+				}
+			}
+		}
+	};
+
+	if (chunk_count > 1) {
+		ThreadPool::shared().parallel_for(chunk_count, generate_chunk);
+	} else if (chunk_count == 1) {
+		generate_chunk(0);
+	}
+
+	return f;
+}
@@ -25,6 +25,22 @@ public:
 	 */
 	virtual double sample_at_time(double time) = 0;
 
+	/**
+	 * Evaluates this function for a block of consecutive samples, where
+	 * sample 'i' of the block is taken at time (first_sample + i) / SampleRate.
+	 * The default implementation calls sample_at_time(...) for each sample,
+	 * subclasses may override this to avoid a virtual call per sample.
+	 * \param first_sample Index of the first sample of the block.
+	 * \param SampleRate Number of samples per second.
+	 * \param out Array of at least 'count' values to store the samples in.
+	 * \param count Number of samples in the block.
+	 */
+	virtual void sample_block(size_t first_sample, double SampleRate, double *out, size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			out[i] = sample_at_time((first_sample + i) / SampleRate);
+		}
+	}
+
 	/**
 	 * The name of this function to use for the generated audio file.
 	 */
@@ -36,22 +52,18 @@ public:
 	 * have one channel representing this function and will have
 	 * samples from time 0 to time length as given by
 	 * sample_at_time(...) for parameter in increments of 1.0 / SampleRate.
+	 * Functions are expected to be pure in time, so the sample range is
+	 * split into independent chunks that are generated in parallel on
+	 * ThreadPool::shared(), each writing straight into the preallocated
+	 * channel. The output does not depend on the number of threads.
 	 * \param SampleRate Number of samples per second to take of this function.
 	 * \param Length Length (in seconds) of the output AudioFile.
 	 * \param BitRes Bit resolution to use in the generated AudioFile.
+	 * \param FloatFormat If true the samples are left unquantized (see Channel).
 	 * \return Discrete AudioFile representing this function.
 	 */
-	AudioFile generate_audio_file(size_t SampleRate, double Length, size_t BitRes) {
-		AudioFile f = AudioFile(function_name(), "iFunction", SampleRate, BitRes, 1);
-		auto sample_count = Length * SampleRate;
-
-		for (auto i = 0; i < sample_count; i++) {
-			auto time = i / (double)SampleRate;
-			f[0].push_sample(sample_at_time(time));
-		}
-
-		return f;
-	}
+	AudioFile generate_audio_file(size_t SampleRate, double Length, size_t BitRes,
+			bool FloatFormat = false);
 
 	/**
 	 * Multiplies the values of this continuous function with 
@@ -67,6 +79,17 @@ public:
 		for (auto c = 0; c < (int)last.get_num_channels(); c++) {
 			Channel &channel = last[c];
 
+			// floating point channels are scaled without truncation
+			if (channel.is_float()) {
+				double * data = channel.float_data();
+				for (auto i = 0; i < (int)channel.size(); i++) {
+					auto time = i / (double)last.get_sample_rate();
+					data[i] *= sample_at_time(time);
+				}
+
+				continue;
+			}
+
 			// multiply each sample by the func at the given time
 			for (auto i = 0; i < (int)channel.size(); i++) {
 				auto time = i / (double)last.get_sample_rate();
@@ -24,6 +24,15 @@ public:
 
 	virtual ~iWaveform() { }
 
+	/**
+	 * Changes the frequency of this waveform, allowing a single
+	 * waveform to be reused for a series of notes.
+	 * \param Frequency The new number of repetitions per second.
+	 */
+	inline void set_frequency(double Frequency) {
+		frequency = Frequency;
+	}
+
 protected:
 	/**
 	 * The amplitude of the waveform. This value is half the total height 
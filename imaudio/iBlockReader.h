@@ -0,0 +1,325 @@
+#ifndef I_BLOCK_READER_H
+#define I_BLOCK_READER_H
+
+#include <iostream>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+#include <string.h>
+
+#include "SampleBlock.h"
+#include "AudioFile.h"
+#include "AsyncFile.h"
+#include "Profile.h"
+#include "flags.h"
+
+using namespace std;
+
+/**
+ * Interface for reading a file format as a stream of SampleBlocks,
+ * instead of reading the whole file into an AudioFile.
+ * open(...) reads only the header, after which the format of the
+ * data is available through the getters, and read_block(...) is then
+ * called repeatedly to decode the sample data in order.
+ * set_range(...) restricts the stream to a range of frames, which
+ * subclasses reach without decoding the frames before it when they can.
+ */
+class iBlockReader {
+public:
+	iBlockReader() : stream{nullptr}, sample_rate{0}, bit_res{0}, num_channels{0}, num_samples{-1}, range_left{-1}, range_start{0} { }
+	virtual ~iBlockReader() { }
+
+	/**
+	 * Opens the given file, which is kept open by this reader, and reads its header.
+	 * The file is read ahead on another thread while it is decoded (see AsyncFile.h).
+	 * \param filename Input filename to stream samples from.
+	 */
+	void open(string filename) {
+		file.reset(new AsyncIfstream(filename));
+		if (!file->is_open()) {
+			throw invalid_argument("Failed to open file for reading.");
+		}
+
+		range_left = -1;
+		range_start = 0;
+		open(*file, filename);
+	}
+
+	/**
+	 * Opens a file given as "name", "name@start" or "name@start:length", and
+	 * restricts the stream to that range (see set_range(...)). The start and the
+	 * length are numbers of frames, or of seconds when followed by an 's'.
+	 * A name whose last '@' is not followed by a valid range is opened as is.
+	 * \param spec The name of the file, optionally followed by a range.
+	 */
+	void open_range(string spec) {
+		const size_t at = spec.rfind('@');
+		string start, length;
+		if (at == string::npos || !split_range(spec.substr(at + 1), start, length)) {
+			open(spec);
+			return;
+		}
+
+		open(spec.substr(0, at));
+		set_range(to_frames(start), length.empty() ? -1 : (long)to_frames(length));
+	}
+
+	/**
+	 * Restricts the rest of the stream to 'count' frames, starting 'start'
+	 * frames after the current position, which is usually the first frame.
+	 * The frames before the range are skipped through skip_frames(...), and
+	 * get_num_samples() is updated to the length of the range when it is known.
+	 * A range starting at or past the last frame, or ending past it, throws an
+	 * out_of_range exception, here when the header gives the number of frames,
+	 * otherwise from read_block(...) once the data runs out.
+	 * \param start Number of frames to skip.
+	 * \param count Number of frames to read after them, -1 to read to the end.
+	 */
+	void set_range(size_t start, long count = -1) {
+		const size_t skipped = skip_frames(start);
+		if (skipped < start || (start > 0 && num_samples >= 0 && num_samples <= (long)start)) {
+			throw out_of_range(file_name + ": the range starts past the last frame.");
+		} else if (count >= 0 && num_samples >= 0 && num_samples - (long)start < count) {
+			throw out_of_range(file_name + ": the range ends past the last frame.");
+		}
+
+		if (num_samples >= 0) {
+			num_samples = count < 0 ? num_samples - start : count;
+		}
+
+		range_left = count;
+		range_start = count == 0 ? 0 : start;
+	}
+
+	/**
+	 * Reads 'count' frames of a file starting at frame 'start' into an AudioFile,
+	 * without decoding the rest of the file when the format allows it.
+	 * \param filename Input filename to read the range from.
+	 * \param start First frame of the range.
+	 * \param count Number of frames in the range, -1 to read to the end of the file.
+	 * \return The frames of the range, set_range(...) throws if the file ends first.
+	 */
+	AudioFile read_range(string filename, size_t start, long count = -1) {
+		open(filename);
+		set_range(start, count);
+		return read_rest();
+	}
+
+	/**
+	 * Reads every frame left in the stream (or in its range) into an AudioFile,
+	 * for callers who opened the reader themselves.
+	 * \return The frames read, named after the file being read.
+	 */
+	AudioFile read_rest() {
+		AudioFile ret = AudioFile(file_name, get_extension(), sample_rate, bit_res, num_channels);
+		if (num_samples >= 0) {
+			ret.reserve(num_samples);
+		}
+
+		SampleBlock block = SampleBlock(num_channels, STREAM_BLOCK_SIZE);
+		size_t frames = 0;
+		size_t read = 0;
+		while ((read = read_block(block)) > 0) {
+			for (size_t c = 0; c < num_channels; c++) {
+				ret[c].resize(frames + read);
+				memcpy(ret[c].data() + frames, block.channel(c), read * sizeof(long));
+			}
+
+			frames += read;
+		}
+
+		return ret;
+	}
+
+	/**
+	 * Reads the header of the file format defined by the subclass from the input stream.
+	 * The stream must remain valid until the last call to read_block(...).
+	 * \param is Input stream to read samples from.
+	 * \param filename The name of the file we are reading from ("std::cin" by default).
+	 */
+	virtual void open(istream &is, string filename = "std::cin") = 0;
+
+	/**
+	 * Decodes the next frames of the stream into the input block.
+	 * Blocks are always filled to capacity, unless the end of the data
+	 * (or of the range given to set_range(...)) is reached.
+	 * The block must have the same number of channels as this reader.
+	 * \param block Block to store the decoded frames in.
+	 * \return The number of frames read, 0 once all data has been read.
+	 */
+	size_t read_block(SampleBlock &block) {
+		PROFILE_SCOPE(TIMER_READ_BLOCK);
+		size_t frames = 0;
+		if (range_left < 0) {
+			frames = read_frames(block, block.get_capacity());
+		} else {
+			const size_t wanted = min(block.get_capacity(), (size_t)range_left);
+			frames = range_left ? read_frames(block, wanted) : 0;
+			block.set_frames(frames);
+			range_left -= frames;
+			if (frames < wanted) {
+				throw out_of_range(file_name + ": the range ends past the last frame.");
+			}
+		}
+
+		// a range of a file without a frame count is only known to be empty once read
+		if (frames) {
+			range_start = 0;
+		} else if (range_start) {
+			throw out_of_range(file_name + ": the range starts past the last frame.");
+		}
+
+		PROFILE_COUNT(COUNTER_SAMPLES_PARSED, frames * num_channels);
+		return frames;
+	}
+
+	/**
+	 * Determines the number of frames in the stream without keeping any of them.
+	 * When the header declares the number of frames it is returned directly,
+	 * otherwise the remaining data is read through read_block(...).
+	 * Subclasses should override this with a faster way to count frames
+	 * if their format has one. The stream is left at an unspecified position.
+	 * \return The number of frames in the stream.
+	 */
+	virtual long count_frames() {
+		if (num_samples >= 0) {
+			return num_samples;
+		}
+
+		SampleBlock block = SampleBlock(num_channels, STREAM_BLOCK_SIZE);
+		long frames = 0;
+		size_t read = 0;
+		while ((read = read_block(block)) > 0) {
+			frames += read;
+		}
+
+		return frames;
+	}
+
+	/**
+	 * Moves past the next frames of the stream without returning them.
+	 * By default the frames are decoded and dropped, subclasses
+	 * that can find a frame without decoding should seek past them instead.
+	 * \param frames Number of frames to skip.
+	 * \return The number of frames skipped, less than 'frames' if the data ended first.
+	 */
+	virtual size_t skip_frames(size_t frames) {
+		SampleBlock block = SampleBlock(num_channels, min((size_t)STREAM_BLOCK_SIZE, frames));
+		size_t skipped = 0;
+		while (skipped < frames) {
+			// never read past the last frame to skip
+			const size_t read = read_frames(block, min(block.get_capacity(), frames - skipped));
+			if (read == 0) {
+				break;
+			}
+
+			skipped += read;
+		}
+
+		return skipped;
+	}
+
+	/**
+	 * \return The number of samples per second of the open stream.
+	 */
+	inline size_t get_sample_rate() const {
+		return sample_rate;
+	}
+
+	/**
+	 * \return The number of bits per sample of the open stream.
+	 */
+	inline size_t get_bit_res() const {
+		return bit_res;
+	}
+
+	/**
+	 * \return The number of channels of the open stream.
+	 */
+	inline size_t get_num_channels() const {
+		return num_channels;
+	}
+
+	/**
+	 * \return The number of frames declared by the header, or -1 if it is unknown.
+	 */
+	inline long get_num_samples() const {
+		return num_samples;
+	}
+
+	/**
+	 * \return The name of the file being read.
+	 */
+	inline string get_file_name() const {
+		return file_name;
+	}
+
+	/**
+	 * \return The extension of the format read by the subclass (".wav" for example).
+	 */
+	virtual string get_extension() const = 0;
+
+protected:
+	/**
+	 * Decodes up to 'max_frames' of the next frames of the stream into the input block,
+	 * stopping early only at the end of the data. Implemented by each format.
+	 * \param block Block to store the decoded frames in, with room for 'max_frames'.
+	 * \param max_frames Maximum number of frames to decode.
+	 * \return The number of frames read, also set as the frames of the block.
+	 */
+	virtual size_t read_frames(SampleBlock &block, size_t max_frames) = 0;
+
+	/**
+	 * Converts a frame count written for open_range(...) to a number of frames.
+	 * \param value A number of frames, or of seconds when followed by an 's'.
+	 * \return The number of frames.
+	 */
+	size_t to_frames(const string &value) const {
+		if (value.back() == 's') {
+			return (size_t)(stod(value.substr(0, value.length() - 1)) * sample_rate + 0.5);
+		}
+
+		return (size_t)stoul(value);
+	}
+
+	/**
+	 * Splits the "start[:length]" part of a spec given to open_range(...).
+	 * \param range Text following the '@'.
+	 * \param start Set to the start of the range.
+	 * \param length Set to the length of the range, empty if there is none.
+	 * \return Whether or not the text was a valid range.
+	 */
+	static bool split_range(const string &range, string &start, string &length) {
+		const size_t colon = range.find(':');
+		start = range.substr(0, colon);
+		length = colon == string::npos ? "" : range.substr(colon + 1);
+		return is_range_value(start) && (colon == string::npos || is_range_value(length));
+	}
+
+	/**
+	 * \return Whether the text is a number of frames, or a (decimal) number of seconds ending in 's'.
+	 */
+	static bool is_range_value(const string &value) {
+		const bool seconds = !value.empty() && value.back() == 's';
+		const string number = seconds ? value.substr(0, value.length() - 1) : value;
+		if (number.empty() || number.find_first_not_of(seconds ? "0123456789." : "0123456789") != string::npos) {
+			return false;
+		}
+
+		return count(number.begin(), number.end(), '.') <= 1 && number != ".";
+	}
+
+	unique_ptr<AsyncIfstream> file; /**< File opened by open(string), if any. */
+	istream *stream; /**< Stream the sample data is read from. */
+	string file_name; /**< Name of the file being read. */
+	size_t sample_rate; /**< Sample rate read from the header. */
+	size_t bit_res; /**< Bit resolution read from the header. */
+	size_t num_channels; /**< Number of channels read from the header. */
+	long num_samples; /**< Number of frames declared by the header, -1 if unknown. */
+	long range_left; /**< Frames left in the range given to set_range(...), -1 without a range. */
+	size_t range_start; /**< Start of the range given to set_range(...), 0 once a frame of it was read. */
+};
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef I_BLOCK_WRITER_H
+#define I_BLOCK_WRITER_H
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "SampleBlock.h"
+#include "Overview.h"
+
+using namespace std;
+
+/**
+ * Interface for writing a file format from a stream of SampleBlocks,
+ * without ever holding the whole file in memory.
+ * begin(...) writes the header, write_block(...) is then called for each
+ * block of data in order, and end() finishes the file.
+ */
+class iBlockWriter {
+public:
+	virtual ~iBlockWriter() { }
+
+	/**
+	 * Writes the header of the file format defined by the subclass.
+	 * The stream must remain valid until end() is called.
+	 * \param os Output stream to write data to.
+	 * \param SampleRate Number of samples per second.
+	 * \param BitRes Number of bits per sample.
+	 * \param NumChannels Number of channels in each block.
+	 * \param NumSamples Number of frames that will be written, or -1 if unknown.
+	 */
+	virtual void begin(ostream &os, size_t SampleRate, size_t BitRes,
+			size_t NumChannels, long NumSamples = -1) = 0;
+
+	/**
+	 * Writes every valid frame of the input block.
+	 * \param block Block of samples to write.
+	 */
+	virtual void write_block(const SampleBlock &block) = 0;
+
+	/**
+	 * Finishes the file, once all blocks have been written.
+	 */
+	virtual void end() = 0;
+
+	/**
+	 * Asks the writer to also build an Overview of the blocks it writes,
+	 * which is saved to the given file by end(). Must be called before begin(...).
+	 * \param filename Name of the sidecar file, usually Overview::sidecar_name(...).
+	 */
+	void set_overview_file(string filename) {
+		overview_file = filename;
+	}
+
+protected:
+	/**
+	 * Starts a new Overview if set_overview_file(...) was called,
+	 * subclasses call this from begin(...).
+	 */
+	void begin_overview(size_t SampleRate, size_t BitRes, size_t NumChannels) {
+		if (!overview_file.empty()) {
+			overview.reset(new Overview(NumChannels, BitRes, SampleRate));
+		}
+	}
+
+	/**
+	 * Adds a block to the Overview, subclasses call this from write_block(...).
+	 */
+	void add_overview(const SampleBlock &block) {
+		if (overview) {
+			overview->add_block(block);
+		}
+	}
+
+	/**
+	 * Saves the Overview to its sidecar, subclasses call this from end().
+	 */
+	void end_overview() {
+		if (overview) {
+			overview->save(overview_file);
+			overview.reset();
+		}
+	}
+
+private:
+	string overview_file; /**< Sidecar given to set_overview_file(...), empty if none. */
+	unique_ptr<Overview> overview; /**< Overview of the blocks written since begin(...). */
+};
+
+#endif
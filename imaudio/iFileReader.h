@@ -5,6 +5,8 @@
 #include <string>
 
 #include "AudioFile.h"
+#include "AsyncFile.h"
+#include "Profile.h"
 
 using namespace std;
 
@@ -25,12 +27,14 @@ public:
 	/**
 	 * This method reads data from the input file in the file format defined
 	 * by the subclass. Using that data, a new AudioFile is created, and then
-	 * returned to the caller.
+	 * returned to the caller. The file is read ahead on another thread
+	 * while it is parsed (see AsyncFile.h).
 	 * \param filename Input filename to read an AudioFile from.
 	 * \return AudioFile The AudioFile as parsed from the input file.
 	 */
 	AudioFile read_file(string filename) {
-		ifstream file(filename);
+		PROFILE_SCOPE(TIMER_READ_FILE);
+		AsyncIfstream file(filename);
 		if (!file.is_open()) {
 			throw invalid_argument(file_read_msg);
 		}
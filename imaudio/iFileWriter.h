@@ -5,6 +5,10 @@
 #include <string>
 
 #include "AudioFile.h"
+#include "AsyncFile.h"
+#include "Overview.h"
+#include "Profile.h"
+#include "flags.h"
 
 using namespace std;
 
@@ -27,22 +31,39 @@ public:
 	 * format represented by this interfaces subclasses.
 	 * That file data is then saved to a file with the input
 	 * filename. If that file already exists, it should be erased.
+	 * The data is written out on another thread while the rest
+	 * of it is formatted (see AsyncFile.h).
+	 * If 'write_overviews' is set (see flags.h) the Overview of the
+	 * file is saved next to it as well.
+	 * A floating point file is quantized before the output is opened, so
+	 * a sample leaving the bit resolution never leaves a truncated file.
 	 * \param file Input file to write to a file.
 	 * \param filename Name of the file to write data to.
 	 */
 	void write_file(AudioFile &file, string filename) {
+		PROFILE_SCOPE(TIMER_WRITE_FILE);
+		file.quantize();
+
 		// create the file, then redirect to write_file
-		ofstream output;
+		AsyncOfstream output;
 		output.open(filename);
 		write_file(file, output);
+		PROFILE_COUNT(COUNTER_BYTES_WRITTEN, output.tellp());
 		output.close();
+
+		if (write_overviews) {
+			Overview overview = Overview(file.get_num_channels(), file.get_bit_res(), file.get_sample_rate());
+			overview.add_file(file);
+			overview.save(Overview::sidecar_name(filename));
+		}
 	}
 
 	/**
 	 * This method formats the data of of the input file in the file
 	 * format represented by this interfaces subclassses.
 	 * That file data is then sent to the output stream
-	 * given as a parameter to this method.
+	 * given as a parameter to this method. A floating point file is
+	 * quantized first, nothing is written if a sample does not fit.
 	 * \param file Input file to write to the output stream.
 	 * \param os Output stream to write data to.
 	 */
@@ -3,11 +3,16 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string>
+#include <fstream>
+#include <memory>
 
 #include <CS229Reader.h>
 #include <CS229Writer.h>
 #include <WavWriter.h>
-#include <AudioFile.h>
+#include <Concatenator.h>
+#include <DeferredWriter.h>
+#include <AsyncFile.h>
+#include <Profile.h>
 #include <flags.h>
 
 using namespace std;
@@ -21,13 +26,15 @@ int main(int argc, char ** argv) {
 		{ "output", required_argument, 0, 'o' },
 		{ "wav", 0, 0, 'w' },
 		{ "nonstrict", 0, 0, 'n' },
+		{ "overview", 0, 0, 'O' },
+		{ "profile", 0, 0, 'P' },
 		{ 0, 0, 0, 0 }
 	};
 
 	char c = 0;
 	int option_index = 0;
 	const char * file_name = NULL;
-	while ((c = getopt_long(argc, argv, "hwo:n012", long_options, &option_index)) != -1) {
+	while ((c = getopt_long(argc, argv, "hwo:nO012", long_options, &option_index)) != -1) {
 		switch (c) {
 		case 'o':
 			file_name = optarg;
@@ -41,6 +48,15 @@ int main(int argc, char ** argv) {
 			strict_data = false;
 			break;
 
+		case 'O':
+			write_overviews = true;
+			break;
+
+		case 'P':
+			profiling = true;
+			Profile::print_at_exit();
+			break;
+
 		case 'h':
 			print_help();
 			return 0;
@@ -52,27 +68,46 @@ int main(int argc, char ** argv) {
 		return 1;
 	}
 
-	AudioFile output = CS229Reader().read_file(string(argv[optind]));
+	bool created = false;
+	try {
+		// inputs are validated up front, then streamed one block at a time
+		Concatenator concat([]() { return new CS229Reader(); });
+		for (auto i = optind; i < argc; i++) {
+			concat.add_input(string(argv[i]));
+		}
 
-	for (auto i = optind + 1; i < argc; i++) {
-		AudioFile add = CS229Reader().read_file(string(argv[i]));
-		output = output.concat(add);
-	}
+		unique_ptr<iBlockWriter> writer;
+		if (output_wav == 1) {
+			writer.reset(new WavWriter());
+		} else {
+			writer.reset(new CS229Writer());
+		}
 
-	iFileWriter * writer = nullptr;
-	if (output_wav == 1) {
-		writer = new WavWriter();
-	} else {
-		writer = new CS229Writer();
-	}
+		if (file_name) {
+			if (write_overviews) {
+				writer->set_overview_file(Overview::sidecar_name(file_name));
+			}
 
-	if (file_name) {
-		writer->write_file(output, file_name);
-	} else {
-		writer->write_file(output, cout);
-	}
+			AsyncOfstream output(file_name);
+			created = true;
+			concat.concat(*writer, output);
+		} else {
+			// nothing is written to the standard output before the first block was read
+			DeferredWriter deferred(writer.get());
+			concat.concat(deferred, cout);
+		}
+	} catch (const exception &e) {
+		// an input that fails once the output was started (e.g. a range past its end) leaves no broken file
+		if (created) {
+			remove(file_name);
+			if (write_overviews) {
+				remove(Overview::sidecar_name(file_name).c_str());
+			}
+		}
 
-	delete writer;
+		cerr << "error: " << e.what() << endl;
+		return 1;
+	}
 }
 
 void print_help() {
@@ -82,8 +117,14 @@ void print_help() {
 	cout << "  -o --output=<file>\tOutput to <file> instead of the standard output" << endl;
 	cout << "  -w --wav\tOutput filees to the .wav format instead of .cs229" << endl;
 	cout << "  -n --nonstrict\tFile combinations will be much more lenient." << endl;
+	cout << "  -O --overview\tAlso save the waveform overview of the output file next to it (<file>.ovw), requires -o." << endl;
+	cout << "  --profile\tPrint the time spent in each stage and the counters of the run to standard error, as JSON." << endl;
 	cout << endl;
 	cout << "This program reads all sound files passed as arguments, and writes a single sound file that is" << endl;
 	cout << "the concatenation of the inputs. If no files are passed as arguments, then the program should" << endl;
 	cout << "read from standard input." << endl;
+	cout << "A file may be given as file@start or file@start:length to only use that range of its frames," << endl;
+	cout << "the start and the length are numbers of frames, or of seconds when followed by 's' (file@90s:5s)." << endl;
+	cout << "A range starting at or ending past the last frame of its file is an error." << endl;
+	cout << "Seeking into a .cs229 file saves the offsets of its lines next to it (<file>.idx), for the next runs." << endl;
 }
@@ -0,0 +1,457 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <getopt.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+
+#include <CS229Writer.h>
+#include <WavWriter.h>
+#include <SampleBlock.h>
+#include <Overview.h>
+#include <AsyncFile.h>
+#include <func/SinWave.h>
+#include <func/TriangleWave.h>
+#include <func/SawToothWave.h>
+#include <func/PulseWave.h>
+#include <func/BlockRenderer.h>
+#include <Profile.h>
+#include <flags.h>
+
+using namespace std;
+
+/**
+ * SplitMix64, small and fast, and unlike the distributions of <random>
+ * its output is the same with every compiler and standard library.
+ */
+class Random {
+public:
+	Random(uint64_t Seed) : state{Seed} { }
+
+	/**
+	 * \return The next 64 random bits.
+	 */
+	inline uint64_t next() {
+		uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+
+	/**
+	 * \return A uniform value in range [min, max).
+	 */
+	inline double uniform(double min, double max) {
+		return min + (max - min) * ((next() >> 11) * (1.0 / (1ULL << 53)));
+	}
+
+	/**
+	 * \return A uniform integer in range [0, n).
+	 */
+	inline size_t below(size_t n) {
+		return next() % n;
+	}
+
+private:
+	uint64_t state; /**< Advanced by every call to next(). */
+};
+
+void write_audio(const string &path, const string &format, uint64_t seed, size_t bits, size_t channels);
+void write_score(const string &path, uint64_t seed);
+vector<long> get_list_from_string(string data);
+vector<string> split(string data);
+uint64_t get_size_from_string(string data);
+double get_double_from_string(string data);
+long get_long_from_string(string data);
+void make_directory(const string &directory);
+void print_help();
+
+static uint64_t seed = 1;
+static size_t sample_rate = 44100;
+static double time_duration = 10.0;
+static long num_frames = -1;
+static uint64_t file_size = 0;
+static size_t instruments = 8;
+static size_t notes = 1000;
+
+int main(int argc, char ** argv) {
+	static struct option long_options[] = {
+		{ "help",			no_argument,		0,	'h' },
+		{ "output",			required_argument,	0,	'o' },
+		{ "seed",			required_argument,	0,	'S' },
+		{ "bits",			required_argument,	0,	'b' },
+		{ "channels",		required_argument,	0,	'c' },
+		{ "sr",				required_argument,	0,	'r' },
+		{ "frames",			required_argument,	0,	'F' },
+		{ "size",			required_argument,	0,	'z' },
+		{ "formats",		required_argument,	0,	'f' },
+		{ "instruments",	required_argument,	0,	'i' },
+		{ "notes",			required_argument,	0,	'N' },
+		{ "overview",		no_argument,		0,	'O' },
+		{ "profile",		no_argument,		0,	'P' },
+		{ 0, 0, 0, 0 }
+	};
+
+	char c = 0;
+	int option_index = 0;
+	string directory = ".";
+	vector<long> bit_list = { 8, 16, 32 };
+	vector<long> channel_list = { 1, 2 };
+	vector<string> formats = { "cs229", "wav" };
+
+	while ((c = getopt_long(argc, argv, "ho:t:O", long_options, &option_index)) != -1) {
+		switch (c) {
+		case 'o':
+			directory = optarg;
+			break;
+
+		case 'S':
+			seed = (uint64_t)get_long_from_string(string(optarg));
+			break;
+
+		case 'b':
+			bit_list = get_list_from_string(string(optarg));
+			break;
+
+		case 'c':
+			channel_list = get_list_from_string(string(optarg));
+			break;
+
+		case 'r':
+			sample_rate = (size_t)get_long_from_string(string(optarg));
+			break;
+
+		case 't':
+			time_duration = get_double_from_string(string(optarg));
+			break;
+
+		case 'F':
+			num_frames = get_long_from_string(string(optarg));
+			break;
+
+		case 'z':
+			file_size = get_size_from_string(string(optarg));
+			break;
+
+		case 'f':
+			formats = split(string(optarg));
+			break;
+
+		case 'i':
+			instruments = (size_t)get_long_from_string(string(optarg));
+			break;
+
+		case 'N':
+			notes = (size_t)get_long_from_string(string(optarg));
+			break;
+
+		case 'O':
+			write_overviews = true;
+			break;
+
+		case 'P':
+			profiling = true;
+			Profile::print_at_exit();
+			break;
+
+		case 'h':
+			print_help();
+			return 0;
+
+		default:
+			print_help();
+			return 1;
+		}
+	}
+
+	if (argc - optind > 0) {
+		print_help();
+		return 1;
+	}
+
+	for (auto bits : bit_list) {
+		if (bits != 8 && bits != 16 && bits != 32) {
+			throw invalid_argument("--bits only accepts 8, 16 and 32");
+		}
+	}
+
+	for (auto channels : channel_list) {
+		if (channels < 1 || channels >= 128) {
+			throw invalid_argument("--channels only accepts values in range [1, 127]");
+		}
+	}
+
+	if (!sample_rate || time_duration < 0.0) {
+		throw invalid_argument("a non-zero --sr and a positive -t are required");
+	}
+
+	make_directory(directory);
+
+	// every file gets its own seed, so adding a shape to the corpus leaves the other files unchanged
+	for (auto format : formats) {
+		if (format == "abc229") {
+			ostringstream name;
+			name << directory << "/corpus_s" << seed << "_" << instruments << "i_" << notes << "n.abc229";
+			write_score(name.str(), Random(seed ^ (instruments << 32) ^ notes).next());
+			cout << name.str() << endl;
+			continue;
+		}
+
+		if (format != "cs229" && format != "wav") {
+			throw invalid_argument("--formats only accepts cs229, wav and abc229");
+		}
+
+		for (auto bits : bit_list) {
+			for (auto channels : channel_list) {
+				ostringstream name;
+				name << directory << "/corpus_s" << seed << "_" << bits << "b_" << channels << "c." << format;
+				write_audio(name.str(), format, Random(seed ^ (bits << 32) ^ channels).next(), bits, channels);
+				cout << name.str() << endl;
+			}
+		}
+	}
+}
+
+void write_audio(const string &path, const string &format, uint64_t file_seed, size_t bits, size_t channels) {
+	unique_ptr<iBlockWriter> writer;
+	if (format == "wav") {
+		writer.reset(new WavWriter());
+	} else {
+		writer.reset(new CS229Writer());
+	}
+
+	// a .cs229 file only knows its length up front when given in frames or seconds
+	long frames = num_frames >= 0 ? num_frames : (long)(time_duration * sample_rate);
+	const size_t frame_bytes = channels * (bits / 8);
+	if (file_size && format == "wav") {
+		frames = (file_size - min(file_size, (uint64_t)44)) / frame_bytes;
+	} else if (file_size) {
+		frames = -1;
+	}
+
+	// the header of a .wav file stores the size of its data as a signed 32 bit value
+	if (format == "wav" && (uint64_t)frames * frame_bytes > (uint64_t)INT32_MAX - 36) {
+		throw invalid_argument(path + " : a .wav file can not hold more than 2 GiB of samples");
+	}
+
+	AsyncOfstream os(path);
+	if (!os.is_open()) {
+		throw invalid_argument(path + " : failed to open file for writing.");
+	}
+
+	if (write_overviews) {
+		writer->set_overview_file(Overview::sidecar_name(path));
+	}
+
+	// every channel is an oscillator of its own shape and frequency, plus white noise,
+	// together they stay just below full scale
+	Random rng = Random(file_seed);
+	const double amplitude = ((int64_t)1 << (bits - 1)) - 1;
+	vector<unique_ptr<iWaveform>> waves;
+	for (size_t c = 0; c < channels; c++) {
+		const double frequency = rng.uniform(20.0, 4000.0);
+		switch (rng.below(4)) {
+		case 0:
+			waves.emplace_back(new SinWave(amplitude, frequency));
+			break;
+
+		case 1:
+			waves.emplace_back(new TriangleWave(amplitude, frequency));
+			break;
+
+		case 2:
+			waves.emplace_back(new SawToothWave(amplitude, frequency));
+			break;
+
+		default:
+			waves.emplace_back(new PulseWave(amplitude, frequency, rng.uniform(0.1, 0.9)));
+			break;
+		}
+	}
+
+	SampleBlock block = SampleBlock(channels, STREAM_BLOCK_SIZE);
+	double rendered[STREAM_BLOCK_SIZE];
+	writer->begin(os, sample_rate, bits, channels, frames);
+
+	for (size_t first = 0; frames < 0 || first < (size_t)frames; first += block.get_frames()) {
+		const size_t count = frames < 0 ? STREAM_BLOCK_SIZE : min((size_t)STREAM_BLOCK_SIZE, frames - first);
+		for (size_t c = 0; c < channels; c++) {
+			render_waveform_block(*waves[c], nullptr, 0.7, first, sample_rate, rendered, count);
+
+			long * data = block.channel(c);
+			for (size_t i = 0; i < count; i++) {
+				data[i] = (long)(rendered[i] + rng.uniform(-0.25, 0.25) * amplitude);
+			}
+		}
+
+		block.set_frames(count);
+		writer->write_block(block);
+
+		// without a length, stop as soon as the file reaches its size
+		if (frames < 0 && (uint64_t)os.tellp() >= file_size) {
+			break;
+		}
+	}
+
+	writer->end();
+}
+
+void write_score(const string &path, uint64_t file_seed) {
+	static const char * waveforms[] = { "Sine", "Triangle", "Sawtooth", "PulseWave" };
+	static const char * lengths[] = { "", "", "", "2", ".5", ".25", "1.5", "3" };
+	static const char * octaves[] = { "", "", "", ",", "'", ",,", "''" };
+
+	ofstream os(path);
+	if (!os.is_open()) {
+		throw invalid_argument(path + " : failed to open file for writing.");
+	}
+
+	Random rng = Random(file_seed);
+	os << "ABC229" << endl;
+	os << "% Generated by 'sndcorpus', seed " << seed << endl;
+	os << "Tempo " << 60 + rng.below(180) << endl;
+
+	for (size_t i = 0; i < instruments; i++) {
+		const size_t wave = rng.below(4);
+		os << endl << "Instrument " << i << endl;
+		os << "Waveform " << waveforms[wave] << endl;
+		os << "Volume " << rng.uniform(0.1, 1.0) << endl;
+		os << "Attack " << rng.uniform(0.0, 0.05) << endl;
+		os << "Decay " << rng.uniform(0.0, 0.05) << endl;
+		os << "Sustain " << rng.uniform(0.3, 1.0) << endl;
+		os << "Release " << rng.uniform(0.0, 0.05) << endl;
+		os << "Octave " << (long)rng.below(3) - 1 << endl;
+		if (wave == 3) {
+			os << "PulseFrac " << rng.uniform(0.1, 0.9) << endl;
+		}
+
+		os << "Score" << endl << "[" << endl;
+		for (size_t n = 0; n < notes; n++) {
+			const char letter = 'A' + rng.below(7);
+
+			// roughly one note in ten is a rest, which takes no sharp or octave
+			if (rng.below(10) == 0) {
+				os << 'z' << lengths[rng.below(8)];
+			} else {
+				os << letter;
+				if (letter != 'B' && letter != 'E' && rng.below(4) == 0) {
+					os << '#';
+				}
+
+				os << octaves[rng.below(7)] << lengths[rng.below(8)];
+			}
+
+			os << (n % 16 == 15 || n + 1 == notes ? '\n' : ' ');
+		}
+
+		os << "]" << endl;
+	}
+}
+
+vector<long> get_list_from_string(string data) {
+	vector<long> ret;
+	for (auto value : split(data)) {
+		ret.push_back(get_long_from_string(value));
+	}
+
+	return ret;
+}
+
+vector<string> split(string data) {
+	vector<string> ret;
+	istringstream stream(data);
+	string value;
+
+	while (getline(stream, value, ',')) {
+		ret.push_back(value);
+	}
+
+	return ret;
+}
+
+uint64_t get_size_from_string(string data) {
+	// an optional k, M or G suffix scales the value by powers of 1024
+	uint64_t scale = 1;
+	const char suffix = data.empty() ? 0 : toupper(data.back());
+	const char * suffixes = "KMG";
+	const char * found = suffix ? strchr(suffixes, suffix) : nullptr;
+	if (found) {
+		scale = 1ULL << (10 * (found - suffixes + 1));
+		data.pop_back();
+	}
+
+	const long val = get_long_from_string(data);
+	if (val <= 0) {
+		throw invalid_argument("--size requires a positive value");
+	}
+
+	return val * scale;
+}
+
+double get_double_from_string(string data) {
+	size_t next_index;
+	auto val = stod(data, &next_index);
+
+	if (next_index != data.length() || !data.length()) {
+		throw invalid_argument("paremter does not contain a valid double");
+	}
+
+	return val;
+}
+
+long get_long_from_string(string data) {
+	size_t next_index;
+	auto val = stol(data, &next_index);
+
+	if (next_index != data.length() || !data.length()) {
+		throw invalid_argument("paremter does not contain a valid long");
+	}
+
+	return val;
+}
+
+void make_directory(const string &directory) {
+	struct stat info;
+	if (stat(directory.c_str(), &info) == 0) {
+		if (!S_ISDIR(info.st_mode)) {
+			throw invalid_argument(directory + " : exists and is not a directory");
+		}
+
+		return;
+	}
+
+	if (mkdir(directory.c_str(), 0755) != 0) {
+		throw invalid_argument(directory + " : failed to create the output directory");
+	}
+}
+
+void print_help() {
+	cout << "Usage: sndcorpus [options]" << endl;
+	cout << "Options:" << endl;
+	cout << "  -h --help\tDisplay this information" << endl;
+	cout << "  -o --output=<dir>\tWrite the files into <dir> (default of .), created if needed." << endl;
+	cout << "  --seed=<n>\tSeed of every generated file (default of 1), the same seed always produces the same files." << endl;
+	cout << "  --formats=<list>\tComma separated list of cs229, wav and abc229 (default of cs229,wav)." << endl;
+	cout << "  --bits=<list>\tComma separated list of bit resolutions to generate (default of 8,16,32)." << endl;
+	cout << "  --channels=<list>\tComma separated list of channel counts to generate (default of 1,2)." << endl;
+	cout << "  --sr=<n>\tSample rate of the generated files (default of 44100)." << endl;
+	cout << "  -t <n>\tDuration of each file in seconds (default of 10.0)." << endl;
+	cout << "  --frames=<n>\tLength of each file in frames, overrides -t." << endl;
+	cout << "  --size=<n>[k|M|G]\tSize of each file in bytes, overrides -t and --frames. .cs229 files are then written without 'Samples'." << endl;
+	cout << "  --instruments=<n>\tNumber of instruments of the .abc229 score (default of 8)." << endl;
+	cout << "  --notes=<n>\tNumber of notes of each instrument of the .abc229 score (default of 1000)." << endl;
+	cout << "  -O --overview\tAlso save the waveform overview of each .cs229 and .wav file next to it (<file>.ovw)." << endl;
+	cout << "  --profile\tPrint the time spent in each stage and the counters of the run to standard error, as JSON." << endl;
+	cout << endl;
+	cout << "Generates a reproducible corpus of sound files for benchmarking, one file for every" << endl;
+	cout << "format, bit resolution and channel count, named corpus_s<seed>_<bits>b_<channels>c.<format>." << endl;
+	cout << "Samples are streamed to disk block by block, so files may be much larger than memory." << endl;
+	cout << "The name of every file is printed once it is written." << endl;
+}
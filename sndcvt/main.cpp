@@ -3,84 +3,351 @@
 #include <WavReader.h>
 #include <CS229Writer.h>
 #include <WavWriter.h>
+#include <Batch.h>
+#include <BlockRing.h>
+#include <DeferredWriter.h>
+#include <Overview.h>
+#include <AsyncFile.h>
+#include <Profile.h>
+#include <Trace.h>
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <memory>
+#include <vector>
+#include <thread>
 #include <stdio.h>
 #include <stdlib.h>
 #include <getopt.h>
+#include <sys/stat.h>
 
 using namespace std;
 
 #define TMP_FILE ".cin"
 
+static const string read_failed_msg = "Failed to read the input file.";
+
 void create_tmp_file();
 void remove_tmp_file();
+AudioFile read_input(const string &name, unique_ptr<iFileWriter> &writer, string &extension, bool quiet);
 void output_file(iFileWriter * writer, AudioFile &file, const char * file_name);
+unique_ptr<iBlockReader> open_stream(const string &name, unique_ptr<iBlockWriter> &writer, string &extension, long &frames);
+void write_stream(iBlockReader &reader, iBlockWriter &writer, long frames, const char * file_name);
+string convert_into(const string &input, const string &directory);
+void make_directory(const string &directory);
 void print_help();
+long get_long_from_string(string data);
+
+static size_t bit_depth = 0;
+static bool dither = false;
+static RingWait ring_wait = RING_BLOCK;
 
 int main(int argc, char ** argv) {
 	static struct option long_options[] = {
 		{ "help", 0, 0, 'h' },
 		{ "output", required_argument, 0, 'o' },
+		{ "bits", required_argument, 0, 'b' },
+		{ "dither", no_argument, 0, 'd' },
+		{ "list", no_argument, 0, 'l' },
+		{ "jobs", required_argument, 0, 'j' },
+		{ "overview", no_argument, 0, 'O' },
+		{ "profile", no_argument, 0, 'P' },
+		{ "spin", no_argument, 0, 'S' },
 		{ 0, 0, 0, 0 }
 	};
 
 	char c = 0;
 	const char * file_name = nullptr;
 	int option_index = 0;
-	while ((c = getopt_long(argc, argv, "ho:012", long_options, &option_index)) != -1) {
+	bool read_list = false;
+	size_t jobs = 0;
+	while ((c = getopt_long(argc, argv, "ho:b:dlj:O012", long_options, &option_index)) != -1) {
 		switch (c) {
+		case 'l':
+			read_list = true;
+			break;
+
+		case 'j':
+			try {
+				jobs = (size_t)get_long_from_string(string(optarg));
+			} catch (const exception &e) {
+				print_help();
+				return 1;
+			}
+
+			break;
+
 		case 'o':
 			file_name = optarg;
 			break;
 
+		case 'b':
+			try {
+				bit_depth = (size_t)get_long_from_string(string(optarg));
+			} catch (const exception &e) {
+				print_help();
+				return 1;
+			}
+
+			break;
+
+		case 'd':
+			dither = true;
+			break;
+
+		case 'O':
+			write_overviews = true;
+			break;
+
+		case 'P':
+			profiling = true;
+			Profile::print_at_exit();
+			break;
+
+		case 'S':
+			ring_wait = RING_SPIN;
+			break;
+
 		case 'h': print_help();
 			return 0; }
 	}
 
-	// only one extra param is allowed (the file_name)
-	unsigned extra_params = argc - optind;
-	if (extra_params > 1) {
+	if (bit_depth && bit_depth != 8 && bit_depth != 16 && bit_depth != 32) {
 		print_help();
 		return 1;
 	}
 
-	if (extra_params == 0) {
+	// several inputs (or a list of them) are converted as a batch, -o names a directory
+	vector<string> inputs(argv + optind, argv + argc);
+	if (read_list || inputs.size() > 1) {
+		if (read_list) {
+			auto listed = Batch::read_file_list(cin);
+			inputs.insert(inputs.end(), listed.begin(), listed.end());
+		}
+
+		const string directory = file_name ? string(file_name) : "";
+		if (!directory.empty()) {
+			make_directory(directory);
+		}
+
+		auto failures = Batch(jobs).run(inputs, [&directory](const string &input) {
+			return convert_into(input, directory);
+		}, cout, cerr);
+
+		return failures ? 1 : 0;
+	}
+
+	if (inputs.empty()) {
 		create_tmp_file();
 	}
 
 	try {
-		AudioFile file = extra_params ? CS229Reader().read_file(string(argv[optind])) :
-			CS229Reader().read_file(TMP_FILE);
-		WavWriter writer = WavWriter();
-		output_file(&writer, file, file_name);
+		const string input = inputs.empty() ? string(TMP_FILE) : inputs[0];
+		unique_ptr<iBlockWriter> stream_writer;
+		string extension;
+		long frames = 0;
+		auto reader = open_stream(input, stream_writer, extension, frames);
+		if (reader) {
+			write_stream(*reader, *stream_writer, frames, file_name);
+		} else {
+			unique_ptr<iFileWriter> writer;
+			AudioFile file = read_input(input, writer, extension, false);
+			output_file(writer.get(), file, file_name);
+		}
+	} catch (exception &e) {
+		cerr << "error: " << e.what() << endl;
 		remove_tmp_file();
-		return 0;
-	} catch (exception e) { }
+		return 1;
+	}
+
+	remove_tmp_file();
+}
+
+AudioFile read_input(const string &name, unique_ptr<iFileWriter> &writer, string &extension, bool quiet) {
+	try {
+		AudioFile file = CS229Reader().read_file(name);
+		writer.reset(new WavWriter());
+		extension = ".wav";
+		return file;
+	} catch (const exception &e) { }
 
 	// if that fails try to read it as a .wav
 	try {
-		AudioFile file = extra_params ? WavReader().read_file(string(argv[optind])) :
-			WavReader().read_file(TMP_FILE);
-		CS229Writer writer = CS229Writer();
-		output_file(&writer, file, file_name);
-		remove_tmp_file();
-		return 0;
-	} catch (exception e) { }
+		AudioFile file = WavReader().read_file(name);
+		writer.reset(new CS229Writer());
+		extension = ".cs229";
+		return file;
+	} catch (const exception &e) { }
 
 	try {
-		AudioFile file = extra_params ? ABC229Reader(48000, 32).read_file(string(argv[optind])) :
-			ABC229Reader(48000, 32).read_file(TMP_FILE);
-		cerr << "Input file was of type .abc229, using a sample rate of 48000 and bit depth of 32." << endl;
-		WavWriter writer = WavWriter();
-		output_file(&writer, file, file_name);
-		remove_tmp_file();
-		return 0;
-	} catch (exception e) { }
+		AudioFile file = ABC229Reader(48000, 32).read_file(name);
+		if (!quiet) {
+			cerr << "Input file was of type .abc229, using a sample rate of 48000 and bit depth of 32." << endl;
+		}
 
-	// if that also fails print an error
-	cerr << "error: Failed to read the input file." << endl;
+		writer.reset(new WavWriter());
+		extension = ".wav";
+		return file;
+	} catch (const exception &e) { }
+
+	// if that also fails report an error
+	throw invalid_argument(read_failed_msg);
+}
+
+string convert_into(const string &input, const string &directory) {
+	unique_ptr<iBlockWriter> stream_writer;
+	unique_ptr<iFileWriter> writer;
+	string extension;
+	long frames = 0;
+	auto reader = open_stream(input, stream_writer, extension, frames);
+	unique_ptr<AudioFile> file;
+	if (!reader) {
+		file.reset(new AudioFile(read_input(input, writer, extension, true)));
+	}
+
+	// the output keeps the name of the input, with the extension of the new format
+	const size_t slash = input.find_last_of('/');
+	string stem = slash == string::npos ? input : input.substr(slash + 1);
+	const size_t dot = stem.find_last_of('.');
+	if (dot != string::npos && dot > 0) {
+		stem = stem.substr(0, dot);
+	}
+
+	string output = directory.empty() ?
+		(slash == string::npos ? "" : input.substr(0, slash + 1)) + stem + extension :
+		directory + "/" + stem + extension;
+
+	if (output == input) {
+		throw invalid_argument("refusing to overwrite the input file");
+	}
+
+	if (reader) {
+		write_stream(*reader, *stream_writer, frames, output.c_str());
+	} else {
+		output_file(writer.get(), *file, output.c_str());
+	}
+
+	return input + " -> " + output + "\n";
+}
+
+unique_ptr<iBlockReader> open_stream(const string &name, unique_ptr<iBlockWriter> &writer, string &extension, long &frames) {
+	// dither noise depends on the order samples are converted in, so dithered
+	// conversions keep converting whole files, as do formats without a block reader
+	if (bit_depth && dither) {
+		return nullptr;
+	}
+
+	ifstream probe(name, ios::in | ios::binary);
+	const bool is_wav = probe.peek() == 'R';
+	probe.close();
+
+	unique_ptr<iBlockReader> reader;
+	if (is_wav) {
+		reader.reset(new WavReader());
+		writer.reset(new CS229Writer());
+		extension = ".cs229";
+	} else {
+		reader.reset(new CS229Reader());
+		writer.reset(new WavWriter());
+		extension = ".wav";
+	}
+
+	try {
+		reader->open(name);
+		frames = reader->get_num_samples();
+		if (frames < 0) {
+			// the writers need the length up front when the output can not be rewound
+			frames = reader->count_frames();
+			reader->open(name);
+		}
+	} catch (exception &e) {
+		return nullptr;
+	}
+
+	return reader;
+}
+
+void write_stream(iBlockReader &reader, iBlockWriter &writer, long frames, const char * file_name) {
+	const size_t num_channels = reader.get_num_channels();
+	const size_t from = reader.get_bit_res();
+	const size_t to = bit_depth ? bit_depth : from;
+
+	AsyncOfstream output;
+	if (file_name) {
+		output.open(file_name);
+		if (write_overviews) {
+			writer.set_overview_file(Overview::sidecar_name(file_name));
+		}
+	}
+
+	// the input is decoded on a thread of its own while this one converts and
+	// writes the blocks, which go back and forth between the two through a ring
+	BlockRing ring(num_channels, STREAM_BLOCK_SIZE, PIPELINE_QUEUE_BLOCKS, ring_wait);
+	bool error = false;
+	thread decoder([&]() {
+		Trace::set_thread_name("decoder");
+		try {
+			SampleBlock *block = nullptr;
+			while ((block = ring.acquire()) != nullptr && reader.read_block(*block) > 0) {
+				ring.push(block);
+			}
+		} catch (exception &e) {
+			error = true;
+		}
+
+		ring.close();
+	});
+
+	// nothing is written before the first block decoded, a corrupt input leaves the standard output empty
+	DeferredWriter deferred(&writer);
+	try {
+		deferred.begin(file_name ? output : cout, reader.get_sample_rate(), to, num_channels, frames);
+		SampleBlock *block = nullptr;
+		while ((block = ring.pop()) != nullptr) {
+			if (to != from) {
+				PROFILE_SCOPE(TIMER_ARITHMETIC);
+				for (size_t c = 0; c < num_channels; c++) {
+					Channel::convert_samples(block->channel(c), block->channel(c), block->get_frames(), from, to);
+				}
+			}
+
+			deferred.write_block(*block);
+			ring.release(block);
+		}
+	} catch (...) {
+		// stops the decoder before the reader goes away
+		ring.close();
+		decoder.join();
+		throw;
+	}
+
+	decoder.join();
+	if (error) {
+		// the input turned out to be invalid, drop what was written of it
+		if (file_name) {
+			output.close();
+			remove(file_name);
+		}
+
+		throw invalid_argument(read_failed_msg);
+	}
+
+	deferred.end();
+}
+
+void make_directory(const string &directory) {
+	struct stat info;
+	if (stat(directory.c_str(), &info) == 0) {
+		if (!S_ISDIR(info.st_mode)) {
+			throw invalid_argument(directory + " is not a directory");
+		}
+
+		return;
+	}
+
+	if (mkdir(directory.c_str(), 0755) != 0) {
+		throw invalid_argument("failed to create the directory " + directory);
+	}
 }
 
 void create_tmp_file() {
@@ -97,6 +364,12 @@ void remove_tmp_file() {
 }
 
 void output_file(iFileWriter * writer, AudioFile &file, const char * file_name) {
+	if (bit_depth && bit_depth != file.get_bit_res()) {
+		AudioFile converted = file.convert_bit_res(bit_depth, dither);
+		output_file(writer, converted, file_name);
+		return;
+	}
+
 	if (file_name) {
 		writer->write_file(file, file_name);
 	} else {
@@ -104,14 +377,41 @@ void output_file(iFileWriter * writer, AudioFile &file, const char * file_name)
 	}
 }
 
+long get_long_from_string(string data) {
+	try {
+		size_t next_index;
+		auto val = stol(data, &next_index);
+
+		if (next_index != data.length() || !data.length()) {
+			throw invalid_argument("");
+		}
+
+		return val;
+
+	} catch (const exception &e) {
+		throw invalid_argument("paremter does not contain a valid long");
+	}
+}
+
 void print_help() {
-	cout << "Usage: sndcvt [options] [file]" << endl;
+	cout << "Usage: sndcvt [options] [file...]" << endl;
 	cout << "Options:" << endl;
 	cout << "  -h --help\tDisplay this information" << endl;
 	cout << "  -o --output\tSpecifies the name of the file this program should write to (standard output if ommitted)." << endl;
+	cout << "  -b --bits=<n>\tConvert the output to a bit depth of <n> (8, 16, or 32)." << endl;
+	cout << "  -d --dither\tApply TPDF dither when --bits reduces the bit depth." << endl;
+	cout << "  -l --list\tRead the names of the files to convert from the standard input, one per line." << endl;
+	cout << "  -j --jobs=<n>\tConvert up to <n> files at once (the number of hardware threads by default)." << endl;
+	cout << "  -O --overview\tAlso save the waveform overview of every output file next to it (<file>.ovw)." << endl;
+	cout << "  --spin\t\tHave the reading and the writing threads spin instead of sleeping while they wait for each other." << endl;
+	cout << "  --profile\tPrint the time spent in each stage and the counters of the run to standard error, as JSON." << endl;
 	cout << endl;
 	cout << "This program reads the [file] argument (or from standard input if that parameter is ommitted." << endl;
 	cout << "The program will then convert that file to a new format depending on its current format." << endl;
 	cout << "The new file will be output to the standard output or the file specified by '-o' if available." << endl;
 	cout << "The conversion performed is defined as follow: cs229->wav; wav->cs229; abc229->wav." << endl;
+	cout << ".cs229 and .wav files are decoded on one thread while another one writes the output, block by block." << endl;
+	cout << "When several files (or --list) are given they are converted in parallel, each output is written" << endl;
+	cout << "next to its input (or into the directory given by '-o') with the extension of its new format." << endl;
+	cout << "Files which could not be converted are reported without stopping the others." << endl;
 }
@@ -6,15 +6,20 @@
 #include <math.h>
 #include <string>
 #include <sstream>
+#include <fstream>
 
 #include <CS229Reader.h>
 #include <CS229Writer.h>
 #include <AudioFile.h>
+#include <RenderGraph.h>
+#include <Pipeline.h>
+#include <AsyncFile.h>
 #include <func/SinWave.h>
 #include <func/TriangleWave.h>
 #include <func/SawToothWave.h>
 #include <func/PulseWave.h>
 #include <func/AdsrEnvelope.h>
+#include <Profile.h>
 #include <flags.h>
 
 using namespace std;
@@ -54,6 +59,8 @@ int main(int argc, char ** argv) {
 		{ "sawtooth",	no_argument,		&sawtooth,	1 },
 		{ "pulse",		no_argument,		&pulse,		1 },
 		{ "pf",			required_argument,	0,			'p' },
+		{ "overview",	no_argument,		0,			'O' },
+		{ "profile",	no_argument,		0,			'P' },
 		{ 0, 0, 0, 0 }
 	};
 
@@ -63,7 +70,7 @@ int main(int argc, char ** argv) {
 	const char * name = NULL;
 
 	// parse all arguments
-	while ((c = getopt_long(argc, argv, "ho:nf:t:v:a:d:s:r:p:012", long_options, &option_index)) != -1) {
+	while ((c = getopt_long(argc, argv, "ho:nf:t:v:a:d:s:r:p:O012", long_options, &option_index)) != -1) {
 		switch (c) {
 		case 0:
 			name = long_options[option_index].name;
@@ -119,6 +126,15 @@ int main(int argc, char ** argv) {
 			pulse_ratio = get_double_from_string(string(optarg));
 			break;
 
+		case 'O':
+			write_overviews = true;
+			break;
+
+		case 'P':
+			profiling = true;
+			Profile::print_at_exit();
+			break;
+
 		case 'h':
 			print_help();
 			return 0;
@@ -179,20 +195,29 @@ int main(int argc, char ** argv) {
 		break;
 	}
 
-	// generate the file and output
-	AudioFile file = ((iFunction *)wave)->generate_audio_file(sample_rate, time_duration, bit_res);
-	file = file * volume;
+	// oscillator -> volume -> envelope -> quantize, evaluated block by block
+	AdsrEnvelope adsr = AdsrEnvelope(a, d, s, r, time_duration);
+	RenderGraph graph = RenderGraph(wave);
+	graph.gain(volume);
 
 	if (use_adsr) {
-		AdsrEnvelope adsr = AdsrEnvelope(a, d, s, r, time_duration);
-		file = adsr * file;
+		graph.envelope(&adsr);
 	}
 
+	// the samples are formatted on another thread while the next blocks are rendered
+	CS229Writer writer;
+	AsyncOfstream output;
 	if (file_name) {
-		CS229Writer().write_file(file, file_name);
-	} else {
-		CS229Writer().write_file(file, cout);
+		if (write_overviews) {
+			writer.set_overview_file(Overview::sidecar_name(file_name));
+		}
+
+		output.open(file_name);
 	}
+
+	Pipeline pipeline;
+	pipeline.write(pipeline.render(&graph, sample_rate, time_duration, bit_res), &writer, file_name ? &output : &cout);
+	pipeline.run();
 	
 	// wave is only NULL if the default: exception is thrown
 	delete wave;
@@ -218,6 +243,8 @@ void print_help() {
 	cout << "  --sawtooth\tGenerate a sawtooth wave." << endl;
 	cout << "  --pulse\tGenerate a pulse wave (requires --pf)." << endl;
 	cout << "  -p --pf=<n>\tFraction of the time the pulse wave is 'up', required for --pulse, ignored otherwise (must be within rage of [0.0, 1.0])." << endl;
+	cout << "  -O --overview\tAlso save the waveform overview of the output file next to it (<file>.ovw), requires -o." << endl;
+	cout << "  --profile\tPrint the time spent in each stage and the counters of the run to standard error, as JSON." << endl;
 	cout << endl;
 	cout << "Produces a sound of the specified frequency and waveform, usineg a simple ADSR envelope." << endl;
 }
@@ -1,44 +1,171 @@
-#include <CS229Reader.h>
+#include <AudioInfo.h>
+#include <SignalStats.h>
+#include <Batch.h>
+#include <Overview.h>
+#include <Profile.h>
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <string>
+#include <vector>
 #include <stdio.h>
 #include <stdlib.h>
 #include <getopt.h>
 
 using namespace std;
 
+string describe(istream &is, string file_name, bool stats, ThreadPool *pool);
+string describe(string file_name, bool stats, ThreadPool *pool);
 void print_help();
+long get_long_from_string(string data);
 
 int main(int argc, char ** argv) {
 	static struct option long_options[] = {
 		{ "help", 0, 0, 'h' },
+		{ "list", 0, 0, 'l' },
+		{ "jobs", required_argument, 0, 'j' },
+		{ "stats", 0, 0, 's' },
+		{ "overview", 0, 0, 'O' },
+		{ "profile", 0, 0, 'P' },
 		{ 0, 0, 0, 0 }
 	};
 
 	char c = 0;
 	int option_index = 0;
-	while ((c = getopt_long(argc, argv, "h012", long_options, &option_index)) != -1) {
+	bool read_list = false;
+	bool stats = false;
+	bool overviews = false;
+	size_t jobs = 0;
+	while ((c = getopt_long(argc, argv, "hlj:sO012", long_options, &option_index)) != -1) {
 		switch (c) {
+		case 's':
+			stats = true;
+			break;
+
+		case 'O':
+			overviews = true;
+			break;
+
+		case 'P':
+			profiling = true;
+			Profile::print_at_exit();
+			break;
+
+		case 'l':
+			read_list = true;
+			break;
+
+		case 'j':
+			try {
+				jobs = (size_t)get_long_from_string(string(optarg));
+			} catch (const exception &e) {
+				print_help();
+				return 1;
+			}
+
+			break;
+
 		case 'h':
 			print_help();
 			return 0;
+
+		default:
+			print_help();
+			return 1;
 		}
 	}
 
-	if (argc == 2) {
-		cout << CS229Reader().read_file(string(argv[1])) << endl;
-	} else if (argc == 1) {
-		cout << CS229Reader().read_file(cin, "std::cin") << endl;
-	} else {
-		print_help();
+	vector<string> files(argv + optind, argv + argc);
+	if (read_list) {
+		auto listed = Batch::read_file_list(cin);
+		files.insert(files.end(), listed.begin(), listed.end());
+	}
+
+	// a single file spreads the statistics over the shared pool
+	if (files.empty() && !read_list) {
+		cout << describe(cin, "std::cin", stats, &ThreadPool::shared());
+		return 0;
+	} else if (files.size() == 1 && !read_list) {
+		if (overviews) {
+			Overview::update(files[0]);
+		}
+
+		cout << describe(files[0], stats, &ThreadPool::shared());
+		return 0;
+	}
+
+	// many files are described in parallel, one file per worker, and printed in order
+	auto failures = Batch(jobs).run(files, [stats, overviews](const string &file) {
+		if (overviews) {
+			Overview::update(file);
+		}
+
+		return describe(file, stats, nullptr);
+	}, cout, cerr);
+
+	return failures ? 1 : 0;
+}
+
+string describe(istream &is, string file_name, bool stats, ThreadPool *pool) {
+	stringstream ss;
+
+	// without statistics only the header is read, the samples are never decoded
+	if (!stats) {
+		ss << AudioInfo::probe(is, file_name) << endl;
+		return ss.str();
+	}
+
+	string extension;
+	auto reader = AudioInfo::open_reader(is, file_name, extension);
+	auto result = SignalStats::analyze(*reader, pool);
+
+	ss << AudioInfo(file_name, extension, reader->get_sample_rate(), reader->get_bit_res(),
+			reader->get_num_channels(), result.get_num_samples());
+	ss << result << endl;
+	return ss.str();
+}
+
+string describe(string file_name, bool stats, ThreadPool *pool) {
+	ifstream file(file_name, ios::in | ios::binary);
+	if (!file.is_open()) {
+		throw invalid_argument("Failed to open file for reading.");
+	}
+
+	return describe(file, file_name, stats, pool);
+}
+
+long get_long_from_string(string data) {
+	try {
+		size_t next_index;
+		auto val = stol(data, &next_index);
+
+		if (next_index != data.length() || !data.length() || val < 0) {
+			throw invalid_argument("");
+		}
+
+		return val;
+
+	} catch (const exception &e) {
+		throw invalid_argument("paremter does not contain a valid long");
 	}
 }
 
 void print_help() {
-	cout << "Usage: sndinfo [options] [file]" << endl;
+	cout << "Usage: sndinfo [options] [file...]" << endl;
 	cout << "Options:" << endl;
 	cout << "  -h --help\tDisplay this information" << endl;
+	cout << "  -l --list\tRead the names of the files to inspect from the standard input, one per line." << endl;
+	cout << "  -j --jobs=<n>\tInspect up to <n> files at once (the number of hardware threads by default)." << endl;
+	cout << "  -s --stats\tAlso decode the samples, and print the peak, RMS, DC offset, zero crossing" << endl;
+	cout << "            \trate and number of full scale samples of every channel." << endl;
+	cout << "  -O --overview\tAlso build the waveform overview sidecar (<file>.ovw) of every named file," << endl;
+	cout << "  --profile\tPrint the time spent in each stage and the counters of the run to standard error, as JSON." << endl;
+	cout << "               \tan existing sidecar is only extended with the frames it does not cover." << endl;
 	cout << endl;
 	cout << "If a [file] is given, sound information for that file will be written to the standard output." << endl;
 	cout << "If a [file] is not given, sound information will be read from the standard intput." << endl;
+	cout << "Both .cs229 and .wav files are supported." << endl;
+	cout << "When several files are given they are inspected in parallel, their information is" << endl;
+	cout << "written in the order the files were given, and files which could not be read are" << endl;
+	cout << "reported on the standard error without stopping the others." << endl;
 }
@@ -4,15 +4,23 @@
 #include <stdio.h>
 #include <string>
 #include <sstream>
+#include <fstream>
+#include <memory>
+#include <vector>
 
 #include <CS229Reader.h>
 #include <CS229Writer.h>
 #include <WavWriter.h>
 #include <AudioFile.h>
+#include <Mixer.h>
+#include <DeferredWriter.h>
+#include <AsyncFile.h>
+#include <Profile.h>
 #include <flags.h>
 
 using namespace std;
 double get_scalar(char * str);
+OverflowPolicy get_overflow_policy(char * str);
 void print_help();
 
 static int output_wav = 0;
@@ -23,13 +31,16 @@ int main(int argc, char ** argv) {
 		{ "output", required_argument, 0, 'o' },
 		{ "wav", 0, 0, 'w' },
 		{ "nonstrict", 0, 0, 'n' },
+		{ "overflow", required_argument, 0, 'f' },
+		{ "overview", 0, 0, 'O' },
+		{ "profile", 0, 0, 'P' },
 		{ 0, 0, 0, 0 }
 	};
 
 	char c = 0;
 	int option_index = 0;
 	const char * file_name = NULL;
-	while ((c = getopt_long(argc, argv, "hwo:n012", long_options, &option_index)) != -1) {
+	while ((c = getopt_long(argc, argv, "hwo:nf:O012", long_options, &option_index)) != -1) {
 		switch (c) {
 		case 'o':
 			file_name = optarg;
@@ -43,6 +54,25 @@ int main(int argc, char ** argv) {
 			strict_data = false;
 			break;
 
+		case 'f':
+			try {
+				overflow_policy = get_overflow_policy(optarg);
+			} catch (const exception &e) {
+				print_help();
+				return 1;
+			}
+
+			break;
+
+		case 'O':
+			write_overviews = true;
+			break;
+
+		case 'P':
+			profiling = true;
+			Profile::print_at_exit();
+			break;
+
 		case 'h':
 			print_help();
 			return 0;
@@ -55,27 +85,57 @@ int main(int argc, char ** argv) {
 		return 1;
 	}
 
-	auto output = CS229Reader().read_file(string(argv[optind])) * get_scalar(argv[optind + 1]);
+	bool created = false;
+	try {
+		// open every input, only the headers are read at this point
+		Mixer mixer;
+		vector<unique_ptr<CS229Reader>> readers;
+		for (auto i = optind; i < argc; i+=2) {
+			readers.push_back(unique_ptr<CS229Reader>(new CS229Reader()));
+			readers.back()->open_range(string(argv[i]));
+			mixer.add_input(readers.back().get(), get_scalar(argv[i+1]));
+		}
 
-	for (auto i = optind + 2; i < argc; i+=2) {
-		output = output + (CS229Reader().read_file(string(argv[i])) * get_scalar(argv[i+1]));
-	}
+		unique_ptr<iBlockWriter> writer;
+		if (output_wav == 1) {
+			writer.reset(new WavWriter());
+		} else {
+			writer.reset(new CS229Writer());
+		}
 
-	iFileWriter * writer = nullptr;
-	if (output_wav == 1) {
-		writer = new WavWriter();
-	} else {
-		writer = new CS229Writer();
-	}
+		// stream the mix straight to the output, one block at a time
+		if (file_name) {
+			if (write_overviews) {
+				writer->set_overview_file(Overview::sidecar_name(file_name));
+			}
+
+			AsyncOfstream output(file_name);
+			created = true;
+			mixer.mix(*writer, output);
+		} else {
+			// the standard output can not be removed, so nothing is written to it
+			// until the first block was mixed (and passed the overflow check)
+			DeferredWriter deferred(writer.get());
+			mixer.mix(deferred, cout);
+		}
 
+	} catch (const exception &e) {
+		// the header is written before the samples are mixed, so a mix
+		// that failed (e.g. an overflow) must not leave a broken file behind
+		if (created) {
+			remove(file_name);
+			if (write_overviews) {
+				remove(Overview::sidecar_name(file_name).c_str());
+			}
+		}
 
-	if (file_name) {
-		writer->write_file(output, file_name);
-	} else {
-		writer->write_file(output, cout);
+		cerr << "error: " << e.what() << endl;
+		return 1;
 	}
 
-	delete writer;
+	if (overflow_policy != OVERFLOW_THROW) {
+		cerr << "Clipped samples: " << clipped_samples << endl;
+	}
 }
 
 double get_scalar(char * str) {
@@ -93,6 +153,19 @@ double get_scalar(char * str) {
 	return scalar;
 }
 
+OverflowPolicy get_overflow_policy(char * str) {
+	auto policy = string(str);
+	if (policy == "throw") {
+		return OVERFLOW_THROW;
+	} else if (policy == "clip") {
+		return OVERFLOW_SATURATE;
+	} else if (policy == "limit") {
+		return OVERFLOW_LIMIT;
+	}
+
+	throw invalid_argument("overflow must be one of throw, clip or limit");
+}
+
 void print_help() {
 	cout << "Usage: sndmix [options] file mult..." << endl;
 	cout << "Options:" << endl;
@@ -100,7 +173,16 @@ void print_help() {
 	cout << "  -o --ouput=<file>\tOutput to <file> instead of standard output" << endl;
 	cout << "  -w --wav\tOutput filees to the .wav format instead of .cs229" << endl;
 	cout << "  -n --nonstrict\tFile combinations will be much more lenient." << endl;
+	cout << "  -f --overflow=<policy>\tWhat to do with samples that do not fit: throw (default)," << endl;
+	cout << "                        \tclip, or limit (look-ahead limiter). The number of" << endl;
+	cout << "                        \tclipped samples is reported on standard error. A failed mix" << endl;
+	cout << "                        \texits with 1, and may leave a truncated standard output." << endl;
+	cout << "  -O --overview\tAlso save the waveform overview of the output file next to it (<file>.ovw), requires -o." << endl;
+	cout << "  --profile\tPrint the time spent in each stage and the counters of the run to standard error, as JSON." << endl;
 	cout << endl;
 	cout << "This program reads all sound files passed as arguments, and \"mixes\"" << endl; 
 	cout << "them into a single sound file." << endl;
+	cout << "A file may be given as file@start or file@start:length to only mix that range of its frames," << endl;
+	cout << "the start and the length are numbers of frames, or of seconds when followed by 's' (file@90s:5s)." << endl;
+	cout << "Seeking into a .cs229 file saves the offsets of its lines next to it (<file>.idx), for the next runs." << endl;
 }
@@ -1,6 +1,7 @@
 #include <ABC229Reader.h>
 #include <CS229Writer.h>
 #include <WavWriter.h>
+#include <Profile.h>
 #include <iostream>
 #include <string>
 #include <stdio.h>
@@ -25,13 +26,15 @@ int main(int argc, char ** argv) {
 		{ "bits", required_argument, 0, 'b' },
 		{ "sr", required_argument, 0, 's' },
 		{ "mute", required_argument, 0, 'm' },
+		{ "overview", no_argument, 0, 'O' },
+		{ "profile", no_argument, 0, 'P' },
 		{ 0, 0, 0, 0 }
 	};
 
 	char c = 0;
 	int option_index = 0;
 	const char * file_name = NULL;
-	while ((c = getopt_long(argc, argv, "hwo:b:s:m:012", long_options, &option_index)) != -1) {
+	while ((c = getopt_long(argc, argv, "hwo:b:s:m:O012", long_options, &option_index)) != -1) {
 		switch (c) {
 		case 'o':
 			file_name = optarg;
@@ -53,6 +56,15 @@ int main(int argc, char ** argv) {
 			mute_index = (size_t)get_long_from_string(string(optarg));
 			break;
 
+		case 'O':
+			write_overviews = true;
+			break;
+
+		case 'P':
+			profiling = true;
+			Profile::print_at_exit();
+			break;
+
 		case 'h':
 			print_help();
 			return 0;
@@ -113,6 +125,8 @@ void print_help() {
 	cout << "  -s --sr\tSample Rate to use for the output .cs229" << endl;
 	cout << "  -b --bits\t Bit Depth to use for the output .cs229" << endl;
 	cout << "  -m --mute\tIndex of an Instrument to be muted in output .cs229" << endl;
+	cout << "  -O --overview\tAlso save the waveform overview of the output file next to it (<file>.ovw), requires -o." << endl;
+	cout << "  --profile\tPrint the time spent in each stage and the counters of the run to standard error, as JSON." << endl;
 	cout << endl;
 	cout << "This program reads in a file of format .abc229 and converts it to the .cs229 format." << endl;
 	cout << "If there is no file specified for input, this program will read from the standard input." << endl;
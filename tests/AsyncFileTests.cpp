@@ -0,0 +1,138 @@
+#include <AsyncFile.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "Check.h"
+
+// spans several buffers, and ends in the middle of one
+static const size_t FILE_SIZE = 3 * IO_BUFFER_SIZE + 123;
+
+/**
+ * \return The byte expected at the given position of the test file.
+ */
+static char byte_at(size_t pos) {
+	return (char)((pos * 7 + pos / 251) & 0xff);
+}
+
+/**
+ * Seeks the stream and reads a byte.
+ * \return Whether the seek succeeded and the byte read is the one at 'pos'.
+ */
+static bool read_at(AsyncIfstream &is, size_t pos) {
+	is.seekg(pos);
+	return (size_t)is.tellg() == pos && is.get() == (unsigned char)byte_at(pos);
+}
+
+/**
+ * Writes the test file, then reads it back with seeks inside and outside of the current buffer.
+ */
+static void check_file(const string &filename) {
+	AsyncOfstream os(filename);
+	CHECK(os.is_open());
+	os.put(0);
+	for (size_t i = 1; i < FILE_SIZE; i++) {
+		os.put(byte_at(i));
+	}
+
+	// like the header of a .wav file, the first byte is filled in once the rest is written
+	CHECK((size_t)os.tellp() == FILE_SIZE);
+	os.seekp(0);
+	os.put(byte_at(0));
+	os.close();
+	CHECK(!os.fail());
+
+	AsyncIfstream is(filename);
+	CHECK(is.is_open());
+	for (size_t i = 0; i < 1000; i++) {
+		CHECK(is.get() == (unsigned char)byte_at(i));
+	}
+
+	// within the current buffer, backwards and forwards
+	CHECK(read_at(is, 10));
+	CHECK(read_at(is, IO_BUFFER_SIZE - 1));
+	CHECK(read_at(is, 500));
+
+	// outside of it, ahead of the read-ahead, then back to the start
+	CHECK(read_at(is, 2 * IO_BUFFER_SIZE + 5));
+	CHECK(read_at(is, 0));
+
+	// reading on across the end of a buffer after a seek
+	is.seekg(IO_BUFFER_SIZE - 2);
+	for (size_t i = IO_BUFFER_SIZE - 2; i < IO_BUFFER_SIZE + 2; i++) {
+		CHECK(is.get() == (unsigned char)byte_at(i));
+	}
+
+	// relative to the end, then up to the end of the file
+	is.seekg(-10, ios::end);
+	CHECK((size_t)is.tellg() == FILE_SIZE - 10);
+	size_t count = 0;
+	while (is.get() != EOF) {
+		count++;
+	}
+
+	CHECK(count == 10);
+	is.close();
+}
+
+/**
+ * Reads the test file through more streams than the buffer budget has room
+ * for, a block of each in turn, as a mix of many inputs does.
+ */
+static void check_many_files(const string &filename) {
+	const size_t num_files = 2 * IO_BUFFER_BUDGET / (2 * IO_BUFFER_SIZE) + 4;
+	vector<unique_ptr<AsyncIfstream>> streams;
+	for (size_t i = 0; i < num_files; i++) {
+		streams.emplace_back(new AsyncIfstream(filename));
+		CHECK(streams.back()->is_open());
+	}
+
+	// the first files get full buffers, the ones past the budget the smallest
+	const AsyncFileBuf *first = static_cast<AsyncFileBuf *>(streams.front()->rdbuf());
+	const AsyncFileBuf *last = static_cast<AsyncFileBuf *>(streams.back()->rdbuf());
+	CHECK(first->get_buffer_size() == IO_BUFFER_SIZE);
+	CHECK(last->get_buffer_size() == IO_BUFFER_MIN);
+
+	bool same = true;
+	char block[4096];
+	for (size_t start = 0; start < FILE_SIZE; start += sizeof(block)) {
+		const size_t count = min(sizeof(block), FILE_SIZE - start);
+		for (auto &is : streams) {
+			is->read(block, count);
+			for (size_t i = 0; i < count; i++) {
+				same = same && block[i] == byte_at(start + i);
+			}
+		}
+	}
+
+	CHECK(same);
+	streams.clear();
+
+	// closing the files gives their buffers back to the budget
+	AsyncIfstream is(filename);
+	CHECK(static_cast<AsyncFileBuf *>(is.rdbuf())->get_buffer_size() == IO_BUFFER_SIZE);
+}
+
+void test_async_file() {
+	char filename[] = "/tmp/imtestXXXXXX";
+	const int fd = mkstemp(filename);
+	CHECK(fd >= 0);
+	if (fd < 0) {
+		return;
+	}
+
+	close(fd);
+
+	// on the I/O threads, and on the calling thread
+	const bool was_async = async_io;
+	async_io = true;
+	check_file(filename);
+	check_many_files(filename);
+	async_io = false;
+	check_file(filename);
+	async_io = was_async;
+	remove(filename);
+}
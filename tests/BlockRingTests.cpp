@@ -0,0 +1,86 @@
+#include <BlockRing.h>
+#include <thread>
+
+#include "Check.h"
+
+/**
+ * Streams 'count' blocks from a producer thread to this thread, each holding its index.
+ */
+static void check_transfer(RingWait wait, size_t count) {
+	BlockRing ring(1, 4, 3, wait);
+	thread producer([&]() {
+		for (size_t i = 0; i < count; i++) {
+			SampleBlock *block = ring.acquire();
+			block->channel(0)[0] = i;
+			block->set_frames(1);
+			ring.push(block);
+		}
+
+		ring.close();
+	});
+
+	size_t received = 0;
+	while (SampleBlock *block = ring.pop()) {
+		CHECK(block->get_frames() == 1 && block->channel(0)[0] == (long)received);
+		received++;
+		ring.release(block);
+	}
+
+	producer.join();
+	CHECK(received == count);
+	CHECK(ring.pop() == nullptr);
+}
+
+void test_block_ring() {
+	// the capacity is rounded up to a power of two, and values come out in order across wrap arounds
+	SpscRing<int> values(5);
+	int value = 0;
+	CHECK(values.empty());
+	CHECK(!values.try_pop(value));
+	for (int round = 0; round < 3; round++) {
+		for (int i = 0; i < 8; i++) {
+			CHECK(values.try_push(round * 8 + i));
+		}
+
+		CHECK(!values.try_push(-1));
+		CHECK(!values.empty());
+		for (int i = 0; i < 8; i++) {
+			CHECK(values.try_pop(value) && value == round * 8 + i);
+		}
+
+		CHECK(values.empty());
+		CHECK(!values.try_pop(value));
+	}
+
+	// blocks pushed before close() are drained, then pop() ends the stream
+	BlockRing ring(2, 4, 3);
+	SampleBlock *first = ring.acquire();
+	SampleBlock *second = ring.acquire();
+	CHECK(first && second && first != second);
+	first->set_frames(1);
+	second->set_frames(2);
+	ring.push(first);
+	ring.push(second);
+	ring.close();
+	CHECK(ring.acquire() == nullptr);
+	CHECK(ring.pop() == first);
+	CHECK(ring.pop() == second);
+	CHECK(ring.pop() == nullptr);
+	ring.release(first);
+	ring.release(second);
+	CHECK(ring.pop() == nullptr);
+
+	// a consumer closing the ring stops a producer waiting for a free block
+	BlockRing full(1, 4, 1);
+	SampleBlock *only = full.acquire();
+	full.push(only);
+	thread producer([&]() {
+		CHECK(full.acquire() == nullptr);
+	});
+
+	full.close();
+	producer.join();
+
+	check_transfer(RING_BLOCK, 1000);
+	check_transfer(RING_SPIN, 1000);
+}
@@ -0,0 +1,127 @@
+#include <CS229Reader.h>
+#include <fstream>
+#include <string>
+#include <stdexcept>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "Check.h"
+
+static const size_t FRAMES = 5000;
+
+/**
+ * Writes a mono .cs229 file whose i'th frame is i. Line 'padded' is followed by
+ * as many spaces as the digits taken from line 'shortened', which holds a 0
+ * instead, so the file has the same size whichever lines are given.
+ */
+static void write_file(const string &filename, size_t padded, size_t shortened) {
+	ofstream os(filename);
+	os << "CS229\nSampleRate 8000\nChannels 1\nBitRes 16\nStartData\n";
+	for (size_t i = 0; i < FRAMES; i++) {
+		if (i == padded) {
+			os << i << string(to_string(shortened).length() - 1, ' ') << '\n';
+		} else {
+			os << (i == shortened ? 0 : i) << '\n';
+		}
+	}
+}
+
+/**
+ * \return Whether reading frames 3000 to 3002 of the file gives back 3000 to 3002.
+ */
+static bool check_range(const string &filename) {
+	CS229Reader reader;
+	AudioFile range = reader.read_range(filename, 3000, 3);
+	return range.get_num_samples() == 3 && range[0].get_sample(0) == 3000 &&
+		range[0].get_sample(1) == 3001 && range[0].get_sample(2) == 3002;
+}
+
+/**
+ * Sets the modification time of a file to the one it had in 'info', moved by 'seconds'.
+ */
+static void set_mtime(const string &filename, const struct stat &info, long seconds) {
+	struct timespec times[2] = { info.st_atim, info.st_mtim };
+	times[1].tv_sec += seconds;
+	utimensat(AT_FDCWD, filename.c_str(), times, 0);
+}
+
+void test_cs229_index() {
+	char filename[] = "/tmp/imtestXXXXXX";
+	const int fd = mkstemp(filename);
+	CHECK(fd >= 0);
+	if (fd < 0) {
+		return;
+	}
+
+	close(fd);
+	const string index = CS229Reader::index_name(filename);
+
+	// the first seek builds the sidecar, the next one uses it
+	write_file(filename, FRAMES, FRAMES);
+	CHECK(check_range(filename));
+	CHECK(access(index.c_str(), F_OK) == 0);
+	CHECK(check_range(filename));
+
+	// lines moved before the range, with the same size and a newer time stamp
+	struct stat info;
+	stat(filename, &info);
+	write_file(filename, 20, 3500);
+	set_mtime(filename, info, 1);
+	CHECK(check_range(filename));
+
+	// the same again, but with the time stamp of the indexed file, only the offsets can tell
+	write_file(filename, FRAMES, FRAMES);
+	CHECK(check_range(filename));
+	stat(filename, &info);
+	write_file(filename, 20, 3500);
+	set_mtime(filename, info, 0);
+	CHECK(check_range(filename));
+
+	remove(index.c_str());
+	remove(filename);
+}
+
+/**
+ * \return Whether reading the range of the file throws an out_of_range exception.
+ */
+static bool range_fails(const string &filename, size_t start, long count) {
+	try {
+		CS229Reader reader;
+		reader.read_range(filename, start, count);
+	} catch (const out_of_range &e) {
+		return true;
+	}
+
+	return false;
+}
+
+void test_block_reader_range() {
+	char filename[] = "/tmp/imtestXXXXXX";
+	const int fd = mkstemp(filename);
+	CHECK(fd >= 0);
+	if (fd < 0) {
+		return;
+	}
+
+	close(fd);
+
+	// without a 'Samples' line, a range past the end is only found out by reading it
+	write_file(filename, FRAMES, FRAMES);
+	CHECK(!range_fails(filename, FRAMES - 10, 10));
+	CHECK(!range_fails(filename, FRAMES - 10, -1));
+	CHECK(!range_fails(filename, FRAMES, 0));
+	CHECK(range_fails(filename, FRAMES, -1));
+	CHECK(range_fails(filename, FRAMES + 1000, 10));
+	CHECK(range_fails(filename, FRAMES - 10, 20));
+
+	CS229Reader reader;
+	AudioFile tail = reader.read_range(filename, FRAMES - 10, -1);
+	CHECK(tail.get_num_samples() == 10 && tail[0].get_sample(9) == (long)FRAMES - 1);
+
+	remove(CS229Reader::index_name(filename).c_str());
+	remove(filename);
+}
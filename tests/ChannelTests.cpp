@@ -0,0 +1,136 @@
+#include <Channel.h>
+#include <CS229Writer.h>
+#include <stdexcept>
+#include <vector>
+#include <unistd.h>
+
+#include "Check.h"
+
+/**
+ * \param samples Samples of the Channel, each of them held by its single chunk.
+ * \return A 16 bit Channel holding 'samples'.
+ */
+static Channel make_channel(const vector<long> &samples) {
+	Channel channel(16);
+	for (auto sample : samples) {
+		channel.push_sample(sample);
+	}
+
+	return channel;
+}
+
+void test_channel_rope() {
+	// odd sized chunks, with empty Channels between them
+	const vector<vector<long>> parts = { { 1, 2, 3 }, { }, { 4, 5, 6, 7, 8 }, { 9 }, { }, { 10, 11 } };
+	vector<Channel> sources;
+	vector<long> expected;
+	Channel rope(16);
+	for (auto &part : parts) {
+		sources.push_back(make_channel(part));
+		expected.insert(expected.end(), part.begin(), part.end());
+	}
+
+	for (auto &source : sources) {
+		rope.append(source);
+	}
+
+	CHECK(rope.size() == expected.size());
+	CHECK(rope.num_chunks() > 1);
+
+	// get_sample(...) goes through find_sample(...) while the rope has several chunks
+	for (size_t i = 0; i < expected.size(); i++) {
+		CHECK(rope.get_sample(i) == expected[i]);
+	}
+
+	// the chunks cover every sample once, in order
+	size_t next = 0;
+	rope.for_each_chunk([&](const long *data, size_t count, size_t offset) {
+		CHECK(offset == next);
+		for (size_t i = 0; i < count; i++) {
+			CHECK(offset + i < expected.size() && data[i] == expected[offset + i]);
+		}
+
+		next += count;
+	});
+	CHECK(next == expected.size());
+
+	// a sample pushed after shared chunks starts a chunk of its own
+	rope.push_sample(12);
+	expected.push_back(12);
+	CHECK(rope.get_sample(expected.size() - 1) == 12);
+
+	// flattening keeps every sample, and writing to the rope leaves its sources alone
+	const long *flat = rope.data();
+	CHECK(rope.num_chunks() == 1);
+	CHECK(rope.size() == expected.size());
+	for (size_t i = 0; i < expected.size(); i++) {
+		CHECK(flat[i] == expected[i]);
+	}
+
+	rope[0] = -1;
+	CHECK(rope.get_sample(0) == -1);
+	CHECK(sources[0].get_sample(0) == 1);
+
+	// flattening a rope of empty chunks only
+	Channel empty(16);
+	empty.append(sources[1]);
+	empty.append(sources[4]);
+	CHECK(empty.size() == 0);
+	empty.data();
+	CHECK(empty.size() == 0);
+}
+
+void test_channel_float() {
+	// every 32 bit sample survives the floating point format
+	const long samples[] = { (1L << 31), -((1L << 31) - 1), (1L << 24) + 1, -((1L << 30) + 3) };
+	Channel channel(32);
+	for (long sample : samples) {
+		channel.push_sample(sample);
+	}
+
+	channel.convert_to_float();
+	for (size_t i = 0; i < 4; i++) {
+		CHECK(channel.get_sample(i) == samples[i]);
+	}
+
+	channel.quantize();
+	for (size_t i = 0; i < 4; i++) {
+		CHECK(channel.get_sample(i) == samples[i]);
+	}
+
+	// a floating point sample out of range is found before the output is created
+	const string filename = "/tmp/imtest_float_" + to_string(getpid()) + ".cs229";
+	AudioFile file("float", "cs229", 8000, 8, 1, true);
+	file[0].push_float(100.0);
+	file[0].push_float(300.0);
+
+	CS229Writer writer;
+	bool thrown = false;
+	try {
+		writer.write_file(file, filename);
+	} catch (const overflow_error &e) {
+		thrown = true;
+	}
+
+	CHECK(thrown);
+	CHECK(access(filename.c_str(), F_OK) != 0);
+}
+
+void test_channel_convert() {
+	// widening keeps the symmetric range of the new resolution
+	const long in[] = { -127, 128, -128, 1 };
+	long out[4];
+	Channel::convert_samples(in, out, 4, 8, 16);
+	CHECK(out[0] == -127 * 256);
+	CHECK(out[1] == 32767);
+	CHECK(out[2] == -32767);
+	CHECK(out[3] == 256);
+
+	// as does narrowing
+	const long wide[] = { -32767, 32768, 128, -127 };
+	Channel::convert_samples(wide, out, 4, 16, 8);
+	CHECK(out[0] == -127);
+	CHECK(out[1] == 127);
+	CHECK(out[2] == 1);
+	CHECK(out[3] == 0);
+}
@@ -0,0 +1,37 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <iostream>
+#include <stddef.h>
+
+using namespace std;
+
+/**
+ * Number of checks that failed so far, main() exits with 1 if it is not 0.
+ */
+extern size_t failed_checks;
+
+/**
+ * Checks a condition, printing it with its file and line if it does not hold.
+ * The test goes on after a failed check, so every failure of a run is shown.
+ */
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		failed_checks++; \
+		cerr << __FILE__ << ":" << __LINE__ << ": check failed: " << #cond << endl; \
+	} \
+} while (0)
+
+void test_channel_rope();
+void test_channel_float();
+void test_channel_convert();
+void test_limiter();
+void test_block_ring();
+void test_async_file();
+void test_cs229_index();
+void test_block_reader_range();
+void test_overview();
+void test_thread_pool();
+void test_render_graph();
+
+#endif
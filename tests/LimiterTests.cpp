@@ -0,0 +1,74 @@
+#include <Limiter.h>
+#include <SampleBlock.h>
+#include <algorithm>
+#include <vector>
+#include <math.h>
+
+#include "Check.h"
+
+void test_limiter() {
+	const size_t num_channels = 2;
+	const size_t bit_res = 8;
+	const size_t lookahead = 16;
+	const size_t frames = 1000;
+	const size_t block_size = 37;
+	const long max_val = 128;
+	const long min_val = -127;
+
+	// a quiet tone, with a burst far outside of the bit resolution in the middle
+	vector<vector<long>> input(num_channels, vector<long>(frames));
+	for (size_t i = 0; i < frames; i++) {
+		const bool burst = i >= 500 && i < 600;
+		input[0][i] = lround((burst ? 400.0 : 100.0) * sin(i * 0.05));
+		input[1][i] = burst ? -1000 : 10;
+	}
+
+	// blocks of an odd size, so the delay of the limiter spans several of them
+	Limiter limiter(num_channels, bit_res, lookahead);
+	SampleBlock in(num_channels, block_size);
+	SampleBlock out(num_channels, block_size);
+	vector<vector<long>> output(num_channels);
+	for (size_t start = 0; start < frames; start += block_size) {
+		const size_t count = min(block_size, frames - start);
+		for (size_t c = 0; c < num_channels; c++) {
+			copy(input[c].begin() + start, input[c].begin() + start + count, in.channel(c));
+		}
+
+		in.set_frames(count);
+		const size_t written = limiter.process(in, out);
+		CHECK(written == out.get_frames() && written <= count);
+		for (size_t c = 0; c < num_channels; c++) {
+			output[c].insert(output[c].end(), out.channel(c), out.channel(c) + written);
+		}
+	}
+
+	const size_t flushed = limiter.flush(out);
+	CHECK(flushed == lookahead - 1);
+	for (size_t c = 0; c < num_channels; c++) {
+		output[c].insert(output[c].end(), out.channel(c), out.channel(c) + flushed);
+	}
+
+	// every frame comes out once, within the bit resolution
+	for (size_t c = 0; c < num_channels; c++) {
+		CHECK(output[c].size() == frames);
+		for (auto sample : output[c]) {
+			CHECK(sample >= min_val && sample <= max_val);
+		}
+	}
+
+	// frames well before the burst are left alone
+	for (size_t i = 0; i < 400; i++) {
+		CHECK(output[0][i] == input[0][i] && output[1][i] == input[1][i]);
+	}
+
+	// the limiter is reset by flush(...), and limits again from scratch
+	in.set_frames(0);
+	CHECK(limiter.process(in, out) == 0);
+	CHECK(limiter.flush(out) == 0);
+
+	vector<long> samples = input[1];
+	Limiter::limit(samples.data(), samples.size(), bit_res);
+	for (auto sample : samples) {
+		CHECK(sample >= min_val && sample <= max_val);
+	}
+}
@@ -0,0 +1,60 @@
+#include <Overview.h>
+#include <fstream>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "Check.h"
+
+/**
+ * Writes a mono .cs229 file of 'frames' frames, alternating between 'peak' and -'peak'.
+ */
+static void write_file(const string &filename, size_t frames, long peak) {
+	ofstream os(filename);
+	os << "CS229\nSampleRate 8000\nChannels 1\nBitRes 16\nStartData\n";
+	for (size_t i = 0; i < frames; i++) {
+		os << (i % 2 ? -peak : peak) << '\n';
+	}
+}
+
+/**
+ * \return Whether the overview spans 'frames' frames, with peaks of +/- 'peak'.
+ */
+static bool check_peaks(Overview overview, size_t frames, long peak) {
+	const OverviewEntry whole = overview.query(0, 0, frames, 1)[0];
+	return overview.get_num_frames() == frames && whole.count == frames &&
+		whole.min_val == -peak && whole.max_val == peak;
+}
+
+void test_overview() {
+	char filename[] = "/tmp/imtestXXXXXX";
+	const int fd = mkstemp(filename);
+	CHECK(fd >= 0);
+	if (fd < 0) {
+		return;
+	}
+
+	close(fd);
+
+	// a partial last block, then an unchanged file
+	write_file(filename, 1000, 1000);
+	CHECK(check_peaks(Overview::update(filename), 1000, 1000));
+	CHECK(check_peaks(Overview::update(filename), 1000, 1000));
+
+	// appending keeps the frames summarized already
+	write_file(filename, 3000, 1000);
+	CHECK(check_peaks(Overview::update(filename), 3000, 1000));
+
+	// written again with the same length (and size), but louder
+	write_file(filename, 3000, 9000);
+	CHECK(check_peaks(Overview::update(filename), 3000, 9000));
+
+	// written again, shorter and quieter
+	write_file(filename, 2000, 2000);
+	CHECK(check_peaks(Overview::update(filename), 2000, 2000));
+
+	remove(Overview::sidecar_name(filename).c_str());
+	remove((string(filename) + ".idx").c_str());
+	remove(filename);
+}
@@ -0,0 +1,45 @@
+#include <RenderGraph.h>
+#include <func/SinWave.h>
+#include <func/TriangleWave.h>
+#include <math.h>
+#include <stdexcept>
+
+#include "Check.h"
+
+void test_render_graph() {
+	// a triangle envelope cannot be fused, so the ProcessChain runs on every task
+	SinWave wave(1000.0, 440.0);
+	TriangleWave tremolo(1.0, 3.0);
+	RenderGraph graph(&wave);
+	graph.gain(2.0).envelope(&tremolo);
+
+	// several tasks, the last one partial
+	const size_t rate = 8000;
+	const double length = (3.5 * RENDER_TASK_SIZE) / rate;
+	AudioFile file = graph.render(rate, length, 16);
+	const Channel &channel = file[0];
+	CHECK(channel.size() == (size_t)ceil(length * rate));
+
+	// the same samples as rendering block by block on this thread
+	bool same = true;
+	double block[RENDER_BLOCK_SIZE];
+	for (size_t start = 0; start < channel.size(); start += RENDER_BLOCK_SIZE) {
+		const size_t count = min((size_t)RENDER_BLOCK_SIZE, channel.size() - start);
+		graph.render_block(start, rate, block, count);
+		for (size_t i = 0; i < count; i++) {
+			same = same && channel.get_sample(start + i) == lround(block[i]);
+		}
+	}
+
+	CHECK(same);
+
+	// an overflow on any task reaches the caller
+	bool thrown = false;
+	try {
+		graph.render(rate, length, 8);
+	} catch (const overflow_error &e) {
+		thrown = true;
+	}
+
+	CHECK(thrown);
+}
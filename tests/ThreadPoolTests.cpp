@@ -0,0 +1,72 @@
+#include <ThreadPool.h>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "Check.h"
+
+void test_thread_pool() {
+	ThreadPool pool(2);
+
+	// every index is visited once
+	vector<atomic<int>> visits(100);
+	for (auto &v : visits) {
+		v = 0;
+	}
+
+	pool.parallel_for(visits.size(), [&](size_t i) { visits[i]++; });
+	bool once = true;
+	for (auto &v : visits) {
+		once = once && v == 1;
+	}
+
+	CHECK(once);
+
+	// nested calls from the tasks of the pool, with more of them than workers
+	atomic<int> inner(0);
+	pool.parallel_for(4, [&](size_t i) {
+		pool.parallel_for(8, [&](size_t j) { inner++; });
+	});
+	CHECK(inner == 32);
+
+	// the exception of a call goes to its caller only
+	bool failed_thrown = false;
+	bool quiet_thrown = false;
+	atomic<int> quiet_done(0);
+	thread failing([&]() {
+		try {
+			pool.parallel_for(16, [](size_t i) {
+				if (i == 3) {
+					throw runtime_error("task failed");
+				}
+			});
+		} catch (const runtime_error &e) {
+			failed_thrown = true;
+		}
+	});
+
+	for (int round = 0; round < 20; round++) {
+		try {
+			pool.parallel_for(16, [&](size_t i) { quiet_done++; });
+		} catch (const exception &e) {
+			quiet_thrown = true;
+		}
+	}
+
+	failing.join();
+	CHECK(failed_thrown);
+	CHECK(!quiet_thrown);
+	CHECK(quiet_done == 20 * 16);
+
+	// submit(...) and wait() still report the exceptions of submitted tasks
+	bool wait_thrown = false;
+	pool.submit([] { throw runtime_error("submitted task failed"); });
+	try {
+		pool.wait();
+	} catch (const runtime_error &e) {
+		wait_thrown = true;
+	}
+
+	CHECK(wait_thrown);
+}
@@ -0,0 +1,44 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+
+size_t failed_checks = 0;
+
+/**
+ * A test and the name it is reported under.
+ */
+struct Test {
+	string name;
+	void (*run)();
+};
+
+static const vector<Test> tests = {
+	{ "channel_rope", test_channel_rope },
+	{ "channel_float", test_channel_float },
+	{ "channel_convert", test_channel_convert },
+	{ "limiter", test_limiter },
+	{ "block_ring", test_block_ring },
+	{ "async_file", test_async_file },
+	{ "cs229_index", test_cs229_index },
+	{ "block_reader_range", test_block_reader_range },
+	{ "overview", test_overview },
+	{ "thread_pool", test_thread_pool },
+	{ "render_graph", test_render_graph },
+};
+
+int main(int argc, char **argv) {
+	for (auto &test : tests) {
+		const size_t before = failed_checks;
+		test.run();
+		cout << test.name << ": " << (failed_checks == before ? "ok" : "FAILED") << endl;
+	}
+
+	if (failed_checks) {
+		cerr << failed_checks << " check(s) failed" << endl;
+		return 1;
+	}
+
+	return 0;
+}